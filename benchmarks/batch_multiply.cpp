@@ -0,0 +1,112 @@
+﻿#include "OxygenMathLite.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace OxygenMathLite;
+
+// 比较 Batch::MultiplyMany 的逐矩阵展开核与按 Lanes 个矩阵转置成结构数组后再相乘的核,
+// 以及数据本身就是结构数组时的 Mat3Batch 乘法; 输出每个矩阵乘积的平均耗时 (纳秒)
+namespace
+{
+    constexpr size_t Lanes = 8;
+
+    // 每块 Lanes 个矩阵先转置为 e[k][j] (第 j 个矩阵的第 k 个元素), 乘完再转置回去
+    template <int D>
+    struct LaneMat
+    {
+        real e[D * D][Lanes];
+    };
+
+    template <typename M, int D>
+    void LaneMultiply(const M *A, const M *B, M *C, size_t n)
+    {
+        const real *a = reinterpret_cast<const real *>(A), *b = reinterpret_cast<const real *>(B);
+        real *c = reinterpret_cast<real *>(C);
+        Parallel::For(
+            (n + Lanes - 1) / Lanes, [&](size_t lo, size_t hi)
+            {
+                for (size_t blk = lo; blk < hi; ++blk)
+                {
+                    size_t base = blk * Lanes, w = std::min(Lanes, n - base);
+                    LaneMat<D> x, y, z;
+                    for (int k = 0; k < D * D; ++k)
+                        for (size_t j = 0; j < Lanes; ++j)
+                        {
+                            size_t i = base + (j < w ? j : 0);
+                            x.e[k][j] = a[i * D * D + k];
+                            y.e[k][j] = b[i * D * D + k];
+                        }
+                    for (int r = 0; r < D; ++r)
+                        for (int col = 0; col < D; ++col)
+                        {
+                            for (size_t j = 0; j < Lanes; ++j)
+                                z.e[r * D + col][j] = x.e[r * D][j] * y.e[col][j];
+                            for (int k = 1; k < D; ++k)
+                                for (size_t j = 0; j < Lanes; ++j)
+                                    z.e[r * D + col][j] += x.e[r * D + k][j] * y.e[k * D + col][j];
+                        }
+                    for (int k = 0; k < D * D; ++k)
+                        for (size_t j = 0; j < w; ++j)
+                            c[(base + j) * D * D + k] = z.e[k][j];
+                } },
+            (1 << 12) / Lanes);
+    }
+
+    template <typename F>
+    double NanosPerMatrix(size_t n, int repeat, F &&f)
+    {
+        double best = 1e30;
+        for (int round = 0; round < 3; ++round)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int k = 0; k < repeat; ++k)
+                f();
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() / repeat / n);
+        }
+        return best;
+    }
+
+    Mat3 RandomMat3(MathTools::FastRandom &rng)
+    {
+        return Mat3(rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1));
+    }
+}
+
+int main()
+{
+    MathTools::FastRandom rng(7);
+    for (size_t n : {size_t(4096), size_t(1) << 20})
+    {
+        int repeat = int((size_t(1) << 24) / n);
+        std::vector<Mat3> A(n), B(n), C(n);
+        std::vector<Mat2> A2(n), B2(n), C2(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            A[i] = RandomMat3(rng), B[i] = RandomMat3(rng);
+            A2[i] = Mat2(rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1));
+            B2[i] = Mat2(rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1));
+        }
+        Batch::Mat3Batch a(A.data(), n), b(B.data(), n), c;
+
+        double direct3 = NanosPerMatrix(n, repeat, [&]
+                                        { Batch::MultiplyMany(A.data(), B.data(), C.data(), n); });
+        double lane3 = NanosPerMatrix(n, repeat, [&]
+                                      { LaneMultiply<Mat3, 3>(A.data(), B.data(), C.data(), n); });
+        double soa3 = NanosPerMatrix(n, repeat, [&]
+                                     { Batch::Multiply(a, b, c); });
+        double direct2 = NanosPerMatrix(n, repeat, [&]
+                                        { Batch::MultiplyMany(A2.data(), B2.data(), C2.data(), n); });
+        double lane2 = NanosPerMatrix(n, repeat, [&]
+                                      { LaneMultiply<Mat2, 2>(A2.data(), B2.data(), C2.data(), n); });
+
+        std::cout << "n = " << n << " (ns / matrix)\n"
+                  << "  Mat3 MultiplyMany (direct)     " << direct3 << "\n"
+                  << "  Mat3 lane transpose kernel     " << lane3 << "\n"
+                  << "  Mat3Batch Multiply (SoA data)  " << soa3 << "\n"
+                  << "  Mat2 MultiplyMany (direct)     " << direct2 << "\n"
+                  << "  Mat2 lane transpose kernel     " << lane2 << "\n";
+    }
+    return 0;
+}
@@ -4,6 +4,23 @@
 #include <sstream>
 #include <algorithm>
 #include <random>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <unordered_map>
+#include <array>
+#include <set>
+#include <queue>
 
 #ifdef DOUBLE_PRECISION
 using real = double;
@@ -112,6 +129,8 @@ namespace OxygenMathLite
         void clear() { x = y = 0; }
         bool isZero() const { return x == 0 && y == 0; }
         bool isUnit() const { return std::fabs(lengthSquared() - 1) < Constants::Epsilon; }
+        real operator[](int i) const { return i == 0 ? x : y; }
+        real &operator[](int i) { return i == 0 ? x : y; }
 
         friend std::ostream &operator<<(std::ostream &os, const Vec2 &v)
         {
@@ -227,6 +246,8 @@ namespace OxygenMathLite
         void clear() { x = y = z = 0; }
         inline bool isZero() const { return x == 0 && y == 0 && z == 0; }
         inline bool isUnit() const { return std::fabs(lengthSquared() - 1) < Constants::Epsilon; }
+        real operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+        real &operator[](int i) { return i == 0 ? x : (i == 1 ? y : z); }
         friend std::ostream &operator<<(std::ostream &os, const Vec3 &v)
         {
             std::ostringstream xs, ys, zs;
@@ -425,6 +446,100 @@ namespace OxygenMathLite
             return Mat2(m11 / det, -m01 / det, -m10 / det, m00 / det);
         }
 
+        static Mat2 FromColumns(const Vec2 &c0, const Vec2 &c1)
+        {
+            return {c0.x, c1.x, c0.y, c1.y};
+        }
+        Vec2 Column(int i) const
+        {
+            return i == 0 ? Vec2{m00, m10} : Vec2{m01, m11};
+        }
+
+        // 对称矩阵特征分解 (解析解), 特征值降序, 特征向量按列存放
+        void EigenSymmetric(Vec2 &values, Mat2 &vectors) const
+        {
+            real mean = (m00 + m11) * 0.5f;
+            real half = (m00 - m11) * 0.5f;
+            real r = std::sqrt(half * half + m01 * m01);
+            values = {mean + r, mean - r};
+
+            // 阈值相对于矩阵量级, 小尺度数据的协方差同样适用
+            Vec2 v0;
+            if (std::abs(m01) > Constants::Epsilon * (std::abs(m00) + std::abs(m11)))
+            {
+                v0 = Vec2{values.x - m11, m01};
+                v0 = v0 / v0.length();
+            }
+            else
+                v0 = m00 >= m11 ? Vec2{1, 0} : Vec2{0, 1};
+            vectors = FromColumns(v0, v0.perpendicular());
+        }
+
+        // Frobenius 范数
+        real Norm() const { return std::sqrt(m00 * m00 + m01 * m01 + m10 * m10 + m11 * m11); }
+
+        // 极分解 A = R * S: R 正交 (det(A) > 0 时为旋转), S 对称半正定; 二维下 R 正比于 A + sign(det) * cof(A)
+        void PolarDecomposition(Mat2 &R, Mat2 &S) const
+        {
+            real sgn = m00 * m11 - m01 * m10 < 0 ? real(-1) : real(1);
+            real a = m00 + sgn * m11, b = m01 - sgn * m10;
+            real len = std::sqrt(a * a + b * b);
+            R = len < Constants::Epsilon ? Identity() : Mat2(a / len, b / len, -sgn * b / len, sgn * a / len);
+            Mat2 s = R.Transpose() * (*this);
+            real off = (s.m01 + s.m10) * 0.5f;
+            S = Mat2(s.m00, off, off, s.m11);
+        }
+
+        // 矩阵指数: 记 A = t * I + B (B 无迹), 则 B^2 = d * I, 由此得闭式 exp(B) = c * I + s * B
+        Mat2 Exp() const
+        {
+            real t = (m00 + m11) * 0.5f, b00 = m00 - t;
+            real d = b00 * b00 + m01 * m10;
+            real c, s;
+            if (d > Constants::Epsilon)
+            {
+                real r = std::sqrt(d);
+                c = std::cosh(r), s = std::sinh(r) / r;
+            }
+            else if (d < -Constants::Epsilon)
+            {
+                real r = std::sqrt(-d);
+                c = std::cos(r), s = std::sin(r) / r;
+            }
+            else
+                c = 1 + d / 2 + d * d / 24, s = 1 + d / 6 + d * d / 120;
+            real e = std::exp(t);
+            return Mat2(e * (c + s * b00), e * s * m01, e * s * m10, e * (c - s * b00));
+        }
+
+        // 主对数 log(A) = log(sqrt(det)) * I + beta * B; A 有非正实特征值时无定义, 抛出异常
+        Mat2 Log() const
+        {
+            real t = (m00 + m11) * 0.5f, b00 = m00 - t;
+            real d = b00 * b00 + m01 * m10;
+            real beta;
+            if (d > Constants::Epsilon * t * t)
+            {
+                real r = std::sqrt(d);
+                if (t <= r)
+                    throw("Matrix logarithm undefined");
+                beta = std::atanh(r / t) / r;
+            }
+            else if (d < -Constants::Epsilon * t * t)
+            {
+                real r = std::sqrt(-d);
+                beta = std::atan2(r, t) / r;
+            }
+            else
+            {
+                if (t <= 0)
+                    throw("Matrix logarithm undefined");
+                beta = (1 + d / (3 * t * t)) / t;
+            }
+            real alpha = 0.5f * std::log(t * t - d);
+            return Mat2(alpha + beta * b00, beta * m01, beta * m10, alpha - beta * b00);
+        }
+
         friend std::ostream &operator<<(std::ostream &os, const Mat2 &m)
         {
             os << "[" << m.m00 << "," << m.m01 << "]\n"
@@ -432,6 +547,89 @@ namespace OxygenMathLite
             return os;
         }
     };
+    // ====================== Rot2 ======================
+    // 二维旋转, 存 (cos, sin) 即单位复数; 角度只在构造时求一次三角函数
+    struct Rot2
+    {
+        real c = 1, s = 0;
+        Rot2() = default;
+        Rot2(real c, real s) : c(c), s(s) {}
+        explicit Rot2(real rads) : c(std::cos(rads)), s(std::sin(rads)) {}
+        static Rot2 Identity()
+        {
+            return Rot2();
+        }
+        // 把 from 方向转到 to 方向的旋转, 任一向量为零时返回单位旋转
+        static Rot2 Between(const Vec2 &from, const Vec2 &to)
+        {
+            Rot2 r(from.dot(to), from.cross(to));
+            real len = std::sqrt(r.c * r.c + r.s * r.s);
+            return len < Constants::Epsilon ? Rot2() : Rot2(r.c / len, r.s / len);
+        }
+
+        // 复数乘法: 先转 o 再转 *this
+        Rot2 operator*(const Rot2 &o) const { return {c * o.c - s * o.s, s * o.c + c * o.s}; }
+        Rot2 &operator*=(const Rot2 &o)
+        {
+            *this = *this * o;
+            return *this;
+        }
+        Vec2 operator*(const Vec2 &v) const { return Rotate(v); }
+
+        Vec2 Rotate(const Vec2 &v) const { return {c * v.x - s * v.y, s * v.x + c * v.y}; }
+        Vec2 InvRotate(const Vec2 &v) const { return {c * v.x + s * v.y, c * v.y - s * v.x}; }
+        Rot2 Inv() const { return {c, -s}; }
+        real Angle() const { return std::atan2(s, c); }
+        Mat2 ToMat2() const { return {c, -s, s, c}; }
+        Vec2 XAxis() const { return {c, s}; }
+        Vec2 YAxis() const { return {-s, c}; }
+
+        // 反复复合后的快速归一化: 以 1 附近的一阶近似 1 / sqrt(x) ~ (3 - x) / 2 代替开方
+        Rot2 Renormalize() const
+        {
+            real k = (3 - (c * c + s * s)) * 0.5f;
+            return {c * k, s * k};
+        }
+        // 精确归一化, 长度过小时返回单位旋转
+        Rot2 Normalize() const
+        {
+            real len = std::sqrt(c * c + s * s);
+            return len < Constants::Epsilon ? Rot2() : Rot2(c / len, s / len);
+        }
+        // 角速度积分 (小角度 dAngle): 不调用三角函数, 结果快速归一化
+        Rot2 Integrate(real dAngle) const { return Rot2(c - s * dAngle, s + c * dAngle).Renormalize(); }
+        // 按角度插值 (最短路径), t in [0, 1]
+        Rot2 Slerp(const Rot2 &to, real t) const { return *this * Rot2((Inv() * to).Angle() * t); }
+
+        // 批量旋转 out[i] = R * in[i], 允许 out == in
+        void Rotate(const Vec2 *in, Vec2 *out, size_t count) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = Rotate(in[i]);
+        }
+        void InvRotate(const Vec2 *in, Vec2 *out, size_t count) const
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = InvRotate(in[i]);
+        }
+        // 逐元素旋转 out[i] = rots[i] * in[i], 以及平移 out[i] = rots[i] * in[i] + offsets[i]
+        static void Rotate(const Rot2 *rots, const Vec2 *in, Vec2 *out, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = rots[i].Rotate(in[i]);
+        }
+        static void Transform(const Rot2 *rots, const Vec2 *offsets, const Vec2 *in, Vec2 *out, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = rots[i].Rotate(in[i]) + offsets[i];
+        }
+
+        friend std::ostream &operator<<(std::ostream &os, const Rot2 &r)
+        {
+            os << "Rot2(" << r.c << "," << r.s << ")";
+            return os;
+        }
+    };
     // ====================== Mat3 ======================
     struct Mat3
     {
@@ -460,6 +658,21 @@ namespace OxygenMathLite
                         0, 1, 0,
                         0, 0, 1);
         }
+        // 绕单位轴 axis 旋转 rads (Rodrigues)
+        static Mat3 Rotation(const Vec3 &axis, real rads)
+        {
+            real c = std::cos(rads), s = std::sin(rads), t = 1 - c;
+            real x = axis.x, y = axis.y, z = axis.z;
+            return Mat3(t * x * x + c, t * x * y - s * z, t * x * z + s * y,
+                        t * x * y + s * z, t * y * y + c, t * y * z - s * x,
+                        t * x * z - s * y, t * y * z + s * x, t * z * z + c);
+        }
+        static Mat3 OuterProduct(const Vec3 &a, const Vec3 &b)
+        {
+            return Mat3(a.x * b.x, a.x * b.y, a.x * b.z,
+                        a.y * b.x, a.y * b.y, a.y * b.z,
+                        a.z * b.x, a.z * b.y, a.z * b.z);
+        }
 
         // 拷贝 / 移动
         Mat3(const Mat3 &o)
@@ -638,6 +851,189 @@ namespace OxygenMathLite
                 -(m00 * m21 - m01 * m20) / det,
                 (m00 * m11 - m01 * m10) / det);
         }
+
+        static Mat3 FromColumns(const Vec3 &c0, const Vec3 &c1, const Vec3 &c2)
+        {
+            return {c0.x, c1.x, c2.x,
+                    c0.y, c1.y, c2.y,
+                    c0.z, c1.z, c2.z};
+        }
+        Vec3 Column(int i) const
+        {
+            return i == 0 ? Vec3{m00, m10, m20} : (i == 1 ? Vec3{m01, m11, m21} : Vec3{m02, m12, m22});
+        }
+
+        // 对称矩阵特征分解 (循环 Jacobi), 特征值降序, 特征向量按列存放
+        void EigenSymmetric(Vec3 &values, Mat3 &vectors) const
+        {
+            real a[3][3] = {{m00, m01, m02}, {m01, m11, m12}, {m02, m12, m22}};
+            real v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+            real scale = std::abs(m00) + std::abs(m11) + std::abs(m22) + std::abs(m01) + std::abs(m02) + std::abs(m12);
+            real tiny = scale * Constants::Epsilon;
+
+            for (int sweep = 0; sweep < 32; ++sweep)
+            {
+                if (std::abs(a[0][1]) + std::abs(a[0][2]) + std::abs(a[1][2]) <= tiny)
+                    break;
+                for (int p = 0; p < 2; ++p)
+                {
+                    for (int q = p + 1; q < 3; ++q)
+                    {
+                        if (std::abs(a[p][q]) <= tiny)
+                            continue;
+                        real theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                        real t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta * theta + 1));
+                        real c = 1 / std::sqrt(t * t + 1), s = t * c;
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            real akp = a[k][p], akq = a[k][q];
+                            a[k][p] = c * akp - s * akq;
+                            a[k][q] = s * akp + c * akq;
+                        }
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            real apk = a[p][k], aqk = a[q][k];
+                            a[p][k] = c * apk - s * aqk;
+                            a[q][k] = s * apk + c * aqk;
+                        }
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            real vkp = v[k][p], vkq = v[k][q];
+                            v[k][p] = c * vkp - s * vkq;
+                            v[k][q] = s * vkp + c * vkq;
+                        }
+                    }
+                }
+            }
+
+            int order[3] = {0, 1, 2};
+            std::sort(order, order + 3, [&](int i, int j)
+                      { return a[i][i] > a[j][j]; });
+            values = {a[order[0]][order[0]], a[order[1]][order[1]], a[order[2]][order[2]]};
+            Vec3 cols[3];
+            for (int i = 0; i < 3; ++i)
+                cols[i] = {v[0][order[i]], v[1][order[i]], v[2][order[i]]};
+            vectors = FromColumns(cols[0], cols[1], cols[2]);
+        }
+
+        // 奇异值分解 *this = U * diag(sigma) * V^T, 奇异值降序; det(*this) < 0 时 U 为反射
+        void SVD(Mat3 &U, Vec3 &sigma, Mat3 &V) const
+        {
+            Vec3 lambda;
+            (Transpose() * (*this)).EigenSymmetric(lambda, V);
+            sigma = {std::sqrt(std::max<real>(lambda.x, 0)), std::sqrt(std::max<real>(lambda.y, 0)), std::sqrt(std::max<real>(lambda.z, 0))};
+
+            Vec3 u0 = (*this) * V.Column(0);
+            if (u0.length() < Constants::Epsilon)
+            {
+                U = Identity();
+                return;
+            }
+            u0.normalizeSelf();
+            Vec3 u1 = (*this) * V.Column(1);
+            u1 -= u0 * u0.dot(u1);
+            if (u1.length() < Constants::Epsilon * (sigma.x + 1))
+                u1 = std::abs(u0.x) < 0.9f ? Vec3(1, 0, 0) - u0 * u0.x : Vec3(0, 1, 0) - u0 * u0.y;
+            u1.normalizeSelf();
+            Vec3 u2 = u0.cross(u1);
+            if (((*this) * V.Column(2)).dot(u2) < 0)
+                u2 = -u2;
+            U = FromColumns(u0, u1, u2);
+        }
+
+        // Frobenius 范数
+        real Norm() const
+        {
+            return std::sqrt(m00 * m00 + m01 * m01 + m02 * m02 + m10 * m10 + m11 * m11 + m12 * m12 + m20 * m20 + m21 * m21 + m22 * m22);
+        }
+
+        // 极分解 A = R * S: R 正交 (det(A) > 0 时为旋转), S 对称半正定;
+        // Higham 缩放 Newton 迭代 X <- (g * X + X^-T / g) / 2, 奇异时退回 SVD
+        void PolarDecomposition(Mat3 &R, Mat3 &S) const
+        {
+            real n = Norm();
+            Mat3 X = n > 0 ? *this / n : Identity();
+            if (std::abs(X.Det()) < Constants::Epsilon)
+            {
+                Mat3 U, V;
+                Vec3 sigma;
+                SVD(U, sigma, V);
+                R = U * V.Transpose();
+            }
+            else
+            {
+                for (int it = 0; it < 32; ++it)
+                {
+                    Mat3 Xit = X.Inv().Transpose();
+                    real g = std::sqrt(Xit.Norm() / X.Norm());
+                    Mat3 next = (X * g + Xit / g) * 0.5f;
+                    real change = (next - X).Norm();
+                    X = next;
+                    if (change <= 10 * Constants::Epsilon)
+                        break;
+                }
+                R = X;
+            }
+            Mat3 s = R.Transpose() * (*this);
+            real s01 = (s.m01 + s.m10) * 0.5f, s02 = (s.m02 + s.m20) * 0.5f, s12 = (s.m12 + s.m21) * 0.5f;
+            S = Mat3(s.m00, s01, s02, s01, s.m11, s12, s02, s12, s.m22);
+        }
+
+        // 矩阵指数: 缩放至范数不超过 0.5, 用 [6/6] Padé 近似, 再平方回去
+        Mat3 Exp() const
+        {
+            real norm = Norm();
+            int s = norm > 0.5f ? static_cast<int>(std::ceil(std::log2(norm / 0.5f))) : 0;
+            Mat3 X = *this * std::ldexp(real(1), -s);
+            Mat3 N = Identity(), D = Identity(), P = Identity();
+            real c = 1;
+            for (int k = 1; k <= 6; ++k)
+            {
+                c *= real(7 - k) / real(k * (13 - k));
+                P = P * X;
+                N += P * c;
+                D += P * (k % 2 ? -c : c);
+            }
+            Mat3 E = D.Inv() * N;
+            for (int i = 0; i < s; ++i)
+                E = E * E;
+            return E;
+        }
+
+        // 主对数 (逆缩放平方): Denman-Beavers 迭代反复开平方直到 ||X - I|| <= 0.25,
+        // 再用 5 点 Gauss-Legendre 求积 log(I + Y) = ∫ Y (I + x Y)^-1 dx (x 从 0 到 1), 最后乘 2^k
+        Mat3 Log() const
+        {
+            real det = Det();
+            if (det <= 0)
+                throw("Matrix logarithm undefined");
+            // 先除以 det^(1/3) 使行列式为 1, log(c * X) = log(c) * I + log(X)
+            real c = std::cbrt(det);
+            Mat3 X = *this / c;
+            int k = 0;
+            while ((X - Identity()).Norm() > 0.25f)
+            {
+                if (++k > 40)
+                    throw("Matrix logarithm undefined");
+                Mat3 Y = X, Z = Identity();
+                for (int it = 0; it < 32; ++it)
+                {
+                    Mat3 nextY = (Y + Z.Inv()) * 0.5f;
+                    Z = (Z + Y.Inv()) * 0.5f;
+                    real change = (nextY - Y).Norm();
+                    Y = nextY;
+                    if (change <= 10 * Constants::Epsilon * Y.Norm())
+                        break;
+                }
+                X = Y;
+            }
+            static const real nodes[5] = {0.0469100770306680f, 0.2307653449471585f, 0.5f, 0.7692346550528415f, 0.9530899229693320f};
+            static const real weights[5] = {0.1184634425280945f, 0.2393143352496832f, 0.2844444444444444f, 0.2393143352496832f, 0.1184634425280945f};
+            Mat3 Y = X - Identity(), L = Zero();
+            for (int j = 0; j < 5; ++j)
+                L += Y * (Identity() + Y * nodes[j]).Inv() * weights[j];
+            return L * std::ldexp(real(1), k) + Identity() * std::log(c);
+        }
         friend std::ostream &operator<<(std::ostream &os, const Mat3 &m)
         {
             os << "[" << m.m00 << " " << m.m01 << "]\n"
@@ -682,115 +1078,7805 @@ namespace OxygenMathLite
         }
         inline Vec2 RandomInsideUnitCircle() { return RandomUnitVector2() * std::sqrt(MathTools::RandomRange(0, 1.0f)); }
 
-    }
-    // ====================== 2D 几何工具 ======================
-    namespace Geometry2D
-    {
-
-        real Distance(const Vec2 &a, const Vec2 &b)
-        {
-            Vec2 d = a - b;
-            return d.length();
-        }
-        real DistanceSquared(const Vec2 &a, const Vec2 &b)
+        // SplitMix64 快速随机数, 状态仅 8 字节, 可按 (seed, stream) 构造互不相关的序列
+        struct FastRandom
         {
-            Vec2 d = a - b;
-            return d.lengthSquared();
-        }
-        Vec2 ClosestPointOnLineSegment(const Vec2 &a, const Vec2 &b, const Vec2 &p)
-        {
-            Vec2 ab = b - a;
-            real t = (p - a).dot(ab) / ab.lengthSquared();
-            t = MathTools::Clamp(t, 0, 1);
-            return a + ab * t;
-        }
-        real DistancePointToLine(const Vec2 &a, const Vec2 &b, const Vec2 &p)
-        {
-            Vec2 ab = b - a;
-            Vec2 ap = p - a;
+            uint64_t state;
 
-            real crossProduct = std::abs(ab.cross(ap));
-            real lineLength = ab.length();
-            if (lineLength < Constants::Epsilon)
+            explicit FastRandom(uint64_t seed = 0, uint64_t stream = 0) : state(seed ^ (stream * 0xD1B54A32D192ED03ull))
             {
-                return ap.length();
+                Next();
+            }
+            // 每个线程一个实例, 以 random_device 播种
+            static FastRandom &ThreadLocal()
+            {
+                thread_local FastRandom rng((static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}());
+                return rng;
             }
-            return crossProduct / lineLength;
-        }
 
-        // 线段到线段的距离
-        real DistanceLineToLine(const Vec2 &a, const Vec2 &b, const Vec2 &c, const Vec2 &d)
+            uint64_t Next()
+            {
+                uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return z ^ (z >> 31);
+            }
+            // [0, 1)
+            real Uniform()
+            {
+                if (sizeof(real) == sizeof(double))
+                    return static_cast<real>((Next() >> 11) * (1.0 / 9007199254740992.0));
+                return static_cast<real>((Next() >> 40) * (1.0f / 16777216.0f));
+            }
+            real Range(real min, real max) { return min + (max - min) * Uniform(); }
+            // [0, n)
+            size_t Index(size_t n) { return static_cast<size_t>(Next() % n); }
+        };
+
+        // Philox4x32-10 计数器随机数 (Salmon 等, 2011): 输出只由 (seed, stream, 下标) 决定,
+        // 任意线程可直接计算流中第 i 个样本, 并行结果与线程数和调度无关
+        struct Philox
         {
-            Vec2 ab = b - a;
-            Vec2 cd = d - c;
+            static constexpr size_t Lanes = 8;
+            uint32_t key[2];
+            uint64_t stream;
 
-            auto Cross = [](const Vec2 &u, const Vec2 &v)
+            explicit Philox(uint64_t seed = 0, uint64_t stream = 0)
+                : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}, stream(stream) {}
+
+            // 计数器 (block, stream) 对应的 4 个 32 位输出
+            void Block(uint64_t block, uint32_t out[4]) const
             {
-                return u.x * v.y - u.y * v.x;
-            };
+                uint32_t c[4] = {static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+                uint32_t k0 = key[0], k1 = key[1];
+                for (int r = 0; r < 10; ++r)
+                {
+                    uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c[0], p1 = static_cast<uint64_t>(0xCD9E8D57u) * c[2];
+                    uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0, n2 = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1;
+                    c[0] = n0, c[1] = static_cast<uint32_t>(p1), c[2] = n2, c[3] = static_cast<uint32_t>(p0);
+                    k0 += 0x9E3779B9u, k1 += 0xBB67AE85u;
+                }
+                for (int k = 0; k < 4; ++k)
+                    out[k] = c[k];
+            }
 
-            // 判断 q 是否在 pr 线段上
-            auto OnSegment = [](const Vec2 &p, const Vec2 &q, const Vec2 &r)
+            // 第 index 个 64 位样本 (每个计数器块给出两个)
+            uint64_t Bits(uint64_t index) const
             {
-                return (q.x >= std::min(p.x, r.x) - Constants::Epsilon &&
-                        q.x <= std::max(p.x, r.x) + Constants::Epsilon &&
-                        q.y >= std::min(p.y, r.y) - Constants::Epsilon &&
-                        q.y <= std::max(p.y, r.y) + Constants::Epsilon);
-            };
+                uint32_t o[4];
+                Block(index >> 1, o);
+                size_t k = (index & 1) * 2;
+                return (static_cast<uint64_t>(o[k]) << 32) | o[k + 1];
+            }
+            // 第 index 个 [0, 1) 均匀样本
+            real Uniform(uint64_t index) const { return ToUniform(Bits(index)); }
+            real Range(uint64_t index, real min, real max) const { return min + (max - min) * Uniform(index); }
 
-            real d1 = Cross(cd, a - c);
-            real d2 = Cross(cd, b - c);
-            real d3 = Cross(ab, c - a);
-            real d4 = Cross(ab, d - a);
+            // out[k] = Uniform(first + k), 每次 Lanes 个计数器块同时计算;
+            // 各线程对不相交的下标区间调用即可并行生成, 结果与划分方式无关
+            void FillUniform(real *out, size_t count, uint64_t first = 0) const
+            {
+                const uint64_t Group = Lanes * 2;
+                uint32_t c[4][Lanes];
+                for (uint64_t base = first / Group * Group; base < first + count; base += Group)
+                {
+                    Blocks(base / 2, c);
+                    for (size_t j = 0; j < Group; ++j)
+                    {
+                        uint64_t index = base + j;
+                        if (index < first || index >= first + count)
+                            continue;
+                        size_t lane = j / 2, k = (j & 1) * 2;
+                        out[index - first] = ToUniform((static_cast<uint64_t>(c[k][lane]) << 32) | c[k + 1][lane]);
+                    }
+                }
+            }
+            void FillRange(real *out, size_t count, real min, real max, uint64_t first = 0) const
+            {
+                FillUniform(out, count, first);
+                for (size_t i = 0; i < count; ++i)
+                    out[i] = min + (max - min) * out[i];
+            }
 
-            // 严格相交
-            if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) &&
-                ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        private:
+            static real ToUniform(uint64_t bits)
             {
-                return 0.0;
+                if (sizeof(real) == sizeof(double))
+                    return static_cast<real>((bits >> 11) * (1.0 / 9007199254740992.0));
+                return static_cast<real>((bits >> 40) * (1.0f / 16777216.0f));
             }
 
-            if (std::abs(Cross(ab, cd)) < Constants::Epsilon)
+            // 计数器 firstBlock 起的 Lanes 个块; 各轮沿 Lanes 展开, 32x32->64 乘法可向量化
+            void Blocks(uint64_t firstBlock, uint32_t (&c)[4][Lanes]) const
             {
-                if (std::abs(Cross(ab, c - a)) < Constants::Epsilon)
+                for (size_t j = 0; j < Lanes; ++j)
                 {
-                    // 共线
-                    if (OnSegment(a, c, b) || OnSegment(a, d, b) ||
-                        OnSegment(c, a, d) || OnSegment(c, b, d))
+                    c[0][j] = static_cast<uint32_t>(firstBlock + j);
+                    c[1][j] = static_cast<uint32_t>((firstBlock + j) >> 32);
+                    c[2][j] = static_cast<uint32_t>(stream);
+                    c[3][j] = static_cast<uint32_t>(stream >> 32);
+                }
+                uint32_t k0 = key[0], k1 = key[1];
+                for (int r = 0; r < 10; ++r)
+                {
+                    for (size_t j = 0; j < Lanes; ++j)
                     {
-                        return 0.0;
+                        uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c[0][j], p1 = static_cast<uint64_t>(0xCD9E8D57u) * c[2][j];
+                        uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c[1][j] ^ k0, n2 = static_cast<uint32_t>(p0 >> 32) ^ c[3][j] ^ k1;
+                        c[0][j] = n0, c[1][j] = static_cast<uint32_t>(p1), c[2][j] = n2, c[3][j] = static_cast<uint32_t>(p0);
                     }
+                    k0 += 0x9E3779B9u, k1 += 0xBB67AE85u;
                 }
-                // 平行但不共线
-                return DistancePointToLine(a, b, c);
             }
+        };
 
-            // 不相交、不平行
-            real dist1 = DistancePointToLine(c, d, a);
-            real dist2 = DistancePointToLine(c, d, b);
-            real dist3 = DistancePointToLine(a, b, c);
-            real dist4 = DistancePointToLine(a, b, d);
+        // 两个 16 位整数按位交织为 32 位 Morton 码 (Z 序)
+        inline uint32_t Morton2D(uint32_t x, uint32_t y)
+        {
+            auto spread = [](uint32_t v)
+            {
+                v &= 0xFFFF;
+                v = (v | (v << 8)) & 0x00FF00FF;
+                v = (v | (v << 4)) & 0x0F0F0F0F;
+                v = (v | (v << 2)) & 0x33333333;
+                v = (v | (v << 1)) & 0x55555555;
+                return v;
+            };
+            return spread(x) | (spread(y) << 1);
+        }
 
-            return std::min(std::min(dist1, dist2), std::min(dist3, dist4));
+        // 三个 10 位整数按位交织为 30 位 Morton 码
+        inline uint32_t Morton3D(uint32_t x, uint32_t y, uint32_t z)
+        {
+            auto spread = [](uint32_t v)
+            {
+                v &= 0x3FF;
+                v = (v | (v << 16)) & 0x030000FF;
+                v = (v | (v << 8)) & 0x0300F00F;
+                v = (v | (v << 4)) & 0x030C30C3;
+                v = (v | (v << 2)) & 0x09249249;
+                return v;
+            };
+            return spread(x) | (spread(y) << 1) | (spread(z) << 2);
         }
 
-    }
+        // 部分主元高斯消元求解 n 阶方程组 a * x = b (a 为行主序, 会被改写); 奇异时返回 false
+        inline bool SolveLinear(real *a, real *b, real *x, int n)
+        {
+            real scale = 0;
+            for (int i = 0; i < n * n; ++i)
+                scale = std::max(scale, std::abs(a[i]));
+            for (int col = 0; col < n; ++col)
+            {
+                int piv = col;
+                for (int r = col + 1; r < n; ++r)
+                    if (std::abs(a[r * n + col]) > std::abs(a[piv * n + col]))
+                        piv = r;
+                if (std::abs(a[piv * n + col]) <= scale * Constants::Epsilon)
+                    return false;
+                for (int k = 0; k < n; ++k)
+                    Swap(a[col * n + k], a[piv * n + k]);
+                Swap(b[col], b[piv]);
+                for (int r = col + 1; r < n; ++r)
+                {
+                    real f = a[r * n + col] / a[col * n + col];
+                    for (int k = col; k < n; ++k)
+                        a[r * n + k] -= f * a[col * n + k];
+                    b[r] -= f * b[col];
+                }
+            }
+            for (int r = n - 1; r >= 0; --r)
+            {
+                real acc = b[r];
+                for (int k = r + 1; k < n; ++k)
+                    acc -= a[r * n + k] * x[k];
+                x[r] = acc / a[r * n + r];
+            }
+            return true;
+        }
 
-    namespace Integration2D
+    }
+    // ====================== 并行工具 ======================
+    namespace Parallel
     {
-        // Euler 积分
-        inline void Euler(Vec2 &position, Vec2 &velocity, const Vec2 &acceleration, real dt)
+        class ThreadPool
         {
-            velocity += acceleration * dt;
-            position += velocity * dt;
-        }
+        public:
+            explicit ThreadPool(unsigned workers)
+            {
+                for (unsigned i = 0; i < workers; ++i)
+                    threads.emplace_back([this]
+                                         { WorkerLoop(); });
+            }
+            ~ThreadPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                cv.notify_all();
+                for (auto &t : threads)
+                    t.join();
+            }
+            ThreadPool(const ThreadPool &) = delete;
+            ThreadPool &operator=(const ThreadPool &) = delete;
 
-        // RK2 积分
-        inline void RK2(Vec2 &position, Vec2 &velocity, const Vec2 &acceleration, real dt)
+            // 全局线程池, 调用线程也参与计算, 因此工作线程数为硬件线程数 - 1;
+            // 至少保留一个工作线程, 保证单核机器上异步任务也能推进
+            static ThreadPool &Instance()
+            {
+                static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+                return pool;
+            }
+            // 参与计算的线程总数 (含调用线程)
+            unsigned Concurrency() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+            void Submit(std::function<void()> job)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    jobs.push_back(std::move(job));
+                }
+                cv.notify_one();
+            }
+
+        private:
+            void WorkerLoop()
+            {
+                for (;;)
+                {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [this]
+                                { return stopping || !jobs.empty(); });
+                        if (jobs.empty())
+                            return;
+                        job = std::move(jobs.front());
+                        jobs.pop_front();
+                    }
+                    job();
+                }
+            }
+
+            std::vector<std::thread> threads;
+            std::deque<std::function<void()>> jobs;
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool stopping = false;
+        };
+
+        namespace Detail
         {
-            Vec2 v_mid = velocity + acceleration * (dt * 0.5f);
-            position += v_mid * dt;
-            velocity += acceleration * dt;
+            // 一次 For 调用的共享状态. 排在其他任务之后的辅助任务可能在 For 返回后才开始,
+            // 那时所有块都已被认领, 它们只访问这里的计数而不会再调用 fn
+            struct ForState
+            {
+                std::atomic<size_t> next{0};
+                std::atomic<size_t> done{0};
+                size_t count = 0, chunks = 0, chunkSize = 0;
+                std::exception_ptr error;
+                std::mutex mutex;
+                std::condition_variable cv;
+            };
+
+            // 逐个认领并执行块; fn 只在认领到块时才解引用
+            template <typename F>
+            void RunChunks(ForState &s, F *fn)
+            {
+                for (size_t c; (c = s.next.fetch_add(1)) < s.chunks;)
+                {
+                    size_t b = c * s.chunkSize, e = std::min(s.count, b + s.chunkSize);
+                    if (b < e)
+                    {
+                        try
+                        {
+                            (*fn)(b, e);
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard<std::mutex> lock(s.mutex);
+                            if (!s.error)
+                                s.error = std::current_exception();
+                        }
+                    }
+                    if (s.done.fetch_add(1, std::memory_order_acq_rel) + 1 == s.chunks)
+                    {
+                        std::lock_guard<std::mutex> lock(s.mutex);
+                        s.cv.notify_all();
+                    }
+                }
+            }
+        }
+
+        // 将 [0, count) 划分为若干块, 在线程池上并行执行 fn(begin, end); grain 为最小块大小.
+        // 调用线程只执行本次调用的块, 不会代为执行队列中无关的任务, 因此不会被长时间的异步任务拖住
+        template <typename F>
+        void For(size_t count, F &&fn, size_t grain = 4096)
+        {
+            if (count == 0)
+                return;
+            ThreadPool &pool = ThreadPool::Instance();
+            grain = std::max<size_t>(grain, 1);
+            size_t chunks = std::min((count + grain - 1) / grain, static_cast<size_t>(pool.Concurrency()) * 4);
+            if (chunks <= 1 || pool.Concurrency() == 1)
+            {
+                fn(size_t(0), count);
+                return;
+            }
+
+            auto state = std::make_shared<Detail::ForState>();
+            state->count = count;
+            state->chunks = chunks;
+            state->chunkSize = (count + chunks - 1) / chunks;
+            auto *body = &fn;
+            unsigned helpers = static_cast<unsigned>(std::min<size_t>(chunks - 1, pool.Concurrency() - 1));
+            for (unsigned i = 0; i < helpers; ++i)
+                pool.Submit([state, body]
+                            { Detail::RunChunks(*state, body); });
+            Detail::RunChunks(*state, body);
+            // 所有块都已被认领; 等待其他线程上正在执行的块完成. 被认领的块一定在运行中, 嵌套调用不会死锁
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->cv.wait(lock, [&]
+                               { return state->done.load(std::memory_order_acquire) == chunks; });
+            }
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+
+        // 分块归约: map(begin, end) 计算块内结果, 再按块顺序 reduce. 块长固定为 grain,
+        // 块的划分与线程数无关, 浮点结果与调度和线程数都无关
+        template <typename T, typename MapFn, typename ReduceFn>
+        T Reduce(size_t count, const T &identity, MapFn &&map, ReduceFn &&reduce, size_t grain = 4096)
+        {
+            if (count == 0)
+                return identity;
+            size_t blockSize = std::max<size_t>(grain, 1);
+            size_t blocks = (count + blockSize - 1) / blockSize;
+            std::vector<T> partial(blocks, identity);
+            For(
+                blocks, [&](size_t b, size_t e)
+                {
+                    for (size_t k = b; k < e; ++k)
+                    {
+                        size_t lo = k * blockSize, hi = std::min(count, lo + blockSize);
+                        if (lo < hi)
+                            partial[k] = map(lo, hi);
+                    } },
+                1);
+            T result = identity;
+            for (const T &p : partial)
+                result = reduce(result, p);
+            return result;
+        }
+    }
+    // ====================== 异步任务 ======================
+    namespace Async
+    {
+        namespace Detail
+        {
+            struct StateBase
+            {
+                std::mutex mutex;
+                std::condition_variable cv;
+                bool done = false;
+                std::exception_ptr error;
+                std::vector<std::function<void()>> continuations;
+                std::atomic<bool> cancelled{false};
+                std::atomic<real> progress{0};
+                std::function<void()> body;             // 可以开始但尚未被认领的任务函数
+                bool claimed = false;                   // body 是否已被某个线程认领
+                std::shared_ptr<StateBase> dependency; // Then 产生的任务依赖的前驱
+
+                void SetBody(std::function<void()> fn)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    body = std::move(fn);
+                }
+                // 在当前线程认领并执行尚未开始的任务函数; 已被认领或尚不能开始时返回 false
+                bool TryRun()
+                {
+                    std::function<void()> fn;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (claimed || !body)
+                            return false;
+                        claimed = true;
+                        fn.swap(body);
+                    }
+                    fn();
+                    return true;
+                }
+
+                // 已完成时不登记并返回 false
+                bool AddContinuation(std::function<void()> fn)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done)
+                        return false;
+                    continuations.push_back(std::move(fn));
+                    return true;
+                }
+                void Finish()
+                {
+                    std::vector<std::function<void()>> pending;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        done = true;
+                        pending.swap(continuations);
+                    }
+                    cv.notify_all();
+                    for (auto &fn : pending)
+                        fn();
+                }
+            };
+
+            template <typename T>
+            struct State : StateBase
+            {
+                std::unique_ptr<T> value;
+            };
+        }
+
+        // 任务函数的上下文: 查询取消请求、汇报进度
+        class JobContext
+        {
+        public:
+            explicit JobContext(Detail::StateBase &state) : state(state) {}
+            bool IsCancelled() const { return state.cancelled.load(std::memory_order_relaxed); }
+            void SetProgress(real fraction) { state.progress.store(fraction, std::memory_order_relaxed); }
+
+        private:
+            Detail::StateBase &state;
+        };
+
+        namespace Detail
+        {
+            // 执行任务函数并写入结果; 取消时以 "Task cancelled" 作为异常结果
+            template <typename U, typename F>
+            void Execute(State<U> &target, F &&fn)
+            {
+                JobContext ctx(target);
+                try
+                {
+                    if (ctx.IsCancelled())
+                        throw("Task cancelled");
+                    U result = fn(ctx);
+                    if (ctx.IsCancelled())
+                        throw("Task cancelled");
+                    target.value.reset(new U(std::move(result)));
+                    target.progress.store(1);
+                }
+                catch (...)
+                {
+                    target.error = std::current_exception();
+                }
+                target.Finish();
+            }
+        }
+
+        // 在全局线程池上运行的任务句柄, 可 Wait / Get, 也可在 C++20 协程中 co_await
+        // (协程在完成任务的线程上恢复). T 不能为 void
+        template <typename T>
+        class Task
+        {
+        public:
+            Task() = default;
+            explicit Task(std::shared_ptr<Detail::State<T>> state) : state(std::move(state)) {}
+
+            bool Valid() const { return state != nullptr; }
+            bool Ready() const
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                return state->done;
+            }
+            // 等待期间若本任务 (或 Then 链上的前驱) 尚未开始, 就在当前线程直接执行它;
+            // 不会代为执行线程池中无关的任务
+            void Wait() const
+            {
+                while (!Ready())
+                {
+                    bool ran = false;
+                    for (Detail::StateBase *s = state.get(); s && !ran; s = s->dependency.get())
+                        ran = s->TryRun();
+                    if (ran)
+                        continue;
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    state->cv.wait_for(lock, std::chrono::milliseconds(1), [this]
+                                       { return state->done; });
+                }
+            }
+            // 任务抛出的异常 (包括取消时的 "Task cancelled") 在此重新抛出
+            T &Get()
+            {
+                Wait();
+                if (state->error)
+                    std::rethrow_exception(state->error);
+                return *state->value;
+            }
+            void Cancel() { state->cancelled.store(true); }
+            bool IsCancelled() const { return state->cancelled.load(); }
+            real Progress() const { return state->progress.load(std::memory_order_relaxed); }
+
+            // 流水线: 本任务完成后在线程池上执行 fn(result, ctx)
+            template <typename F>
+            auto Then(F &&fn) -> Task<decltype(fn(std::declval<T &>(), std::declval<JobContext &>()))>
+            {
+                using U = decltype(fn(std::declval<T &>(), std::declval<JobContext &>()));
+                auto next = std::make_shared<Detail::State<U>>();
+                auto prev = state;
+                next->dependency = prev;
+                auto launch = [next, prev, fn = std::forward<F>(fn)]() mutable
+                {
+                    next->SetBody([target = next.get(), prev, fn]() mutable
+                                  {
+                        if (prev->error)
+                        {
+                            target->error = prev->error;
+                            target->Finish();
+                            return;
+                        }
+                        Detail::Execute(*target, [&](JobContext &ctx) { return fn(*prev->value, ctx); }); });
+                    Parallel::ThreadPool::Instance().Submit([next]
+                                                            { next->TryRun(); });
+                };
+                if (!state->AddContinuation(launch))
+                    launch();
+                return Task<U>(next);
+            }
+
+            // 协程支持
+            bool await_ready() const { return Ready(); }
+            template <typename Handle>
+            bool await_suspend(Handle handle)
+            {
+                return state->AddContinuation([handle]() mutable
+                                              { handle.resume(); });
+            }
+            // 返回结果的副本, 之后仍可 Get
+            T await_resume()
+            {
+                if (state->error)
+                    std::rethrow_exception(state->error);
+                return *state->value;
+            }
+
+        private:
+            std::shared_ptr<Detail::State<T>> state;
+        };
+
+        // 在线程池上异步执行 fn(JobContext &), 立即返回任务句柄
+        template <typename F>
+        auto Run(F &&fn) -> Task<decltype(fn(std::declval<JobContext &>()))>
+        {
+            using T = decltype(fn(std::declval<JobContext &>()));
+            auto state = std::make_shared<Detail::State<T>>();
+            // body 只捕获裸指针, 避免 state 自引用; 执行者 (线程池任务或 Wait) 持有 state
+            state->SetBody([target = state.get(), fn = std::forward<F>(fn)]() mutable
+                           { Detail::Execute(*target, fn); });
+            Parallel::ThreadPool::Instance().Submit([state]
+                                                    { state->TryRun(); });
+            return Task<T>(state);
+        }
+    }
+    // ====================== 2D 几何工具 ======================
+    namespace Geometry2D
+    {
+
+        real Distance(const Vec2 &a, const Vec2 &b)
+        {
+            Vec2 d = a - b;
+            return d.length();
+        }
+        real DistanceSquared(const Vec2 &a, const Vec2 &b)
+        {
+            Vec2 d = a - b;
+            return d.lengthSquared();
+        }
+        Vec2 ClosestPointOnLineSegment(const Vec2 &a, const Vec2 &b, const Vec2 &p)
+        {
+            Vec2 ab = b - a;
+            real t = (p - a).dot(ab) / ab.lengthSquared();
+            t = MathTools::Clamp(t, 0, 1);
+            return a + ab * t;
+        }
+        real DistancePointToLine(const Vec2 &a, const Vec2 &b, const Vec2 &p)
+        {
+            Vec2 ab = b - a;
+            Vec2 ap = p - a;
+
+            real crossProduct = std::abs(ab.cross(ap));
+            real lineLength = ab.length();
+            if (lineLength < Constants::Epsilon)
+            {
+                return ap.length();
+            }
+            return crossProduct / lineLength;
+        }
+
+        // 线段到线段的距离
+        real DistanceLineToLine(const Vec2 &a, const Vec2 &b, const Vec2 &c, const Vec2 &d)
+        {
+            Vec2 ab = b - a;
+            Vec2 cd = d - c;
+
+            auto Cross = [](const Vec2 &u, const Vec2 &v)
+            {
+                return u.x * v.y - u.y * v.x;
+            };
+
+            // 判断 q 是否在 pr 线段上
+            auto OnSegment = [](const Vec2 &p, const Vec2 &q, const Vec2 &r)
+            {
+                return (q.x >= std::min(p.x, r.x) - Constants::Epsilon &&
+                        q.x <= std::max(p.x, r.x) + Constants::Epsilon &&
+                        q.y >= std::min(p.y, r.y) - Constants::Epsilon &&
+                        q.y <= std::max(p.y, r.y) + Constants::Epsilon);
+            };
+
+            real d1 = Cross(cd, a - c);
+            real d2 = Cross(cd, b - c);
+            real d3 = Cross(ab, c - a);
+            real d4 = Cross(ab, d - a);
+
+            // 严格相交
+            if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) &&
+                ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+            {
+                return 0.0;
+            }
+
+            if (std::abs(Cross(ab, cd)) < Constants::Epsilon)
+            {
+                if (std::abs(Cross(ab, c - a)) < Constants::Epsilon)
+                {
+                    // 共线
+                    if (OnSegment(a, c, b) || OnSegment(a, d, b) ||
+                        OnSegment(c, a, d) || OnSegment(c, b, d))
+                    {
+                        return 0.0;
+                    }
+                }
+                // 平行但不共线
+                return DistancePointToLine(a, b, c);
+            }
+
+            // 不相交、不平行
+            real dist1 = DistancePointToLine(c, d, a);
+            real dist2 = DistancePointToLine(c, d, b);
+            real dist3 = DistancePointToLine(a, b, c);
+            real dist4 = DistancePointToLine(a, b, d);
+
+            return std::min(std::min(dist1, dist2), std::min(dist3, dist4));
+        }
+
+        // 直线: 过 point, 方向为单位向量 direction
+        struct Line
+        {
+            Vec2 point;
+            Vec2 direction{1, 0};
+            real Distance(const Vec2 &p) const { return std::abs(direction.cross(p - point)); }
+        };
+        struct Circle
+        {
+            Vec2 center;
+            real radius = 0;
+            real Distance(const Vec2 &p) const { return std::abs((p - center).length() - radius); }
+            bool Contains(const Vec2 &p) const { return (p - center).lengthSquared() <= radius * radius; }
+        };
+
+        // 轴对齐包围盒, 默认为空盒 (min > max)
+        struct AABB
+        {
+            Vec2 min{std::numeric_limits<real>::max(), std::numeric_limits<real>::max()};
+            Vec2 max{std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest()};
+
+            AABB() = default;
+            AABB(const Vec2 &min, const Vec2 &max) : min(min), max(max) {}
+
+            bool IsEmpty() const { return min.x > max.x || min.y > max.y; }
+            void Expand(const Vec2 &p)
+            {
+                min = {std::min(min.x, p.x), std::min(min.y, p.y)};
+                max = {std::max(max.x, p.x), std::max(max.y, p.y)};
+            }
+            void Expand(const AABB &o)
+            {
+                min = {std::min(min.x, o.min.x), std::min(min.y, o.min.y)};
+                max = {std::max(max.x, o.max.x), std::max(max.y, o.max.y)};
+            }
+            Vec2 Center() const { return (min + max) * 0.5f; }
+            Vec2 Size() const { return max - min; }
+            real Area() const { return IsEmpty() ? 0 : (max.x - min.x) * (max.y - min.y); }
+            bool Contains(const Vec2 &p) const { return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y; }
+            bool Contains(const AABB &o) const { return o.min.x >= min.x && o.max.x <= max.x && o.min.y >= min.y && o.max.y <= max.y; }
+            bool Intersects(const AABB &o) const { return o.min.x <= max.x && o.max.x >= min.x && o.min.y <= max.y && o.max.y >= min.y; }
+            // 点到盒的距离平方, 盒内为 0
+            real DistanceSquared(const Vec2 &p) const
+            {
+                real dx = std::max(std::max(min.x - p.x, p.x - max.x), real(0));
+                real dy = std::max(std::max(min.y - p.y, p.y - max.y), real(0));
+                return dx * dx + dy * dy;
+            }
+        };
+
+        // 有向包围盒: 中心 + 两条单位正交轴 + 沿各轴的半长
+        struct OBB
+        {
+            Vec2 center;
+            Vec2 axes[2]{{1, 0}, {0, 1}};
+            Vec2 halfExtents;
+
+            real Area() const { return 4 * halfExtents.x * halfExtents.y; }
+            bool Contains(const Vec2 &p) const
+            {
+                Vec2 d = p - center;
+                return std::abs(d.dot(axes[0])) <= halfExtents.x && std::abs(d.dot(axes[1])) <= halfExtents.y;
+            }
+        };
+
+        // 三点外接圆, 三点共线时返回 false
+        inline bool Circumcircle(const Vec2 &a, const Vec2 &b, const Vec2 &c, Circle &out)
+        {
+            Vec2 ab = b - a, ac = c - a;
+            real d = 2 * ab.cross(ac);
+            if (std::abs(d) < Constants::Epsilon * (ab.lengthSquared() + ac.lengthSquared()))
+                return false;
+            real ab2 = ab.lengthSquared(), ac2 = ac.lengthSquared();
+            Vec2 offset{(ac.y * ab2 - ab.y * ac2) / d, (ab.x * ac2 - ac.x * ab2) / d};
+            out.center = a + offset;
+            out.radius = offset.length();
+            return true;
+        }
+
+        // 延迟批量查询: 调用方先登记查询及结果地址, Flush 时按 (类型, Morton 码) 排序,
+        // 以 SoA 小块并行计算后写回; 结果地址在 Flush 之前必须保持有效
+        class QueryBatch
+        {
+        public:
+            void Distance(const Vec2 &a, const Vec2 &b, real *out) { Push(Kind::Distance, a, b, {}, {}, out); }
+            void DistanceSquared(const Vec2 &a, const Vec2 &b, real *out) { Push(Kind::DistanceSquared, a, b, {}, {}, out); }
+            void ClosestPointOnLineSegment(const Vec2 &a, const Vec2 &b, const Vec2 &p, Vec2 *out) { Push(Kind::ClosestPoint, p, a, b, {}, out); }
+            void DistancePointToLine(const Vec2 &a, const Vec2 &b, const Vec2 &p, real *out) { Push(Kind::PointToLine, p, a, b, {}, out); }
+            void DistanceLineToLine(const Vec2 &a, const Vec2 &b, const Vec2 &c, const Vec2 &d, real *out) { Push(Kind::LineToLine, a, b, c, d, out); }
+
+            size_t Size() const { return queries.size(); }
+            void Reserve(size_t n) { queries.reserve(n); }
+            void Clear() { queries.clear(); }
+
+            void Flush()
+            {
+                size_t n = queries.size();
+                if (n == 0)
+                    return;
+                Vec2 mn = queries[0].p[0], mx = mn;
+                for (const Query &q : queries)
+                {
+                    mn = {std::min(mn.x, q.p[0].x), std::min(mn.y, q.p[0].y)};
+                    mx = {std::max(mx.x, q.p[0].x), std::max(mx.y, q.p[0].y)};
+                }
+                real sx = 65535 / std::max(mx.x - mn.x, Constants::Epsilon);
+                real sy = 65535 / std::max(mx.y - mn.y, Constants::Epsilon);
+                for (Query &q : queries)
+                {
+                    uint32_t code = MathTools::Morton2D(static_cast<uint32_t>((q.p[0].x - mn.x) * sx), static_cast<uint32_t>((q.p[0].y - mn.y) * sy));
+                    q.key = (static_cast<uint64_t>(q.kind) << 32) | code;
+                }
+                std::sort(queries.begin(), queries.end(), [](const Query &a, const Query &b)
+                          { return a.key < b.key; });
+
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        while (b < e)
+                        {
+                            size_t run = b + 1;
+                            while (run < e && run - b < Block && queries[run].kind == queries[b].kind)
+                                ++run;
+                            ExecuteBlock(queries.data() + b, run - b);
+                            b = run;
+                        } },
+                    1024);
+                queries.clear();
+            }
+
+        private:
+            enum class Kind : uint32_t
+            {
+                Distance,
+                DistanceSquared,
+                ClosestPoint,
+                PointToLine,
+                LineToLine
+            };
+            struct Query
+            {
+                Vec2 p[4];
+                void *out;
+                Kind kind;
+                uint64_t key;
+            };
+            static constexpr size_t Block = 64;
+
+            void Push(Kind kind, const Vec2 &p0, const Vec2 &p1, const Vec2 &p2, const Vec2 &p3, void *out)
+            {
+                queries.push_back({{p0, p1, p2, p3}, out, kind, 0});
+            }
+
+            // 同类型的一小块查询: 先收集为 SoA, 无分支计算后再分散写回
+            static void ExecuteBlock(const Query *q, size_t count)
+            {
+                real px[Block], py[Block], ax[Block], ay[Block], bx[Block], by[Block], rx[Block], ry[Block];
+                for (size_t i = 0; i < count; ++i)
+                {
+                    px[i] = q[i].p[0].x;
+                    py[i] = q[i].p[0].y;
+                    ax[i] = q[i].p[1].x;
+                    ay[i] = q[i].p[1].y;
+                    bx[i] = q[i].p[2].x;
+                    by[i] = q[i].p[2].y;
+                }
+                switch (q[0].kind)
+                {
+                case Kind::Distance:
+                case Kind::DistanceSquared:
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        real dx = px[i] - ax[i], dy = py[i] - ay[i];
+                        rx[i] = dx * dx + dy * dy;
+                    }
+                    if (q[0].kind == Kind::Distance)
+                        for (size_t i = 0; i < count; ++i)
+                            rx[i] = std::sqrt(rx[i]);
+                    for (size_t i = 0; i < count; ++i)
+                        *static_cast<real *>(q[i].out) = rx[i];
+                    break;
+                }
+                case Kind::ClosestPoint:
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        real ex = bx[i] - ax[i], ey = by[i] - ay[i];
+                        real len2 = ex * ex + ey * ey;
+                        real t = ((px[i] - ax[i]) * ex + (py[i] - ay[i]) * ey) / (len2 > 0 ? len2 : 1);
+                        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+                        rx[i] = ax[i] + ex * t;
+                        ry[i] = ay[i] + ey * t;
+                    }
+                    for (size_t i = 0; i < count; ++i)
+                        *static_cast<Vec2 *>(q[i].out) = {rx[i], ry[i]};
+                    break;
+                }
+                case Kind::PointToLine:
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        real ex = bx[i] - ax[i], ey = by[i] - ay[i];
+                        real apx = px[i] - ax[i], apy = py[i] - ay[i];
+                        real len = std::sqrt(ex * ex + ey * ey);
+                        real cross = std::abs(ex * apy - ey * apx);
+                        rx[i] = len < Constants::Epsilon ? std::sqrt(apx * apx + apy * apy) : cross / len;
+                    }
+                    for (size_t i = 0; i < count; ++i)
+                        *static_cast<real *>(q[i].out) = rx[i];
+                    break;
+                }
+                case Kind::LineToLine:
+                    for (size_t i = 0; i < count; ++i)
+                        *static_cast<real *>(q[i].out) = Geometry2D::DistanceLineToLine(q[i].p[0], q[i].p[1], q[i].p[2], q[i].p[3]);
+                    break;
+                }
+            }
+
+            std::vector<Query> queries;
+        };
+
+        // 凸包 (Andrew 单调链), 逆时针输出且不含共线点; 点数较多时分块并行求局部凸包再合并
+        inline std::vector<Vec2> ConvexHull(const Vec2 *points, size_t n)
+        {
+            auto monotoneChain = [](std::vector<Vec2> &pts)
+            {
+                std::sort(pts.begin(), pts.end(), [](const Vec2 &a, const Vec2 &b)
+                          { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+                pts.erase(std::unique(pts.begin(), pts.end(), [](const Vec2 &a, const Vec2 &b)
+                                      { return a.x == b.x && a.y == b.y; }),
+                          pts.end());
+                if (pts.size() < 3)
+                    return pts;
+                std::vector<Vec2> hull(2 * pts.size());
+                size_t k = 0;
+                for (size_t i = 0; i < pts.size(); ++i)
+                {
+                    while (k >= 2 && (hull[k - 1] - hull[k - 2]).cross(pts[i] - hull[k - 2]) <= 0)
+                        --k;
+                    hull[k++] = pts[i];
+                }
+                for (size_t i = pts.size() - 1, lower = k + 1; i-- > 0;)
+                {
+                    while (k >= lower && (hull[k - 1] - hull[k - 2]).cross(pts[i] - hull[k - 2]) <= 0)
+                        --k;
+                    hull[k++] = pts[i];
+                }
+                hull.resize(k - 1);
+                return hull;
+            };
+
+            const size_t Chunk = 1 << 16;
+            if (n <= Chunk)
+            {
+                std::vector<Vec2> pts(points, points + n);
+                return monotoneChain(pts);
+            }
+            size_t chunks = (n + Chunk - 1) / Chunk;
+            std::vector<std::vector<Vec2>> partial(chunks);
+            Parallel::For(
+                chunks, [&](size_t b, size_t e)
+                {
+                    for (size_t c = b; c < e; ++c)
+                    {
+                        std::vector<Vec2> pts(points + c * Chunk, points + std::min(n, (c + 1) * Chunk));
+                        partial[c] = monotoneChain(pts);
+                    } },
+                1);
+            std::vector<Vec2> merged;
+            for (const auto &h : partial)
+                merged.insert(merged.end(), h.begin(), h.end());
+            return monotoneChain(merged);
+        }
+
+        // 全配对线段距离: 线段 i 为 (a[2i], a[2i+1]), 结果按行主序写入 out[i * nb + j]
+        inline void SegmentDistanceMatrix(const Vec2 *a, size_t na, const Vec2 *b, size_t nb, real *out)
+        {
+            Parallel::For(
+                na, [&](size_t lo, size_t hi)
+                {
+                    for (size_t i = lo; i < hi; ++i)
+                        for (size_t j = 0; j < nb; ++j)
+                            out[i * nb + j] = DistanceLineToLine(a[2 * i], a[2 * i + 1], b[2 * j], b[2 * j + 1]); },
+                std::max<size_t>(1, 4096 / std::max<size_t>(nb, 1)));
+        }
+
+        // 带洞多边形三角化 (y 单调分解 + 单调多边形栈扫描, O(n log n)); 无洞的小多边形直接耳切,
+        // 单调分解遇到退化输入 (三角形数不等于 n + 2h - 2) 时对无洞多边形回退到耳切.
+        // 对象内的工作区在多次调用间复用, 每帧重复三角化时不再分配
+        class Triangulator
+        {
+        public:
+            // 无洞且顶点数不超过此值时直接耳切
+            static constexpr size_t EarClipLimit = 32;
+
+            // points 为各环依次拼接, 环 k 为 [ringEnds[k - 1], ringEnds[k]); 环 0 为外环, 其余为洞, 方向任意.
+            // 三角形 (逆时针) 的顶点下标 + base 追加到 out, 返回三角形数
+            size_t Triangulate(const Vec2 *points, const uint32_t *ringEnds, size_t ringCount, std::vector<uint32_t> &out, uint32_t base = 0)
+            {
+                size_t start = out.size();
+                holes = Build(points, ringEnds, ringCount);
+                size_t n = pts.size();
+                if (n < 3)
+                    return 0;
+                if (holes == 0 && n <= EarClipLimit)
+                    EarClip(out, base);
+                else if (!Monotone(out, base) && holes == 0)
+                {
+                    out.resize(start);
+                    EarClip(out, base);
+                }
+                return (out.size() - start) / 3;
+            }
+            size_t Triangulate(const std::vector<std::vector<Vec2>> &rings, std::vector<uint32_t> &out, uint32_t base = 0)
+            {
+                flat.clear();
+                ends.clear();
+                for (const std::vector<Vec2> &ring : rings)
+                {
+                    flat.insert(flat.end(), ring.begin(), ring.end());
+                    ends.push_back(static_cast<uint32_t>(flat.size()));
+                }
+                return Triangulate(flat.data(), ends.data(), ends.size(), out, base);
+            }
+
+        private:
+            enum Kind : uint8_t
+            {
+                Start,
+                End,
+                Split,
+                Merge,
+                Regular
+            };
+            static constexpr uint32_t Probe = std::numeric_limits<uint32_t>::max();
+
+            // 扫描线状态中的边 (以上端点编号), 按当前扫描线处的 x 排序
+            struct EdgeLess
+            {
+                const Triangulator *t;
+                bool operator()(uint32_t a, uint32_t b) const
+                {
+                    real xa = t->EdgeX(a), xb = t->EdgeX(b);
+                    if (xa != xb)
+                        return xa < xb;
+                    if (a == Probe || b == Probe)
+                        return false;
+                    real c = (t->pts[t->nxt[a]] - t->pts[a]).cross(t->pts[t->nxt[b]] - t->pts[b]);
+                    return c != 0 ? c > 0 : a < b;
+                }
+            };
+
+            std::vector<Vec2> pts, flat;
+            std::vector<uint32_t> ends, id, nxt, prv, order, rank, helper, face, chainL, chainR, sorted, stack;
+            std::vector<uint8_t> kind, side, used;
+            std::vector<std::pair<uint32_t, uint32_t>> diagonals;
+            std::vector<uint32_t> outBegin, outEdges;
+            std::vector<real> outAngle;
+            real sweepX = 0, sweepY = 0;
+            size_t holes = 0;
+
+            // 建立去重后的环形链表, 外环调整为逆时针, 洞为顺时针; 返回有效洞数
+            size_t Build(const Vec2 *points, const uint32_t *ringEnds, size_t ringCount)
+            {
+                pts.clear();
+                id.clear();
+                nxt.clear();
+                prv.clear();
+                size_t count = 0;
+                for (size_t k = 0, begin = 0; k < ringCount; begin = ringEnds[k++])
+                {
+                    uint32_t first = static_cast<uint32_t>(pts.size());
+                    for (size_t i = begin; i < ringEnds[k]; ++i)
+                    {
+                        bool dup = pts.size() > first && (pts.back() - points[i]).lengthSquared() == 0;
+                        if (!dup)
+                        {
+                            pts.push_back(points[i]);
+                            id.push_back(static_cast<uint32_t>(i));
+                        }
+                    }
+                    while (pts.size() > first + 1u && (pts.back() - pts[first]).lengthSquared() == 0)
+                    {
+                        pts.pop_back();
+                        id.pop_back();
+                    }
+                    size_t m = pts.size() - first;
+                    real area = 0;
+                    for (size_t i = 0; i < m; ++i)
+                        area += pts[first + i].cross(pts[first + (i + 1) % m]);
+                    if (m < 3 || area == 0)
+                    {
+                        if (k == 0)
+                        {
+                            pts.clear();
+                            return 0;
+                        }
+                        pts.resize(first);
+                        id.resize(first);
+                        continue;
+                    }
+                    bool forward = (area > 0) == (k == 0);
+                    for (size_t i = 0; i < m; ++i)
+                    {
+                        uint32_t a = first + static_cast<uint32_t>((i + 1) % m), b = first + static_cast<uint32_t>((i + m - 1) % m);
+                        nxt.push_back(forward ? a : b);
+                        prv.push_back(forward ? b : a);
+                    }
+                    count += k > 0;
+                }
+                return count;
+            }
+
+            void Emit(std::vector<uint32_t> &out, uint32_t base, uint32_t a, uint32_t b, uint32_t c) const
+            {
+                if ((pts[b] - pts[a]).cross(pts[c] - pts[a]) < 0)
+                    std::swap(b, c);
+                out.push_back(base + id[a]);
+                out.push_back(base + id[b]);
+                out.push_back(base + id[c]);
+            }
+
+            // 单环耳切, O(n^2); 找不到耳朵 (退化) 时强行切去当前顶点以保证结束
+            void EarClip(std::vector<uint32_t> &out, uint32_t base)
+            {
+                face.assign(1, 0);
+                for (uint32_t v = nxt[0]; v != 0; v = nxt[v])
+                    face.push_back(v);
+                size_t i = 0, misses = 0;
+                while (face.size() > 3)
+                {
+                    size_t m = face.size();
+                    uint32_t a = face[(i + m - 1) % m], b = face[i % m], c = face[(i + 1) % m];
+                    bool ear = (pts[b] - pts[a]).cross(pts[c] - pts[b]) > 0;
+                    for (size_t k = 0; ear && k < m; ++k)
+                    {
+                        uint32_t p = face[k];
+                        if (p == a || p == b || p == c)
+                            continue;
+                        ear = !((pts[b] - pts[a]).cross(pts[p] - pts[a]) >= 0 && (pts[c] - pts[b]).cross(pts[p] - pts[b]) >= 0 && (pts[a] - pts[c]).cross(pts[p] - pts[c]) >= 0);
+                    }
+                    if (ear || misses > m)
+                    {
+                        Emit(out, base, a, b, c);
+                        face.erase(face.begin() + static_cast<ptrdiff_t>(i % m));
+                        misses = 0;
+                        i = i % m == 0 ? 0 : i % m - 1;
+                    }
+                    else
+                    {
+                        ++misses;
+                        i = (i + 1) % m;
+                    }
+                }
+                Emit(out, base, face[0], face[1], face[2]);
+            }
+
+            real EdgeX(uint32_t e) const
+            {
+                if (e == Probe)
+                    return sweepX;
+                const Vec2 &a = pts[e], &b = pts[nxt[e]];
+                if (a.y == b.y)
+                    return std::min(std::max(sweepX, std::min(a.x, b.x)), std::max(a.x, b.x));
+                return a.x + (sweepY - a.y) / (b.y - a.y) * (b.x - a.x);
+            }
+
+            // 分解为 y 单调子多边形并逐个三角化; 三角形总数不符时返回 false
+            bool Monotone(std::vector<uint32_t> &out, uint32_t base)
+            {
+                size_t n = pts.size(), start = out.size();
+                order.resize(n);
+                rank.resize(n);
+                kind.resize(n);
+                helper.assign(n, 0);
+                diagonals.clear();
+                for (uint32_t v = 0; v < n; ++v)
+                    order[v] = v;
+                std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                          { return pts[a].y > pts[b].y || (pts[a].y == pts[b].y && (pts[a].x < pts[b].x || (pts[a].x == pts[b].x && a < b))); });
+                for (uint32_t r = 0; r < n; ++r)
+                    rank[order[r]] = r;
+                for (uint32_t v = 0; v < n; ++v)
+                {
+                    bool prevBelow = rank[prv[v]] > rank[v], nextBelow = rank[nxt[v]] > rank[v];
+                    bool convex = (pts[v] - pts[prv[v]]).cross(pts[nxt[v]] - pts[v]) >= 0;
+                    kind[v] = prevBelow && nextBelow ? (convex ? Start : Split) : (!prevBelow && !nextBelow ? (convex ? End : Merge) : Regular);
+                }
+
+                std::set<uint32_t, EdgeLess> status(EdgeLess{this});
+                std::vector<std::set<uint32_t, EdgeLess>::iterator> where(n, status.end());
+                auto link = [&](uint32_t v, uint32_t h)
+                {
+                    diagonals.push_back({v, h});
+                };
+                auto fixMerge = [&](uint32_t v, uint32_t e)
+                {
+                    if (kind[helper[e]] == Merge)
+                        link(v, helper[e]);
+                };
+                auto insert = [&](uint32_t v)
+                {
+                    where[v] = status.insert(v).first;
+                    helper[v] = v;
+                };
+                auto erase = [&](uint32_t e)
+                {
+                    if (where[e] != status.end())
+                        status.erase(where[e]);
+                    where[e] = status.end();
+                };
+                auto left = [&](uint32_t &e)
+                {
+                    auto it = status.lower_bound(Probe);
+                    if (it == status.begin())
+                        return false;
+                    e = *--it;
+                    return true;
+                };
+                for (uint32_t v : order)
+                {
+                    sweepX = pts[v].x;
+                    sweepY = pts[v].y;
+                    uint32_t p = prv[v], e;
+                    switch (kind[v])
+                    {
+                    case Start:
+                        insert(v);
+                        break;
+                    case End:
+                        fixMerge(v, p);
+                        erase(p);
+                        break;
+                    case Split:
+                        if (!left(e))
+                            return false;
+                        link(v, helper[e]);
+                        helper[e] = v;
+                        insert(v);
+                        break;
+                    case Merge:
+                        fixMerge(v, p);
+                        erase(p);
+                        if (!left(e))
+                            return false;
+                        fixMerge(v, e);
+                        helper[e] = v;
+                        break;
+                    default:
+                        if (rank[p] < rank[v])
+                        {
+                            // 左链 (向下), 内部在右侧
+                            fixMerge(v, p);
+                            erase(p);
+                            insert(v);
+                        }
+                        else
+                        {
+                            if (!left(e))
+                                return false;
+                            fixMerge(v, e);
+                            helper[e] = v;
+                        }
+                    }
+                }
+                Faces(out, base);
+                return out.size() - start == 3 * (n + 2 * holes - 2);
+            }
+
+            // 以对角线切分后逐面遍历: 半边 v -> nxt[v] 编号为 v, 对角线 k 的两个方向为 n + 2k, n + 2k + 1;
+            // 在终点处取从反向顺时针方向遇到的第一条出边, 得到内部在左侧的面
+            void Faces(std::vector<uint32_t> &out, uint32_t base)
+            {
+                uint32_t n = static_cast<uint32_t>(pts.size()), halfEdges = n + 2 * static_cast<uint32_t>(diagonals.size());
+                auto from = [&](uint32_t h)
+                { return h < n ? h : ((h - n) & 1 ? diagonals[(h - n) >> 1].second : diagonals[(h - n) >> 1].first); };
+                auto to = [&](uint32_t h)
+                { return h < n ? nxt[h] : ((h - n) & 1 ? diagonals[(h - n) >> 1].first : diagonals[(h - n) >> 1].second); };
+                outBegin.assign(n + 1, 0);
+                for (uint32_t h = 0; h < halfEdges; ++h)
+                    ++outBegin[from(h) + 1];
+                for (uint32_t v = 0; v < n; ++v)
+                    outBegin[v + 1] += outBegin[v];
+                outEdges.resize(halfEdges);
+                outAngle.resize(halfEdges);
+                {
+                    std::vector<uint32_t> fill(outBegin.begin(), outBegin.end() - 1);
+                    for (uint32_t h = 0; h < halfEdges; ++h)
+                        outEdges[fill[from(h)]++] = h;
+                }
+                for (uint32_t v = 0; v < n; ++v)
+                {
+                    if (outBegin[v + 1] - outBegin[v] < 2)
+                        continue;
+                    auto angle = [&](uint32_t h)
+                    {
+                        Vec2 d = pts[to(h)] - pts[v];
+                        return std::atan2(d.y, d.x);
+                    };
+                    std::sort(outEdges.begin() + outBegin[v], outEdges.begin() + outBegin[v + 1], [&](uint32_t a, uint32_t b)
+                              { return angle(a) < angle(b); });
+                    for (uint32_t k = outBegin[v]; k < outBegin[v + 1]; ++k)
+                        outAngle[k] = angle(outEdges[k]);
+                }
+                auto next = [&](uint32_t h)
+                {
+                    uint32_t v = to(h), b = outBegin[v], e = outBegin[v + 1];
+                    if (e - b == 1)
+                        return outEdges[b];
+                    Vec2 d = pts[from(h)] - pts[v];
+                    real back = std::atan2(d.y, d.x);
+                    uint32_t k = static_cast<uint32_t>(std::lower_bound(outAngle.begin() + b, outAngle.begin() + e, back) - outAngle.begin());
+                    return outEdges[k == b ? e - 1 : k - 1];
+                };
+                used.assign(halfEdges, 0);
+                for (uint32_t h0 = 0; h0 < halfEdges; ++h0)
+                {
+                    if (used[h0])
+                        continue;
+                    face.clear();
+                    for (uint32_t h = h0; !used[h] && face.size() <= halfEdges; h = next(h))
+                    {
+                        used[h] = 1;
+                        face.push_back(from(h));
+                    }
+                    if (face.size() >= 3)
+                        MonotoneFace(out, base);
+                }
+            }
+
+            // 单调多边形 (face 为逆时针顶点环) 的栈扫描三角化
+            void MonotoneFace(std::vector<uint32_t> &out, uint32_t base)
+            {
+                size_t m = face.size();
+                if (m == 3)
+                {
+                    Emit(out, base, face[0], face[1], face[2]);
+                    return;
+                }
+                size_t top = 0, bottom = 0;
+                for (size_t i = 1; i < m; ++i)
+                {
+                    top = rank[face[i]] < rank[face[top]] ? i : top;
+                    bottom = rank[face[i]] > rank[face[bottom]] ? i : bottom;
+                }
+                // 逆时针从最高点向前走到最低点为左链, 向后走为右链; 两链按扫描次序归并
+                chainL.clear();
+                chainR.clear();
+                for (size_t i = top; i != bottom; i = (i + 1) % m)
+                    chainL.push_back(face[i]);
+                for (size_t i = (top + m - 1) % m; i != bottom; i = (i + m - 1) % m)
+                    chainR.push_back(face[i]);
+                sorted.clear();
+                side.resize(pts.size());
+                size_t a = 0, b = 0;
+                while (a < chainL.size() || b < chainR.size())
+                {
+                    bool takeL = b == chainR.size() || (a < chainL.size() && rank[chainL[a]] < rank[chainR[b]]);
+                    uint32_t v = takeL ? chainL[a++] : chainR[b++];
+                    side[v] = takeL ? 0 : 1;
+                    sorted.push_back(v);
+                }
+                sorted.push_back(face[bottom]);
+                side[face[bottom]] = 2;
+
+                stack.assign(sorted.begin(), sorted.begin() + 2);
+                for (size_t j = 2; j < m; ++j)
+                {
+                    uint32_t u = sorted[j];
+                    if (j == m - 1 || side[u] != side[stack.back()])
+                    {
+                        for (size_t k = 0; k + 1 < stack.size(); ++k)
+                            Emit(out, base, u, stack[k], stack[k + 1]);
+                        uint32_t last = stack.back();
+                        stack.assign(1, last);
+                        stack.push_back(u);
+                        continue;
+                    }
+                    uint32_t last = stack.back();
+                    stack.pop_back();
+                    while (!stack.empty())
+                    {
+                        uint32_t second = stack.back();
+                        real turn = side[u] == 0 ? (pts[last] - pts[second]).cross(pts[u] - pts[last]) : (pts[last] - pts[u]).cross(pts[second] - pts[last]);
+                        if (turn <= 0)
+                            break;
+                        Emit(out, base, second, last, u);
+                        last = second;
+                        stack.pop_back();
+                    }
+                    stack.push_back(last);
+                    stack.push_back(u);
+                }
+            }
+        };
+
+        // 单个多边形 (可带洞) 的三角化, 返回三角形顶点下标 (逆时针, 下标为各环依次拼接后的编号)
+        inline std::vector<uint32_t> Triangulate(const std::vector<std::vector<Vec2>> &rings)
+        {
+            Triangulator t;
+            std::vector<uint32_t> out;
+            t.Triangulate(rings, out);
+            return out;
+        }
+        inline std::vector<uint32_t> Triangulate(const std::vector<Vec2> &polygon)
+        {
+            uint32_t end = static_cast<uint32_t>(polygon.size());
+            Triangulator t;
+            std::vector<uint32_t> out;
+            t.Triangulate(polygon.data(), &end, 1, out);
+            return out;
+        }
+
+        // 批量三角化的结果: 多边形 i 的索引为 indices[offsets[i], offsets[i + 1]);
+        // 重复使用同一对象时沿用已分配的容量
+        struct IndexBuffer
+        {
+            std::vector<uint32_t> indices;
+            std::vector<size_t> offsets{0};
+
+            size_t Size() const { return offsets.size() - 1; }
+            void Clear()
+            {
+                indices.clear();
+                offsets.assign(1, 0);
+            }
+        };
+
+        namespace Detail
+        {
+            // polygons[0, count) 的结果追加到 out; 分块并行, 每个线程复用自己的 Triangulator
+            inline void TriangulateInto(const std::vector<std::vector<Vec2>> *polygons, size_t count, IndexBuffer &out)
+            {
+                const size_t Chunk = 64;
+                size_t chunks = (count + Chunk - 1) / Chunk;
+                std::vector<std::vector<uint32_t>> parts(chunks);
+                std::vector<size_t> sizes(count);
+                Parallel::For(
+                    chunks, [&](size_t b, size_t e)
+                    {
+                        thread_local Triangulator t;
+                        for (size_t c = b; c < e; ++c)
+                            for (size_t i = c * Chunk; i < std::min(count, (c + 1) * Chunk); ++i)
+                                sizes[i] = 3 * t.Triangulate(polygons[i], parts[c]); },
+                    1);
+                size_t total = out.indices.size();
+                for (const std::vector<uint32_t> &part : parts)
+                    total += part.size();
+                out.indices.reserve(total);
+                for (const std::vector<uint32_t> &part : parts)
+                    out.indices.insert(out.indices.end(), part.begin(), part.end());
+                for (size_t i = 0; i < count; ++i)
+                    out.offsets.push_back(out.offsets.back() + sizes[i]);
+            }
+        }
+
+        // 批量三角化上千个多边形 (每个多边形为 外环 + 洞 的环列表), 结果写入 out (覆盖)
+        inline void TriangulateMany(const std::vector<std::vector<std::vector<Vec2>>> &polygons, IndexBuffer &out)
+        {
+            out.Clear();
+            Detail::TriangulateInto(polygons.data(), polygons.size(), out);
+        }
+
+        // 折线简化方法: Douglas-Peucker 的容差为距离, Visvalingam-Whyatt 的容差为有效三角形面积
+        enum class SimplifyMethod
+        {
+            DouglasPeucker,
+            Visvalingam
+        };
+
+        namespace Detail
+        {
+            constexpr size_t SimplifyLanes = 8;
+
+            // (a, b) 之间离直线 ab 最远的点: 返回 cross^2 (ab 退化时为到 a 的距离平方乘 1), 下标写入 index;
+            // 按 Lanes 分组记录各组最大值后再归约, 循环无分支可向量化
+            inline real FarthestPoint(const Vec2 *pts, size_t a, size_t b, size_t &index)
+            {
+                real ax = pts[a].x, ay = pts[a].y, dx = pts[b].x - ax, dy = pts[b].y - ay;
+                bool degenerate = dx * dx + dy * dy == 0;
+                real best[SimplifyLanes];
+                size_t where[SimplifyLanes];
+                for (size_t l = 0; l < SimplifyLanes; ++l)
+                {
+                    best[l] = -1;
+                    where[l] = a;
+                }
+                size_t i = a + 1;
+                auto visit = [&](size_t l, size_t k)
+                {
+                    real px = pts[k].x - ax, py = pts[k].y - ay;
+                    real c = dx * py - dy * px;
+                    real m = degenerate ? px * px + py * py : c * c;
+                    bool better = m > best[l];
+                    best[l] = better ? m : best[l];
+                    where[l] = better ? k : where[l];
+                };
+                for (; i + SimplifyLanes <= b; i += SimplifyLanes)
+                    for (size_t l = 0; l < SimplifyLanes; ++l)
+                        visit(l, i + l);
+                for (size_t l = 0; i < b; ++i, ++l)
+                    visit(l, i);
+                size_t pick = 0;
+                for (size_t l = 1; l < SimplifyLanes; ++l)
+                    if (best[l] > best[pick] || (best[l] == best[pick] && where[l] < where[pick]))
+                        pick = l;
+                index = where[pick];
+                return best[pick];
+            }
+
+            // 迭代 Douglas-Peucker: 待处理区间放在显式工作表中, 不递归
+            inline void DouglasPeucker(const Vec2 *pts, size_t n, real tolerance, std::vector<uint32_t> &keep)
+            {
+                keep.clear();
+                if (n < 3)
+                {
+                    for (size_t i = 0; i < n; ++i)
+                        keep.push_back(static_cast<uint32_t>(i));
+                    return;
+                }
+                thread_local std::vector<uint8_t> marked;
+                thread_local std::vector<std::pair<size_t, size_t>> work;
+                marked.assign(n, 0);
+                marked[0] = marked[n - 1] = 1;
+                work.assign(1, {0, n - 1});
+                real tol2 = tolerance * tolerance;
+                while (!work.empty())
+                {
+                    size_t a = work.back().first, b = work.back().second, index;
+                    work.pop_back();
+                    if (b - a < 2)
+                        continue;
+                    real len2 = (pts[b] - pts[a]).lengthSquared();
+                    if (FarthestPoint(pts, a, b, index) <= tol2 * (len2 > 0 ? len2 : 1))
+                        continue;
+                    marked[index] = 1;
+                    work.push_back({index, b});
+                    work.push_back({a, index});
+                }
+                for (size_t i = 0; i < n; ++i)
+                    if (marked[i])
+                        keep.push_back(static_cast<uint32_t>(i));
+            }
+
+            inline real TriangleArea(const Vec2 &a, const Vec2 &b, const Vec2 &c) { return std::abs((b - a).cross(c - a)) * 0.5f; }
+
+            // Visvalingam-Whyatt: 按有效面积的索引最小堆逐个删点, 邻点面积变化时原位上浮/下沉;
+            // 邻点面积不小于刚删去点的面积, 保证删除次序单调
+            inline void Visvalingam(const Vec2 *pts, size_t n, real minArea, std::vector<uint32_t> &keep, size_t minPoints)
+            {
+                keep.clear();
+                thread_local std::vector<uint32_t> prev, next, heap, slot;
+                thread_local std::vector<real> area;
+                prev.resize(n);
+                next.resize(n);
+                slot.resize(n);
+                area.assign(n, 0);
+                heap.clear();
+                for (size_t i = 0; i < n; ++i)
+                {
+                    prev[i] = static_cast<uint32_t>(i - 1);
+                    next[i] = static_cast<uint32_t>(i + 1);
+                }
+                for (size_t i = 1; i + 1 < n; ++i)
+                {
+                    area[i] = TriangleArea(pts[i - 1], pts[i], pts[i + 1]);
+                    slot[i] = static_cast<uint32_t>(heap.size());
+                    heap.push_back(static_cast<uint32_t>(i));
+                }
+                auto less = [&](size_t a, size_t b)
+                { return area[heap[a]] < area[heap[b]] || (area[heap[a]] == area[heap[b]] && heap[a] < heap[b]); };
+                auto swapAt = [&](size_t a, size_t b)
+                {
+                    std::swap(heap[a], heap[b]);
+                    slot[heap[a]] = static_cast<uint32_t>(a);
+                    slot[heap[b]] = static_cast<uint32_t>(b);
+                };
+                auto up = [&](size_t k)
+                {
+                    for (; k > 0 && less(k, (k - 1) / 2); k = (k - 1) / 2)
+                        swapAt(k, (k - 1) / 2);
+                };
+                auto down = [&](size_t k)
+                {
+                    while (true)
+                    {
+                        size_t c = 2 * k + 1;
+                        if (c >= heap.size())
+                            return;
+                        if (c + 1 < heap.size() && less(c + 1, c))
+                            ++c;
+                        if (!less(c, k))
+                            return;
+                        swapAt(c, k);
+                        k = c;
+                    }
+                };
+                for (size_t k = heap.size() / 2; k-- > 0;)
+                    down(k);
+                size_t remaining = n;
+                minPoints = std::max<size_t>(minPoints, 2);
+                while (!heap.empty() && remaining > minPoints && area[heap[0]] < minArea)
+                {
+                    uint32_t i = heap[0];
+                    real removed = area[i];
+                    swapAt(0, heap.size() - 1);
+                    heap.pop_back();
+                    down(0);
+                    uint32_t p = prev[i], q = next[i];
+                    next[p] = q;
+                    prev[q] = p;
+                    --remaining;
+                    for (uint32_t k : {p, q})
+                    {
+                        if (k == 0 || k + 1 == n)
+                            continue;
+                        real before = area[k];
+                        area[k] = std::max(removed, TriangleArea(pts[prev[k]], pts[k], pts[next[k]]));
+                        if (area[k] < before)
+                            up(slot[k]);
+                        else
+                            down(slot[k]);
+                    }
+                }
+                for (size_t i = 0; i < n; i = next[i])
+                    keep.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        // 折线简化, keep 为保留点的下标 (升序, 含首尾); Visvalingam 至少保留 minPoints 个点,
+        // minArea 取无穷大即简化到恰好 minPoints 个点
+        inline void SimplifyDouglasPeucker(const Vec2 *points, size_t n, real tolerance, std::vector<uint32_t> &keep)
+        {
+            Detail::DouglasPeucker(points, n, tolerance, keep);
+        }
+        inline void SimplifyVisvalingam(const Vec2 *points, size_t n, real minArea, std::vector<uint32_t> &keep, size_t minPoints = 2)
+        {
+            Detail::Visvalingam(points, n, minArea, keep, minPoints);
+        }
+        inline std::vector<Vec2> SimplifyPolyline(const std::vector<Vec2> &polyline, real tolerance, SimplifyMethod method = SimplifyMethod::DouglasPeucker)
+        {
+            std::vector<uint32_t> keep;
+            if (method == SimplifyMethod::DouglasPeucker)
+                Detail::DouglasPeucker(polyline.data(), polyline.size(), tolerance, keep);
+            else
+                Detail::Visvalingam(polyline.data(), polyline.size(), tolerance, keep, 2);
+            std::vector<Vec2> out(keep.size());
+            for (size_t i = 0; i < keep.size(); ++i)
+                out[i] = polyline[keep[i]];
+            return out;
+        }
+
+        // 批量简化上千条折线, 线程间按折线分块; out 中已有的各条折线沿用已分配的容量
+        inline void SimplifyPolylines(const std::vector<std::vector<Vec2>> &polylines, real tolerance, std::vector<std::vector<Vec2>> &out,
+                                      SimplifyMethod method = SimplifyMethod::DouglasPeucker)
+        {
+            out.resize(polylines.size());
+            Parallel::For(
+                polylines.size(), [&](size_t b, size_t e)
+                {
+                    std::vector<uint32_t> keep;
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        const std::vector<Vec2> &line = polylines[i];
+                        if (method == SimplifyMethod::DouglasPeucker)
+                            Detail::DouglasPeucker(line.data(), line.size(), tolerance, keep);
+                        else
+                            Detail::Visvalingam(line.data(), line.size(), tolerance, keep, 2);
+                        out[i].resize(keep.size());
+                        for (size_t k = 0; k < keep.size(); ++k)
+                            out[i][k] = line[keep[k]];
+                    } },
+                16);
+        }
+
+        // ---------------- 异步版本 ----------------
+        inline Async::Task<std::vector<Vec2>> ConvexHullAsync(std::vector<Vec2> points)
+        {
+            return Async::Run([points = std::move(points)](Async::JobContext &)
+                              { return ConvexHull(points.data(), points.size()); });
+        }
+
+        // 按行块计算, 每完成一块调用 onRows(rowBegin, rowEnd), 调用方可边算边消费;
+        // 块之间检查取消请求并更新进度. 返回完成的行数; a / b / out 在任务结束前必须保持有效
+        inline Async::Task<size_t> SegmentDistanceMatrixAsync(const Vec2 *a, size_t na, const Vec2 *b, size_t nb, real *out,
+                                                              std::function<void(size_t, size_t)> onRows = {}, size_t rowsPerChunk = 256)
+        {
+            return Async::Run([=](Async::JobContext &ctx)
+                              {
+                size_t step = std::max<size_t>(rowsPerChunk, 1), row = 0;
+                for (; row < na && !ctx.IsCancelled(); row += step)
+                {
+                    size_t end = std::min(na, row + step);
+                    SegmentDistanceMatrix(a + 2 * row, end - row, b, nb, out + row * nb);
+                    if (onRows)
+                        onRows(row, end);
+                    ctx.SetProgress(static_cast<real>(end) / static_cast<real>(na));
+                }
+                return std::min(row, na); });
+        }
+
+        // 按块三角化到调用方的 out (先清空), 每完成一块在任务线程上调用 onPolygons(begin, end),
+        // 回调内可读取 out 中这些多边形的结果; 块之间检查取消请求并更新进度.
+        // 返回完成的多边形数; out 在任务结束前必须保持有效, 且回调之外不得访问
+        inline Async::Task<size_t> TriangulateManyAsync(std::vector<std::vector<std::vector<Vec2>>> polygons, IndexBuffer &out,
+                                                        std::function<void(size_t, size_t)> onPolygons = {}, size_t polygonsPerChunk = 256)
+        {
+            return Async::Run([polygons = std::move(polygons), &out, onPolygons, polygonsPerChunk](Async::JobContext &ctx)
+                              {
+                out.Clear();
+                size_t step = std::max<size_t>(polygonsPerChunk, 1), i = 0;
+                for (; i < polygons.size() && !ctx.IsCancelled(); i += step)
+                {
+                    size_t end = std::min(polygons.size(), i + step);
+                    Detail::TriangulateInto(polygons.data() + i, end - i, out);
+                    if (onPolygons)
+                        onPolygons(i, end);
+                    ctx.SetProgress(static_cast<real>(end) / static_cast<real>(polygons.size()));
+                }
+                return std::min(i, polygons.size()); });
+        }
+
+    }
+
+    // ====================== 3D 几何工具 ======================
+    namespace Geometry3D
+    {
+        // 平面 normal·p + d = 0, normal 为单位向量
+        struct Plane
+        {
+            Vec3 normal{0, 0, 1};
+            real d = 0;
+
+            static Plane FromPointNormal(const Vec3 &point, const Vec3 &normal)
+            {
+                Vec3 n = normal.normalize();
+                return {n, -n.dot(point)};
+            }
+            // 三点确定平面 (逆时针为正面), 退化时法向为零向量
+            static Plane FromPoints(const Vec3 &a, const Vec3 &b, const Vec3 &c)
+            {
+                return FromPointNormal(a, (b - a).cross(c - a));
+            }
+            real SignedDistance(const Vec3 &p) const { return normal.dot(p) + d; }
+            Vec3 Project(const Vec3 &p) const { return p - normal * SignedDistance(p); }
+        };
+
+        // 轴对齐包围盒, 默认为空盒 (min > max)
+        struct AABB
+        {
+            Vec3 min{std::numeric_limits<real>::max(), std::numeric_limits<real>::max(), std::numeric_limits<real>::max()};
+            Vec3 max{std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest()};
+
+            bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+            void Expand(const Vec3 &p)
+            {
+                min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+                max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+            }
+            void Expand(const AABB &o)
+            {
+                min = {std::min(min.x, o.min.x), std::min(min.y, o.min.y), std::min(min.z, o.min.z)};
+                max = {std::max(max.x, o.max.x), std::max(max.y, o.max.y), std::max(max.z, o.max.z)};
+            }
+            Vec3 Center() const { return (min + max) * 0.5f; }
+            Vec3 Size() const { return max - min; }
+            bool Contains(const Vec3 &p) const
+            {
+                return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+            }
+        };
+
+        // 三角形上距 p 最近的点 (Ericson), barycentric 可选地返回对应的重心坐标
+        inline Vec3 ClosestPointOnTriangle(const Vec3 &p, const Vec3 &a, const Vec3 &b, const Vec3 &c, Vec3 *barycentric = nullptr)
+        {
+            auto result = [&](real u, real v, real w)
+            {
+                if (barycentric)
+                    *barycentric = {u, v, w};
+                return a * u + b * v + c * w;
+            };
+            Vec3 ab = b - a, ac = c - a, ap = p - a;
+            real d1 = ab.dot(ap), d2 = ac.dot(ap);
+            if (d1 <= 0 && d2 <= 0)
+                return result(1, 0, 0);
+            Vec3 bp = p - b;
+            real d3 = ab.dot(bp), d4 = ac.dot(bp);
+            if (d3 >= 0 && d4 <= d3)
+                return result(0, 1, 0);
+            real vc = d1 * d4 - d3 * d2;
+            if (vc <= 0 && d1 >= 0 && d3 <= 0)
+            {
+                real v = d1 / (d1 - d3);
+                return result(1 - v, v, 0);
+            }
+            Vec3 cp = p - c;
+            real d5 = ab.dot(cp), d6 = ac.dot(cp);
+            if (d6 >= 0 && d5 <= d6)
+                return result(0, 0, 1);
+            real vb = d5 * d2 - d1 * d6;
+            if (vb <= 0 && d2 >= 0 && d6 <= 0)
+            {
+                real w = d2 / (d2 - d6);
+                return result(1 - w, 0, w);
+            }
+            real va = d3 * d6 - d5 * d4;
+            if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+            {
+                real w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                return result(0, 1 - w, w);
+            }
+            real denom = 1 / (va + vb + vc);
+            real v = vb * denom, w = vc * denom;
+            return result(1 - v - w, v, w);
+        }
+
+        struct Sphere
+        {
+            Vec3 center;
+            real radius = 0;
+            bool Contains(const Vec3 &p) const { return (p - center).lengthSquared() <= radius * radius; }
+        };
+
+        // 有向包围盒: 中心 + 三条单位正交轴 + 沿各轴的半长
+        struct OBB
+        {
+            Vec3 center;
+            Vec3 axes[3]{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+            Vec3 halfExtents;
+
+            real Volume() const { return 8 * halfExtents.x * halfExtents.y * halfExtents.z; }
+            bool Contains(const Vec3 &p) const
+            {
+                Vec3 d = p - center;
+                return std::abs(d.dot(axes[0])) <= halfExtents.x && std::abs(d.dot(axes[1])) <= halfExtents.y && std::abs(d.dot(axes[2])) <= halfExtents.z;
+            }
+        };
+
+        // 视锥体: 六个平面法向均指向内部, 顺序为 左 右 下 上 近 远
+        struct Frustum
+        {
+            Plane planes[6];
+
+            // 透视相机, fovY 为竖直视角 (弧度), aspect = 宽 / 高
+            static Frustum FromPerspective(const Vec3 &position, const Vec3 &forward, const Vec3 &up,
+                                           real fovY, real aspect, real zNear, real zFar)
+            {
+                Vec3 f = forward.normalize();
+                Vec3 r = f.cross(up).normalize();
+                Vec3 u = r.cross(f);
+                real halfV = std::tan(fovY * 0.5f), halfH = halfV * aspect;
+                auto side = [&](const Vec3 &edge, const Vec3 &axis)
+                {
+                    Vec3 n = edge.cross(axis).normalize();
+                    return Plane::FromPointNormal(position, n.dot(f) < 0 ? -n : n);
+                };
+                Frustum fr;
+                fr.planes[0] = side(f - r * halfH, u);
+                fr.planes[1] = side(f + r * halfH, u);
+                fr.planes[2] = side(f - u * halfV, r);
+                fr.planes[3] = side(f + u * halfV, r);
+                fr.planes[4] = Plane::FromPointNormal(position + f * zNear, f);
+                fr.planes[5] = Plane::FromPointNormal(position + f * zFar, -f);
+                return fr;
+            }
+
+            bool Contains(const Vec3 &p) const
+            {
+                for (const Plane &pl : planes)
+                    if (pl.SignedDistance(p) < 0)
+                        return false;
+                return true;
+            }
+            // 保守测试: 可能把视锥角附近的少量物体判为可见, 但不会漏掉可见物体
+            bool Intersects(const Sphere &s) const
+            {
+                for (const Plane &pl : planes)
+                    if (pl.SignedDistance(s.center) < -s.radius)
+                        return false;
+                return true;
+            }
+            bool Intersects(const AABB &box) const
+            {
+                Vec3 c = box.Center(), e = box.Size() * 0.5f;
+                for (const Plane &pl : planes)
+                {
+                    real r = std::abs(pl.normal.x) * e.x + std::abs(pl.normal.y) * e.y + std::abs(pl.normal.z) * e.z;
+                    if (pl.SignedDistance(c) < -r)
+                        return false;
+                }
+                return true;
+            }
+        };
+    }
+
+    namespace Integration2D
+    {
+        // Euler 积分
+        inline void Euler(Vec2 &position, Vec2 &velocity, const Vec2 &acceleration, real dt)
+        {
+            velocity += acceleration * dt;
+            position += velocity * dt;
+        }
+
+        // RK2 积分
+        inline void RK2(Vec2 &position, Vec2 &velocity, const Vec2 &acceleration, real dt)
+        {
+            Vec2 v_mid = velocity + acceleration * (dt * 0.5f);
+            position += v_mid * dt;
+            velocity += acceleration * dt;
+        }
+    }
+
+    // ====================== 统计归约 ======================
+    namespace Statistics
+    {
+        // 点集一阶/二阶矩: Welford 逐点更新, Chan 公式合并, 可用于分块流式累积
+        struct Moments2
+        {
+            size_t count = 0;
+            Vec2 mean;
+            real cxx = 0, cxy = 0, cyy = 0; // 中心化二阶矩之和
+
+            void Add(const Vec2 &p)
+            {
+                ++count;
+                Vec2 d = p - mean;
+                mean += d / static_cast<real>(count);
+                Vec2 d2 = p - mean;
+                cxx += d.x * d2.x;
+                cxy += d.x * d2.y;
+                cyy += d.y * d2.y;
+            }
+            // 按缓存大小的块做两遍计算 (块内先求均值再求中心矩), 再与已有结果合并
+            void Add(const Vec2 *points, size_t n)
+            {
+                const size_t Block = 1024;
+                for (size_t b = 0; b < n; b += Block)
+                {
+                    size_t e = std::min(n, b + Block);
+                    real sx = 0, sy = 0;
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        sx += points[i].x;
+                        sy += points[i].y;
+                    }
+                    Moments2 blk;
+                    blk.count = e - b;
+                    blk.mean = {sx / blk.count, sy / blk.count};
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        real dx = points[i].x - blk.mean.x, dy = points[i].y - blk.mean.y;
+                        blk.cxx += dx * dx;
+                        blk.cxy += dx * dy;
+                        blk.cyy += dy * dy;
+                    }
+                    Merge(blk);
+                }
+            }
+            void Merge(const Moments2 &o)
+            {
+                if (o.count == 0)
+                    return;
+                if (count == 0)
+                {
+                    *this = o;
+                    return;
+                }
+                real n = static_cast<real>(count + o.count);
+                real w = static_cast<real>(count) * static_cast<real>(o.count) / n;
+                Vec2 d = o.mean - mean;
+                mean += d * (static_cast<real>(o.count) / n);
+                cxx += o.cxx + d.x * d.x * w;
+                cxy += o.cxy + d.x * d.y * w;
+                cyy += o.cyy + d.y * d.y * w;
+                count += o.count;
+            }
+            // sample 为 true 时除以 n - 1 (无偏估计), 否则除以 n
+            Mat2 Covariance(bool sample = false) const
+            {
+                if (count < (sample ? 2u : 1u))
+                    return Mat2::Zero();
+                real inv = 1 / static_cast<real>(sample ? count - 1 : count);
+                return {cxx * inv, cxy * inv, cxy * inv, cyy * inv};
+            }
+        };
+
+        struct Moments3
+        {
+            size_t count = 0;
+            Vec3 mean;
+            real cxx = 0, cxy = 0, cxz = 0, cyy = 0, cyz = 0, czz = 0;
+
+            void Add(const Vec3 &p)
+            {
+                ++count;
+                Vec3 d = p - mean;
+                mean += d / static_cast<real>(count);
+                Vec3 d2 = p - mean;
+                cxx += d.x * d2.x;
+                cxy += d.x * d2.y;
+                cxz += d.x * d2.z;
+                cyy += d.y * d2.y;
+                cyz += d.y * d2.z;
+                czz += d.z * d2.z;
+            }
+            void Add(const Vec3 *points, size_t n)
+            {
+                const size_t Block = 1024;
+                for (size_t b = 0; b < n; b += Block)
+                {
+                    size_t e = std::min(n, b + Block);
+                    real sx = 0, sy = 0, sz = 0;
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        sx += points[i].x;
+                        sy += points[i].y;
+                        sz += points[i].z;
+                    }
+                    Moments3 blk;
+                    blk.count = e - b;
+                    blk.mean = {sx / blk.count, sy / blk.count, sz / blk.count};
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        real dx = points[i].x - blk.mean.x, dy = points[i].y - blk.mean.y, dz = points[i].z - blk.mean.z;
+                        blk.cxx += dx * dx;
+                        blk.cxy += dx * dy;
+                        blk.cxz += dx * dz;
+                        blk.cyy += dy * dy;
+                        blk.cyz += dy * dz;
+                        blk.czz += dz * dz;
+                    }
+                    Merge(blk);
+                }
+            }
+            void Merge(const Moments3 &o)
+            {
+                if (o.count == 0)
+                    return;
+                if (count == 0)
+                {
+                    *this = o;
+                    return;
+                }
+                real n = static_cast<real>(count + o.count);
+                real w = static_cast<real>(count) * static_cast<real>(o.count) / n;
+                Vec3 d = o.mean - mean;
+                mean += d * (static_cast<real>(o.count) / n);
+                cxx += o.cxx + d.x * d.x * w;
+                cxy += o.cxy + d.x * d.y * w;
+                cxz += o.cxz + d.x * d.z * w;
+                cyy += o.cyy + d.y * d.y * w;
+                cyz += o.cyz + d.y * d.z * w;
+                czz += o.czz + d.z * d.z * w;
+                count += o.count;
+            }
+            Mat3 Covariance(bool sample = false) const
+            {
+                if (count < (sample ? 2u : 1u))
+                    return Mat3::Zero();
+                real inv = 1 / static_cast<real>(sample ? count - 1 : count);
+                return {cxx * inv, cxy * inv, cxz * inv,
+                        cxy * inv, cyy * inv, cyz * inv,
+                        cxz * inv, cyz * inv, czz * inv};
+            }
+        };
+
+        // 并行单遍归约
+        inline Moments2 ComputeMoments(const Vec2 *points, size_t n)
+        {
+            return Parallel::Reduce(
+                n, Moments2{}, [&](size_t b, size_t e)
+                {
+                    Moments2 m;
+                    m.Add(points + b, e - b);
+                    return m; },
+                [](Moments2 a, const Moments2 &b)
+                {
+                    a.Merge(b);
+                    return a; },
+                1 << 15);
+        }
+        inline Moments3 ComputeMoments(const Vec3 *points, size_t n)
+        {
+            return Parallel::Reduce(
+                n, Moments3{}, [&](size_t b, size_t e)
+                {
+                    Moments3 m;
+                    m.Add(points + b, e - b);
+                    return m; },
+                [](Moments3 a, const Moments3 &b)
+                {
+                    a.Merge(b);
+                    return a; },
+                1 << 15);
+        }
+
+        inline Vec2 Mean(const Vec2 *points, size_t n) { return ComputeMoments(points, n).mean; }
+        inline Vec3 Mean(const Vec3 *points, size_t n) { return ComputeMoments(points, n).mean; }
+        inline Mat2 Covariance(const Vec2 *points, size_t n, bool sample = false) { return ComputeMoments(points, n).Covariance(sample); }
+        inline Mat3 Covariance(const Vec3 *points, size_t n, bool sample = false) { return ComputeMoments(points, n).Covariance(sample); }
+
+        // 主成分: 方差降序, axes[0] 为主方向
+        struct PrincipalAxes2
+        {
+            Vec2 mean;
+            Vec2 variances;
+            Vec2 axes[2];
+        };
+        struct PrincipalAxes3
+        {
+            Vec3 mean;
+            Vec3 variances;
+            Vec3 axes[3];
+        };
+
+        inline PrincipalAxes2 PCA(const Moments2 &m)
+        {
+            PrincipalAxes2 r;
+            Mat2 vectors;
+            m.Covariance().EigenSymmetric(r.variances, vectors);
+            r.mean = m.mean;
+            r.axes[0] = vectors.Column(0);
+            r.axes[1] = vectors.Column(1);
+            return r;
+        }
+        inline PrincipalAxes3 PCA(const Moments3 &m)
+        {
+            PrincipalAxes3 r;
+            Mat3 vectors;
+            m.Covariance().EigenSymmetric(r.variances, vectors);
+            r.mean = m.mean;
+            for (int i = 0; i < 3; ++i)
+                r.axes[i] = vectors.Column(i);
+            // 保证右手坐标系
+            if (r.axes[0].cross(r.axes[1]).dot(r.axes[2]) < 0)
+                r.axes[2] = -r.axes[2];
+            return r;
+        }
+        inline PrincipalAxes2 PCA(const Vec2 *points, size_t n) { return PCA(ComputeMoments(points, n)); }
+        inline PrincipalAxes3 PCA(const Vec3 *points, size_t n) { return PCA(ComputeMoments(points, n)); }
+    }
+
+    // ====================== 空间索引 ======================
+    namespace Spatial
+    {
+        constexpr size_t npos = static_cast<size_t>(-1);
+
+        // 三维 k-d 树: 节点按中位数原地排列 (隐式平衡树), 查询无需指针跳转
+        class KDTree3
+        {
+        public:
+            KDTree3() = default;
+            KDTree3(const Vec3 *points, size_t n) { Build(points, n); }
+
+            void Build(const Vec3 *points, size_t n)
+            {
+                // 节点以 32 位保存原始下标
+                if (n > std::numeric_limits<uint32_t>::max())
+                    throw("KDTree3 supports at most 2^32 - 1 points");
+                nodes.resize(n);
+                for (size_t i = 0; i < n; ++i)
+                    nodes[i] = {points[i], static_cast<uint32_t>(i), 0};
+                BuildRange(0, n);
+            }
+            size_t Size() const { return nodes.size(); }
+
+            // 返回最近点在构建数组中的下标, maxDistSq 范围内无点时返回 npos
+            size_t Nearest(const Vec3 &q, real *distSq = nullptr, real maxDistSq = std::numeric_limits<real>::max()) const
+            {
+                size_t best = npos;
+                real bestD = maxDistSq;
+                NearestRange(0, nodes.size(), q, best, bestD);
+                if (distSq)
+                    *distSq = bestD;
+                return best;
+            }
+
+            // k 近邻, 按距离升序写入 indices / distSq, 返回找到的数量
+            size_t KNearest(const Vec3 &q, size_t k, size_t *indices, real *distSq = nullptr) const
+            {
+                std::vector<real> d(k);
+                size_t found = 0;
+                if (k > 0)
+                    KNearestRange(0, nodes.size(), q, k, indices, d.data(), found);
+                if (distSq)
+                    std::copy(d.begin(), d.begin() + found, distSq);
+                return found;
+            }
+
+        private:
+            struct Node
+            {
+                Vec3 p;
+                uint32_t index;
+                uint32_t axis;
+            };
+
+            void BuildRange(size_t lo, size_t hi)
+            {
+                if (hi - lo <= 1)
+                    return;
+                Vec3 mn = nodes[lo].p, mx = nodes[lo].p;
+                for (size_t i = lo + 1; i < hi; ++i)
+                {
+                    const Vec3 &p = nodes[i].p;
+                    mn = {std::min(mn.x, p.x), std::min(mn.y, p.y), std::min(mn.z, p.z)};
+                    mx = {std::max(mx.x, p.x), std::max(mx.y, p.y), std::max(mx.z, p.z)};
+                }
+                Vec3 ext = mx - mn;
+                uint32_t axis = ext.x >= ext.y && ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+                size_t mid = lo + (hi - lo) / 2;
+                std::nth_element(nodes.begin() + lo, nodes.begin() + mid, nodes.begin() + hi,
+                                 [axis](const Node &a, const Node &b)
+                                 { return a.p[axis] < b.p[axis]; });
+                nodes[mid].axis = axis;
+                // 大区间的两棵子树并行构建
+                if (hi - lo > 65536)
+                    Parallel::For(
+                        2, [&](size_t b, size_t e)
+                        {
+                            for (size_t s = b; s < e; ++s)
+                                s == 0 ? BuildRange(lo, mid) : BuildRange(mid + 1, hi); },
+                        1);
+                else
+                {
+                    BuildRange(lo, mid);
+                    BuildRange(mid + 1, hi);
+                }
+            }
+
+            void NearestRange(size_t lo, size_t hi, const Vec3 &q, size_t &best, real &bestD) const
+            {
+                while (lo < hi)
+                {
+                    size_t mid = lo + (hi - lo) / 2;
+                    const Node &nd = nodes[mid];
+                    real d = (nd.p - q).lengthSquared();
+                    if (d < bestD)
+                    {
+                        bestD = d;
+                        best = nd.index;
+                    }
+                    if (hi - lo == 1)
+                        return;
+                    real diff = q[nd.axis] - nd.p[nd.axis];
+                    if (diff < 0)
+                    {
+                        NearestRange(lo, mid, q, best, bestD);
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        NearestRange(mid + 1, hi, q, best, bestD);
+                        hi = mid;
+                    }
+                    if (diff * diff >= bestD)
+                        return;
+                }
+            }
+
+            void KNearestRange(size_t lo, size_t hi, const Vec3 &q, size_t k, size_t *idx, real *dist, size_t &found) const
+            {
+                while (lo < hi)
+                {
+                    size_t mid = lo + (hi - lo) / 2;
+                    const Node &nd = nodes[mid];
+                    real d = (nd.p - q).lengthSquared();
+                    if (found < k || d < dist[found - 1])
+                    {
+                        size_t j = found < k ? found++ : k - 1;
+                        for (; j > 0 && dist[j - 1] > d; --j)
+                        {
+                            dist[j] = dist[j - 1];
+                            idx[j] = idx[j - 1];
+                        }
+                        dist[j] = d;
+                        idx[j] = nd.index;
+                    }
+                    if (hi - lo == 1)
+                        return;
+                    real diff = q[nd.axis] - nd.p[nd.axis];
+                    if (diff < 0)
+                    {
+                        KNearestRange(lo, mid, q, k, idx, dist, found);
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        KNearestRange(mid + 1, hi, q, k, idx, dist, found);
+                        hi = mid;
+                    }
+                    if (found == k && diff * diff >= dist[found - 1])
+                        return;
+                }
+            }
+
+            std::vector<Node> nodes;
+        };
+
+        // 点到折线最近点查询的结果: 折线编号, 折线内线段编号 (起点下标), 线段参数 t, 从折线起点量起的弧长
+        struct PolylineHit
+        {
+            Vec2 point;
+            real distance = std::numeric_limits<real>::max();
+            real arcLength = 0;
+            real t = 0;
+            uint32_t polyline = std::numeric_limits<uint32_t>::max();
+            uint32_t segment = 0;
+
+            bool Valid() const { return polyline != std::numeric_limits<uint32_t>::max(); }
+        };
+
+        // 折线 (路网) 索引: 线段存为 SoA 并登记到均匀网格的各个重叠格子 (CSR), 每条折线保存前缀弧长;
+        // 查询从所在格子向外逐圈扩展, 当前最近距离不超过未访问区域的下界时停止
+        class PolylineIndex
+        {
+        public:
+            PolylineIndex() = default;
+            explicit PolylineIndex(const std::vector<std::vector<Vec2>> &polylines) { Build(polylines); }
+
+            void Build(const std::vector<std::vector<Vec2>> &polylines)
+            {
+                ax.clear();
+                ay.clear();
+                dx.clear();
+                dy.clear();
+                owner.clear();
+                first.assign(1, 0);
+                segFirst.clear();
+                vertices.clear();
+                prefix.clear();
+                for (size_t k = 0; k < polylines.size(); ++k)
+                {
+                    const std::vector<Vec2> &line = polylines[k];
+                    real arc = 0;
+                    segFirst.push_back(static_cast<uint32_t>(ax.size()));
+                    for (size_t i = 0; i < line.size(); ++i)
+                    {
+                        if (i > 0)
+                        {
+                            Vec2 d = line[i] - line[i - 1];
+                            ax.push_back(line[i - 1].x);
+                            ay.push_back(line[i - 1].y);
+                            dx.push_back(d.x);
+                            dy.push_back(d.y);
+                            owner.push_back(static_cast<uint32_t>(k));
+                            arc += d.length();
+                        }
+                        vertices.push_back(line[i]);
+                        prefix.push_back(arc);
+                    }
+                    first.push_back(static_cast<uint32_t>(vertices.size()));
+                }
+                BuildGrid();
+            }
+            void Build(const Vec2 *points, size_t n) { Build(std::vector<std::vector<Vec2>>{std::vector<Vec2>(points, points + n)}); }
+
+            size_t PolylineCount() const { return first.size() - 1; }
+            size_t SegmentCount() const { return ax.size(); }
+            real Length(size_t polyline) const { return first[polyline + 1] > first[polyline] ? prefix[first[polyline + 1] - 1] : 0; }
+
+            // 最近点; maxDistance 内没有线段时返回无效结果
+            PolylineHit Closest(const Vec2 &q, real maxDistance = std::numeric_limits<real>::max()) const
+            {
+                PolylineHit hit;
+                if (ax.empty())
+                    return hit;
+                real best = maxDistance < std::numeric_limits<real>::max() ? maxDistance * maxDistance : std::numeric_limits<real>::max();
+                uint32_t bestSeg = 0;
+                real bestT = 0;
+                bool found = false;
+                int cx = CellCoord(q.x - origin.x, nx), cy = CellCoord(q.y - origin.y, ny);
+                for (int r = 0;; ++r)
+                {
+                    // 第 r 圈 (切比雪夫距离为 r 的格子)
+                    int x0 = cx - r, x1 = cx + r, y0 = cy - r, y1 = cy + r;
+                    for (int y = std::max(y0, 0); y <= std::min(y1, ny - 1); ++y)
+                    {
+                        bool edgeRow = y == y0 || y == y1;
+                        for (int x = std::max(x0, 0); x <= std::min(x1, nx - 1); x += (edgeRow || x == x1) ? 1 : std::max(1, x1 - x))
+                        {
+                            size_t c = static_cast<size_t>(y) * nx + x;
+                            for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k)
+                            {
+                                uint32_t s = cellItems[k];
+                                real t, d = SegmentDistSq(s, q, t);
+                                if (d < best || (d == best && found && s < bestSeg))
+                                {
+                                    best = d;
+                                    bestSeg = s;
+                                    bestT = t;
+                                    found = true;
+                                }
+                            }
+                        }
+                    }
+                    // 未访问的格子都在已检查方块某一侧之外, 取 q 到这些半平面距离的最小值作为下界
+                    real inf = std::numeric_limits<real>::max();
+                    real bound = std::min(std::min(x0 > 0 ? q.x - (origin.x + x0 * cell) : inf, x1 < nx - 1 ? origin.x + (x1 + 1) * cell - q.x : inf),
+                                          std::min(y0 > 0 ? q.y - (origin.y + y0 * cell) : inf, y1 < ny - 1 ? origin.y + (y1 + 1) * cell - q.y : inf));
+                    if (bound == inf || (bound > 0 && bound * bound >= best))
+                        break;
+                }
+                if (!found)
+                    return hit;
+                uint32_t line = owner[bestSeg];
+                uint32_t local = bestSeg - segFirst[line];
+                size_t v = first[line] + local;
+                hit.point = Vec2(ax[bestSeg] + dx[bestSeg] * bestT, ay[bestSeg] + dy[bestSeg] * bestT);
+                hit.distance = std::sqrt(best);
+                hit.t = bestT;
+                hit.polyline = line;
+                hit.segment = local;
+                hit.arcLength = prefix[v] + (prefix[v + 1] - prefix[v]) * bestT;
+                return hit;
+            }
+
+            // 批量查询, 查询点之间并行
+            void Closest(const Vec2 *queries, size_t count, PolylineHit *out, real maxDistance = std::numeric_limits<real>::max()) const
+            {
+                Parallel::For(
+                    count, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            out[i] = Closest(queries[i], maxDistance); },
+                    1024);
+            }
+
+            // 弧长参数化的逆: 折线上弧长为 s 处的点 (s 截断到 [0, Length])
+            Vec2 PointAt(size_t polyline, real s) const
+            {
+                size_t b = first[polyline], e = first[polyline + 1];
+                if (e - b <= 1)
+                    return e > b ? vertices[b] : Vec2();
+                size_t k = static_cast<size_t>(std::upper_bound(prefix.begin() + b, prefix.begin() + e, s) - prefix.begin());
+                k = std::min(std::max(k, b + 1), e - 1);
+                real len = prefix[k] - prefix[k - 1];
+                real t = len > 0 ? MathTools::Clamp((s - prefix[k - 1]) / len, 0, 1) : 0;
+                return vertices[k - 1] + (vertices[k] - vertices[k - 1]) * t;
+            }
+
+        private:
+            std::vector<real> ax, ay, dx, dy;
+            std::vector<uint32_t> owner, first, segFirst; // 线段所属折线; 折线 k 的顶点为 [first[k], first[k + 1]), 线段从 segFirst[k] 起
+            std::vector<Vec2> vertices;
+            std::vector<real> prefix; // 各顶点处从所属折线起点量起的弧长
+            std::vector<uint32_t> cellStart, cellItems;
+            Vec2 origin;
+            real cell = 1;
+            int nx = 1, ny = 1;
+
+            int CellCoord(real offset, int n) const { return std::min(n - 1, std::max(0, static_cast<int>(std::floor(offset / cell)))); }
+
+            real SegmentDistSq(uint32_t s, const Vec2 &q, real &t) const
+            {
+                real px = q.x - ax[s], py = q.y - ay[s];
+                real len2 = dx[s] * dx[s] + dy[s] * dy[s];
+                t = len2 > 0 ? MathTools::Clamp((px * dx[s] + py * dy[s]) / len2, 0, 1) : 0;
+                real ex = px - dx[s] * t, ey = py - dy[s] * t;
+                return ex * ex + ey * ey;
+            }
+
+            // 格子边长取平均线段长度, 格子总数不超过线段数的 4 倍
+            void BuildGrid()
+            {
+                size_t n = ax.size();
+                if (n == 0)
+                {
+                    cellStart.assign(2, 0);
+                    cellItems.clear();
+                    return;
+                }
+                Vec2 mn(ax[0], ay[0]), mx = mn;
+                real total = 0;
+                for (size_t s = 0; s < n; ++s)
+                {
+                    mn = Vec2(std::min(mn.x, std::min(ax[s], ax[s] + dx[s])), std::min(mn.y, std::min(ay[s], ay[s] + dy[s])));
+                    mx = Vec2(std::max(mx.x, std::max(ax[s], ax[s] + dx[s])), std::max(mx.y, std::max(ay[s], ay[s] + dy[s])));
+                    total += std::sqrt(dx[s] * dx[s] + dy[s] * dy[s]);
+                }
+                Vec2 ext = mx - mn;
+                real area = std::max(ext.x, Constants::Epsilon) * std::max(ext.y, Constants::Epsilon);
+                cell = std::max(total / n, std::sqrt(area / (4 * static_cast<real>(n))));
+                cell = std::max(cell, std::max(ext.x, ext.y) / 65536);
+                cell = std::max(cell, Constants::Epsilon);
+                origin = mn;
+                nx = static_cast<int>(ext.x / cell) + 1;
+                ny = static_cast<int>(ext.y / cell) + 1;
+                cellStart.assign(static_cast<size_t>(nx) * ny + 1, 0);
+                auto forCells = [&](size_t s, auto &&fn)
+                {
+                    int x0 = CellCoord(std::min(ax[s], ax[s] + dx[s]) - origin.x, nx), x1 = CellCoord(std::max(ax[s], ax[s] + dx[s]) - origin.x, nx);
+                    int y0 = CellCoord(std::min(ay[s], ay[s] + dy[s]) - origin.y, ny), y1 = CellCoord(std::max(ay[s], ay[s] + dy[s]) - origin.y, ny);
+                    for (int y = y0; y <= y1; ++y)
+                        for (int x = x0; x <= x1; ++x)
+                            fn(static_cast<size_t>(y) * nx + x);
+                };
+                for (size_t s = 0; s < n; ++s)
+                    forCells(s, [&](size_t c)
+                             { ++cellStart[c + 1]; });
+                for (size_t c = 1; c < cellStart.size(); ++c)
+                    cellStart[c] += cellStart[c - 1];
+                cellItems.resize(cellStart.back());
+                std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+                for (size_t s = 0; s < n; ++s)
+                    forCells(s, [&](size_t c)
+                             { cellItems[fill[c]++] = static_cast<uint32_t>(s); });
+            }
+        };
+
+        namespace Detail
+        {
+            // 分块并行排序后逐轮两两归并
+            template <typename T, typename Less>
+            inline void ParallelSort(std::vector<T> &items, Less less)
+            {
+                const size_t Chunk = 1 << 15;
+                size_t n = items.size(), chunks = (n + Chunk - 1) / Chunk;
+                if (chunks <= 1)
+                {
+                    std::sort(items.begin(), items.end(), less);
+                    return;
+                }
+                Parallel::For(
+                    chunks, [&](size_t b, size_t e)
+                    {
+                        for (size_t c = b; c < e; ++c)
+                            std::sort(items.begin() + c * Chunk, items.begin() + std::min(n, (c + 1) * Chunk), less); },
+                    1);
+                for (size_t width = Chunk; width < n; width *= 2)
+                {
+                    size_t pairs = (n + 2 * width - 1) / (2 * width);
+                    Parallel::For(
+                        pairs, [&](size_t b, size_t e)
+                        {
+                            for (size_t k = b; k < e; ++k)
+                            {
+                                size_t lo = k * 2 * width, mid = std::min(n, lo + width), hi = std::min(n, lo + 2 * width);
+                                std::inplace_merge(items.begin() + lo, items.begin() + mid, items.begin() + hi, less);
+                            } },
+                        1);
+                }
+            }
+        }
+
+        // 二维 R*-树 (Beckmann 等, 1990): 节点定长, 子项包围盒按 SoA 存放, 节点放在连续数组中以下标相连;
+        // 支持并行 STR 批量构建, R* 插入 (强制重插与按周长 / 重叠选择的分裂), 删除, 窗口 / 最近邻 / 连接查询
+        class RTree
+        {
+        public:
+            using Box = Geometry2D::AABB;
+            static constexpr uint32_t MaxEntries = 16;
+            static constexpr uint32_t MinEntries = 6;
+
+            RTree() { Clear(); }
+
+            void Clear()
+            {
+                nodes.assign(1, Node());
+                freeNodes.clear();
+                root = 0;
+                count = 0;
+            }
+            size_t Size() const { return count; }
+            uint32_t Height() const { return nodes[root].level + 1; }
+            Box Bounds() const { return NodeBox(root); }
+
+            // Sort-Tile-Recursive 批量构建 (替换现有内容); ids 为空时编号为 0..n-1
+            void BulkLoad(const Box *boxes, size_t n, const uint32_t *ids = nullptr)
+            {
+                Clear();
+                if (n == 0)
+                    return;
+                std::vector<Entry> level(n);
+                for (size_t i = 0; i < n; ++i)
+                    level[i] = {boxes[i], ids ? ids[i] : static_cast<uint32_t>(i)};
+                nodes.clear();
+                uint32_t height = 0;
+                while (true)
+                {
+                    std::vector<Entry> parents = PackLevel(level, height);
+                    if (parents.size() == 1)
+                    {
+                        root = parents[0].child;
+                        break;
+                    }
+                    level.swap(parents);
+                    ++height;
+                }
+                count = n;
+            }
+
+            void Insert(const Box &box, uint32_t id)
+            {
+                pending.clear();
+                uint32_t reinserted = 0;
+                InsertEntry({box, id}, 0, reinserted);
+                while (!pending.empty())
+                {
+                    std::pair<Entry, uint32_t> e = pending.back();
+                    pending.pop_back();
+                    InsertEntry(e.first, e.second, reinserted);
+                }
+                ++count;
+            }
+
+            // 删除包围盒与 box 相交且编号为 id 的项, 未找到时返回 false
+            bool Remove(const Box &box, uint32_t id)
+            {
+                std::vector<std::pair<uint32_t, uint32_t>> path;
+                if (!FindLeaf(root, box, id, path))
+                    return false;
+                uint32_t leaf = path.back().first, slot = path.back().second;
+                RemoveAt(leaf, slot);
+                // 自底向上收缩: 不足 MinEntries 的节点摘下, 其子项稍后按原层次重插
+                std::vector<std::pair<Entry, uint32_t>> orphans;
+                for (size_t k = path.size() - 1; k > 0; --k)
+                {
+                    uint32_t node = path[k].first, parent = path[k - 1].first, at = path[k - 1].second;
+                    if (nodes[node].count < MinEntries)
+                    {
+                        for (uint32_t i = 0; i < nodes[node].count; ++i)
+                            orphans.push_back({GetEntry(node, i), nodes[node].level});
+                        RemoveAt(parent, at);
+                        FreeNode(node);
+                    }
+                    else
+                        SetBox(parent, at, NodeBox(node));
+                }
+                --count;
+                for (const auto &o : orphans)
+                {
+                    pending.clear();
+                    uint32_t reinserted = 0;
+                    InsertEntry(o.first, o.second, reinserted);
+                    while (!pending.empty())
+                    {
+                        std::pair<Entry, uint32_t> e = pending.back();
+                        pending.pop_back();
+                        InsertEntry(e.first, e.second, reinserted);
+                    }
+                }
+                while (nodes[root].level > 0 && nodes[root].count == 1)
+                {
+                    uint32_t old = root;
+                    root = nodes[root].child[0];
+                    FreeNode(old);
+                }
+                return true;
+            }
+
+            // 窗口查询: 对与 window 相交的每一项调用 fn(id)
+            template <typename F>
+            void Query(const Box &window, F &&fn) const
+            {
+                if (count == 0)
+                    return;
+                uint32_t stack[64 * MaxEntries];
+                size_t top = 0;
+                stack[top++] = root;
+                while (top > 0)
+                {
+                    const Node &nd = nodes[stack[--top]];
+                    bool hit[MaxEntries + 1];
+                    for (uint32_t i = 0; i < nd.count; ++i)
+                        hit[i] = nd.minX[i] <= window.max.x && nd.maxX[i] >= window.min.x && nd.minY[i] <= window.max.y && nd.maxY[i] >= window.min.y;
+                    for (uint32_t i = 0; i < nd.count; ++i)
+                        if (hit[i])
+                        {
+                            if (nd.level == 0)
+                                fn(nd.child[i]);
+                            else
+                                stack[top++] = nd.child[i];
+                        }
+                }
+            }
+            void Query(const Box &window, std::vector<uint32_t> &out) const
+            {
+                out.clear();
+                Query(window, [&](uint32_t id)
+                      { out.push_back(id); });
+            }
+
+            // 按包围盒到 p 的距离取 k 近邻 (最佳优先), 升序写入 ids / distSq, 返回找到的数量
+            size_t Nearest(const Vec2 &p, size_t k, uint32_t *ids, real *distSq = nullptr) const
+            {
+                if (count == 0 || k == 0)
+                    return 0;
+                // 堆项: (距离, 编号, 是否为节点)
+                typedef std::pair<real, std::pair<uint32_t, bool>> Item;
+                std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+                heap.push({0, {root, true}});
+                size_t found = 0;
+                while (!heap.empty() && found < k)
+                {
+                    Item top = heap.top();
+                    heap.pop();
+                    if (!top.second.second)
+                    {
+                        ids[found] = top.second.first;
+                        if (distSq)
+                            distSq[found] = top.first;
+                        ++found;
+                        continue;
+                    }
+                    const Node &nd = nodes[top.second.first];
+                    for (uint32_t i = 0; i < nd.count; ++i)
+                    {
+                        real dx = std::max(std::max(nd.minX[i] - p.x, p.x - nd.maxX[i]), real(0));
+                        real dy = std::max(std::max(nd.minY[i] - p.y, p.y - nd.maxY[i]), real(0));
+                        heap.push({dx * dx + dy * dy, {nd.child[i], nd.level > 0}});
+                    }
+                }
+                return found;
+            }
+
+            // 空间连接: 输出包围盒相交的全部 (a 中编号, b 中编号) 对; 同步遍历两棵树,
+            // 先在上层展开出足够多的节点对, 再并行处理各对, 结果按节点对次序拼接
+            static void Join(const RTree &a, const RTree &b, std::vector<std::pair<uint32_t, uint32_t>> &out)
+            {
+                out.clear();
+                if (a.count == 0 || b.count == 0)
+                    return;
+                std::vector<std::pair<uint32_t, uint32_t>> frontier{{a.root, b.root}}, next;
+                size_t target = static_cast<size_t>(Parallel::ThreadPool::Instance().Concurrency()) * 64;
+                while (frontier.size() < target)
+                {
+                    next.clear();
+                    bool expanded = false;
+                    for (const auto &pr : frontier)
+                    {
+                        const Node &na = a.nodes[pr.first], &nb = b.nodes[pr.second];
+                        if (na.level == 0 && nb.level == 0)
+                        {
+                            next.push_back(pr);
+                            continue;
+                        }
+                        expanded = true;
+                        bool splitA = na.level >= nb.level;
+                        const Node &big = splitA ? na : nb;
+                        Box other = splitA ? b.NodeBox(pr.second) : a.NodeBox(pr.first);
+                        for (uint32_t i = 0; i < big.count; ++i)
+                            if (big.minX[i] <= other.max.x && big.maxX[i] >= other.min.x && big.minY[i] <= other.max.y && big.maxY[i] >= other.min.y)
+                                next.push_back(splitA ? std::make_pair(big.child[i], pr.second) : std::make_pair(pr.first, big.child[i]));
+                    }
+                    frontier.swap(next);
+                    if (!expanded)
+                        break;
+                }
+                std::vector<std::vector<std::pair<uint32_t, uint32_t>>> parts(frontier.size());
+                Parallel::For(
+                    frontier.size(), [&](size_t lo, size_t hi)
+                    {
+                        for (size_t i = lo; i < hi; ++i)
+                            JoinNodes(a, frontier[i].first, b, frontier[i].second, parts[i]); },
+                    1);
+                size_t total = 0;
+                for (const auto &part : parts)
+                    total += part.size();
+                out.reserve(total);
+                for (const auto &part : parts)
+                    out.insert(out.end(), part.begin(), part.end());
+            }
+
+        private:
+            struct Node
+            {
+                real minX[MaxEntries + 1], minY[MaxEntries + 1], maxX[MaxEntries + 1], maxY[MaxEntries + 1];
+                uint32_t child[MaxEntries + 1];
+                uint32_t count = 0;
+                uint32_t level = 0; // 0 为叶节点, 子项为数据编号
+            };
+            struct Entry
+            {
+                Box box;
+                uint32_t child;
+            };
+
+            std::vector<Node> nodes;
+            std::vector<uint32_t> freeNodes;
+            std::vector<std::pair<Entry, uint32_t>> pending; // 待重插的项及其所在层
+            uint32_t root = 0;
+            size_t count = 0;
+
+            Entry GetEntry(uint32_t node, uint32_t i) const
+            {
+                const Node &nd = nodes[node];
+                return {Box(Vec2(nd.minX[i], nd.minY[i]), Vec2(nd.maxX[i], nd.maxY[i])), nd.child[i]};
+            }
+            void SetBox(uint32_t node, uint32_t i, const Box &b)
+            {
+                Node &nd = nodes[node];
+                nd.minX[i] = b.min.x;
+                nd.minY[i] = b.min.y;
+                nd.maxX[i] = b.max.x;
+                nd.maxY[i] = b.max.y;
+            }
+            void Append(uint32_t node, const Entry &e)
+            {
+                uint32_t i = nodes[node].count++;
+                SetBox(node, i, e.box);
+                nodes[node].child[i] = e.child;
+            }
+            void RemoveAt(uint32_t node, uint32_t i)
+            {
+                Node &nd = nodes[node];
+                uint32_t last = --nd.count;
+                nd.minX[i] = nd.minX[last];
+                nd.minY[i] = nd.minY[last];
+                nd.maxX[i] = nd.maxX[last];
+                nd.maxY[i] = nd.maxY[last];
+                nd.child[i] = nd.child[last];
+            }
+            Box NodeBox(uint32_t node) const
+            {
+                const Node &nd = nodes[node];
+                Box b;
+                for (uint32_t i = 0; i < nd.count; ++i)
+                {
+                    b.min = Vec2(std::min(b.min.x, nd.minX[i]), std::min(b.min.y, nd.minY[i]));
+                    b.max = Vec2(std::max(b.max.x, nd.maxX[i]), std::max(b.max.y, nd.maxY[i]));
+                }
+                return b;
+            }
+            uint32_t NewNode(uint32_t level)
+            {
+                uint32_t id;
+                if (!freeNodes.empty())
+                {
+                    id = freeNodes.back();
+                    freeNodes.pop_back();
+                    nodes[id] = Node();
+                }
+                else
+                {
+                    id = static_cast<uint32_t>(nodes.size());
+                    nodes.push_back(Node());
+                }
+                nodes[id].level = level;
+                return id;
+            }
+            void FreeNode(uint32_t node)
+            {
+                nodes[node].count = 0;
+                freeNodes.push_back(node);
+            }
+
+            static real Enlarged(const Box &a, const Box &b)
+            {
+                Box u = a;
+                u.Expand(b);
+                return u.Area();
+            }
+            static real Overlap(const Box &a, const Box &b)
+            {
+                real w = std::min(a.max.x, b.max.x) - std::max(a.min.x, b.min.x), h = std::min(a.max.y, b.max.y) - std::max(a.min.y, b.min.y);
+                return w > 0 && h > 0 ? w * h : 0;
+            }
+
+            // 一层 STR 打包: 按中心 x 排序后切成 sqrt(P) 条, 条内按中心 y 排序, 每 MaxEntries 项一个节点
+            std::vector<Entry> PackLevel(std::vector<Entry> &items, uint32_t level)
+            {
+                size_t n = items.size(), leaves = (n + MaxEntries - 1) / MaxEntries;
+                size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+                size_t perSlice = ((leaves + slices - 1) / slices) * MaxEntries;
+                Detail::ParallelSort(items, [](const Entry &a, const Entry &b)
+                                     { return a.box.min.x + a.box.max.x < b.box.min.x + b.box.max.x; });
+                size_t base = nodes.size();
+                nodes.resize(base + leaves);
+                std::vector<Entry> parents(leaves);
+                Parallel::For(
+                    (n + perSlice - 1) / perSlice, [&](size_t b, size_t e)
+                    {
+                        for (size_t s = b; s < e; ++s)
+                        {
+                            size_t lo = s * perSlice, hi = std::min(n, lo + perSlice);
+                            std::sort(items.begin() + lo, items.begin() + hi, [](const Entry &x, const Entry &y)
+                                      { return x.box.min.y + x.box.max.y < y.box.min.y + y.box.max.y; });
+                            for (size_t i = lo; i < hi; i += MaxEntries)
+                            {
+                                uint32_t node = static_cast<uint32_t>(base + i / MaxEntries);
+                                nodes[node].level = level;
+                                for (size_t k = i; k < std::min(hi, i + MaxEntries); ++k)
+                                    Append(node, items[k]);
+                                parents[i / MaxEntries] = {NodeBox(node), node};
+                            }
+                        } },
+                    1);
+                return parents;
+            }
+
+            // 自根向下选到 level 层的节点: 子节点为叶时取重叠增量最小者, 否则取面积增量最小者
+            void ChoosePath(const Box &box, uint32_t level, std::vector<std::pair<uint32_t, uint32_t>> &path) const
+            {
+                path.clear();
+                uint32_t node = root;
+                while (nodes[node].level > level)
+                {
+                    const Node &nd = nodes[node];
+                    uint32_t best = 0;
+                    real bestOverlap = std::numeric_limits<real>::max(), bestGrow = bestOverlap, bestArea = bestOverlap;
+                    for (uint32_t i = 0; i < nd.count; ++i)
+                    {
+                        Box b = GetEntry(node, i).box, u = b;
+                        u.Expand(box);
+                        real grow = u.Area() - b.Area(), overlap = 0;
+                        if (nd.level == 1)
+                            for (uint32_t j = 0; j < nd.count; ++j)
+                                if (j != i)
+                                {
+                                    Box o = GetEntry(node, j).box;
+                                    overlap += Overlap(u, o) - Overlap(b, o);
+                                }
+                        if (overlap < bestOverlap || (overlap == bestOverlap && (grow < bestGrow || (grow == bestGrow && b.Area() < bestArea))))
+                        {
+                            best = i;
+                            bestOverlap = overlap;
+                            bestGrow = grow;
+                            bestArea = b.Area();
+                        }
+                    }
+                    path.push_back({node, best});
+                    node = nd.child[best];
+                }
+                path.push_back({node, 0});
+            }
+
+            void InsertEntry(const Entry &e, uint32_t level, uint32_t &reinserted)
+            {
+                std::vector<std::pair<uint32_t, uint32_t>> path;
+                ChoosePath(e.box, level, path);
+                Append(path.back().first, e);
+                for (size_t k = path.size(); k-- > 0;)
+                {
+                    uint32_t node = path[k].first;
+                    uint32_t split = std::numeric_limits<uint32_t>::max();
+                    if (nodes[node].count > MaxEntries)
+                    {
+                        uint32_t bit = 1u << std::min<uint32_t>(nodes[node].level, 31);
+                        if (k > 0 && !(reinserted & bit))
+                        {
+                            reinserted |= bit;
+                            Reinsert(node);
+                        }
+                        else
+                            split = Split(node);
+                    }
+                    if (k == 0)
+                    {
+                        if (split != std::numeric_limits<uint32_t>::max())
+                        {
+                            uint32_t top = NewNode(nodes[node].level + 1);
+                            Append(top, {NodeBox(node), node});
+                            Append(top, {NodeBox(split), split});
+                            root = top;
+                        }
+                        break;
+                    }
+                    uint32_t parent = path[k - 1].first;
+                    SetBox(parent, path[k - 1].second, NodeBox(node));
+                    if (split != std::numeric_limits<uint32_t>::max())
+                        Append(parent, {NodeBox(split), split});
+                }
+            }
+
+            // 强制重插: 取出离节点中心最远的 30% 子项, 在本次插入结束后按原层次重新插入
+            void Reinsert(uint32_t node)
+            {
+                Node &nd = nodes[node];
+                Vec2 c = NodeBox(node).Center();
+                uint32_t order[MaxEntries + 1];
+                real dist[MaxEntries + 1];
+                for (uint32_t i = 0; i < nd.count; ++i)
+                {
+                    order[i] = i;
+                    dist[i] = (GetEntry(node, i).box.Center() - c).lengthSquared();
+                }
+                std::sort(order, order + nd.count, [&](uint32_t a, uint32_t b)
+                          { return dist[a] > dist[b]; });
+                uint32_t take = (MaxEntries + 1) * 3 / 10;
+                std::sort(order, order + take, [](uint32_t a, uint32_t b)
+                          { return a > b; });
+                for (uint32_t k = 0; k < take; ++k)
+                {
+                    pending.push_back({GetEntry(node, order[k]), nd.level});
+                    RemoveAt(node, order[k]);
+                }
+            }
+
+            // R* 分裂: 选周长和最小的轴, 再取重叠 (其次面积和) 最小的分配; 返回新节点
+            uint32_t Split(uint32_t node)
+            {
+                uint32_t n = nodes[node].count;
+                Entry items[MaxEntries + 1];
+                for (uint32_t i = 0; i < n; ++i)
+                    items[i] = GetEntry(node, i);
+                auto evaluate = [&](int axis, bool byMax, real &margin, uint32_t &bestK, real &bestOverlap, real &bestArea, Entry *sorted)
+                {
+                    std::copy(items, items + n, sorted);
+                    std::sort(sorted, sorted + n, [&](const Entry &a, const Entry &b)
+                              {
+                                  real ka = byMax ? a.box.max[axis] : a.box.min[axis], kb = byMax ? b.box.max[axis] : b.box.min[axis];
+                                  return ka < kb; });
+                    Box prefix[MaxEntries + 1], suffix[MaxEntries + 1];
+                    for (uint32_t i = 0; i < n; ++i)
+                    {
+                        prefix[i] = i ? prefix[i - 1] : Box();
+                        prefix[i].Expand(sorted[i].box);
+                    }
+                    for (uint32_t i = n; i-- > 0;)
+                    {
+                        suffix[i] = i + 1 < n ? suffix[i + 1] : Box();
+                        suffix[i].Expand(sorted[i].box);
+                    }
+                    margin = 0;
+                    bestOverlap = bestArea = std::numeric_limits<real>::max();
+                    for (uint32_t k = MinEntries; k <= n - MinEntries; ++k)
+                    {
+                        const Box &l = prefix[k - 1], &r = suffix[k];
+                        Vec2 ls = l.Size(), rs = r.Size();
+                        margin += ls.x + ls.y + rs.x + rs.y;
+                        real overlap = Overlap(l, r), area = l.Area() + r.Area();
+                        if (overlap < bestOverlap || (overlap == bestOverlap && area < bestArea))
+                        {
+                            bestOverlap = overlap;
+                            bestArea = area;
+                            bestK = k;
+                        }
+                    }
+                };
+                Entry best[MaxEntries + 1], candidate[MaxEntries + 1];
+                real bestMargin = std::numeric_limits<real>::max();
+                int bestAxis = 0;
+                for (int axis = 0; axis < 2; ++axis)
+                {
+                    real sum = 0;
+                    for (int byMax = 0; byMax < 2; ++byMax)
+                    {
+                        real margin, overlap, area;
+                        uint32_t k = MinEntries;
+                        evaluate(axis, byMax != 0, margin, k, overlap, area, candidate);
+                        sum += margin;
+                    }
+                    if (sum < bestMargin)
+                    {
+                        bestMargin = sum;
+                        bestAxis = axis;
+                    }
+                }
+                uint32_t bestK = MinEntries;
+                real bestOverlap = std::numeric_limits<real>::max(), bestArea = bestOverlap;
+                for (int byMax = 0; byMax < 2; ++byMax)
+                {
+                    real margin, overlap, area;
+                    uint32_t k = MinEntries;
+                    evaluate(bestAxis, byMax != 0, margin, k, overlap, area, candidate);
+                    if (overlap < bestOverlap || (overlap == bestOverlap && area < bestArea))
+                    {
+                        bestOverlap = overlap;
+                        bestArea = area;
+                        bestK = k;
+                        std::copy(candidate, candidate + n, best);
+                    }
+                }
+                uint32_t sibling = NewNode(nodes[node].level);
+                nodes[node].count = 0;
+                for (uint32_t i = 0; i < n; ++i)
+                    Append(i < bestK ? node : sibling, best[i]);
+                return sibling;
+            }
+
+            bool FindLeaf(uint32_t node, const Box &box, uint32_t id, std::vector<std::pair<uint32_t, uint32_t>> &path) const
+            {
+                const Node &nd = nodes[node];
+                for (uint32_t i = 0; i < nd.count; ++i)
+                {
+                    if (!(nd.minX[i] <= box.max.x && nd.maxX[i] >= box.min.x && nd.minY[i] <= box.max.y && nd.maxY[i] >= box.min.y))
+                        continue;
+                    path.push_back({node, i});
+                    if (nd.level == 0 ? nd.child[i] == id : FindLeaf(nd.child[i], box, id, path))
+                        return true;
+                    path.pop_back();
+                }
+                return false;
+            }
+
+            static void JoinNodes(const RTree &a, uint32_t na, const RTree &b, uint32_t nb, std::vector<std::pair<uint32_t, uint32_t>> &out)
+            {
+                const Node &x = a.nodes[na], &y = b.nodes[nb];
+                if (x.level != y.level)
+                {
+                    // 层数不同时只展开较高的一侧
+                    bool splitA = x.level > y.level;
+                    const Node &big = splitA ? x : y;
+                    Box other = splitA ? b.NodeBox(nb) : a.NodeBox(na);
+                    for (uint32_t i = 0; i < big.count; ++i)
+                        if (big.minX[i] <= other.max.x && big.maxX[i] >= other.min.x && big.minY[i] <= other.max.y && big.maxY[i] >= other.min.y)
+                            splitA ? JoinNodes(a, big.child[i], b, nb, out) : JoinNodes(a, na, b, big.child[i], out);
+                    return;
+                }
+                for (uint32_t i = 0; i < x.count; ++i)
+                    for (uint32_t j = 0; j < y.count; ++j)
+                    {
+                        if (!(x.minX[i] <= y.maxX[j] && x.maxX[i] >= y.minX[j] && x.minY[i] <= y.maxY[j] && x.maxY[i] >= y.minY[j]))
+                            continue;
+                        if (x.level == 0)
+                            out.push_back({x.child[i], y.child[j]});
+                        else
+                            JoinNodes(a, x.child[i], b, y.child[j], out);
+                    }
+            }
+        };
+
+        namespace Detail
+        {
+            // 松散 2^D 叉树 (Ulrich, 2000): 节点的松散边界为其格子向外扩一倍; 物体 (圆 / 球) 放在中心所在格子中
+            // 能容纳其半径的节点里. 移动后只要中心仍在原格子且半径仍不超过格子半边长就原地更新,
+            // 只有越界的物体才会重新定位. 节点以 2^D 个兄弟为一块从节点池分配, 释放的块进入空闲表复用
+            template <typename V, int D>
+            class LooseTree
+            {
+            public:
+                static constexpr uint32_t None = 0xFFFFFFFFu;
+                static constexpr uint32_t Children = 1u << D;
+                static constexpr uint32_t MaxDepth = 24;
+
+                LooseTree() : LooseTree(V(), 1) {}
+                // 根格子为 center ± halfSize; 叶节点物体数超过 capacity 时细分, 最深 maxDepth 层.
+                // 中心在根格子外的物体留在根节点, 结果仍然正确, 但每次查询都要逐个检查, 根格子应覆盖物体的活动范围
+                LooseTree(const V &center, real halfSize, uint32_t maxDepth = 10, uint32_t capacity = 16) { Reset(center, halfSize, maxDepth, capacity); }
+
+                void Reset(const V &center, real halfSize, uint32_t maxDepth = 10, uint32_t capacity = 16)
+                {
+                    if (!(halfSize > 0))
+                        throw("Loose tree half size must be positive");
+                    depthLimit = std::min(maxDepth, MaxDepth);
+                    leafCapacity = std::max(capacity, 1u);
+                    nodes.assign(1, Node());
+                    nodes[0].center = center;
+                    nodes[0].half = halfSize;
+                    freeBlocks.clear();
+                    positions.clear();
+                    radii.clear();
+                    nodeOf.clear();
+                    slotOf.clear();
+                    freeIds.clear();
+                    count = 0;
+                }
+
+                size_t Size() const { return count; }
+                size_t NodeCount() const { return nodes.size() - freeBlocks.size() * Children; }
+                // 留在根节点的物体数, 主要是中心在根格子外的物体; 它们在每次查询中都要逐个检查
+                size_t RootCount() const { return nodes[0].items.size(); }
+                const V &Position(uint32_t id) const { return positions[id]; }
+                real Radius(uint32_t id) const { return radii[id]; }
+
+                // 插入物体, 返回其编号 (删除后的编号会被复用)
+                uint32_t Insert(const V &position, real radius = 0)
+                {
+                    uint32_t id;
+                    if (!freeIds.empty())
+                    {
+                        id = freeIds.back();
+                        freeIds.pop_back();
+                    }
+                    else
+                    {
+                        id = static_cast<uint32_t>(positions.size());
+                        positions.push_back(position);
+                        radii.push_back(radius);
+                        nodeOf.push_back(None);
+                        slotOf.push_back(0);
+                    }
+                    positions[id] = position;
+                    radii[id] = radius;
+                    Place(id, 0);
+                    ++count;
+                    return id;
+                }
+
+                void Remove(uint32_t id)
+                {
+                    uint32_t node = nodeOf[id];
+                    Detach(id);
+                    Collapse(node);
+                    freeIds.push_back(id);
+                    --count;
+                }
+
+                // 移动单个物体; 仍在原节点范围内时只写入新位置
+                void Update(uint32_t id, const V &position) { Update(id, position, radii[id]); }
+                void Update(uint32_t id, const V &position, real radius)
+                {
+                    if (Fits(nodeOf[id], position, radius))
+                    {
+                        positions[id] = position;
+                        radii[id] = radius;
+                        for (uint32_t n = nodeOf[id]; n != None && nodes[n].reach < radius; n = nodes[n].parent)
+                            nodes[n].reach = radius;
+                        return;
+                    }
+                    Relocate(id, position, radius);
+                }
+
+                // 批量移动: 物体 ids[i] (ids 为空时为 i) 移到 positions[i], 编号不得重复.
+                // 先并行判断并原地写入未越界的物体, 再串行重新定位越界的少数物体
+                void Update(const V *newPositions, size_t n, const uint32_t *ids = nullptr)
+                {
+                    const size_t Chunk = 4096;
+                    size_t chunks = (n + Chunk - 1) / Chunk;
+                    std::vector<std::vector<uint32_t>> moved(chunks);
+                    Parallel::For(
+                        chunks, [&](size_t b, size_t e)
+                        {
+                            for (size_t c = b; c < e; ++c)
+                                for (size_t i = c * Chunk; i < std::min(n, (c + 1) * Chunk); ++i)
+                                {
+                                    uint32_t id = ids ? ids[i] : static_cast<uint32_t>(i);
+                                    if (Fits(nodeOf[id], newPositions[i], radii[id]))
+                                        positions[id] = newPositions[i];
+                                    else
+                                        moved[c].push_back(static_cast<uint32_t>(i));
+                                } },
+                        1);
+                    for (const std::vector<uint32_t> &part : moved)
+                        for (uint32_t i : part)
+                            Relocate(ids ? ids[i] : i, newPositions[i], radii[ids ? ids[i] : i]);
+                }
+
+                // 对与轴对齐盒 [mn, mx] 相交的每个物体调用 fn(id)
+                template <typename F>
+                void Query(const V &mn, const V &mx, F &&fn) const
+                {
+                    Traverse(mn, mx, [&](uint32_t id)
+                             {
+                                 real d2 = 0;
+                                 for (int k = 0; k < D; ++k)
+                                 {
+                                     real p = positions[id][k], d = std::max(std::max(mn[k] - p, p - mx[k]), real(0));
+                                     d2 += d * d;
+                                 }
+                                 if (d2 <= radii[id] * radii[id])
+                                     fn(id); });
+                }
+                void Query(const V &mn, const V &mx, std::vector<uint32_t> &out) const
+                {
+                    out.clear();
+                    Query(mn, mx, [&](uint32_t id)
+                          { out.push_back(id); });
+                }
+
+                // 对与球 (center, radius) 相交的每个物体调用 fn(id)
+                template <typename F>
+                void QueryRadius(const V &center, real radius, F &&fn) const
+                {
+                    V mn = center, mx = center;
+                    for (int k = 0; k < D; ++k)
+                    {
+                        mn[k] -= radius;
+                        mx[k] += radius;
+                    }
+                    Traverse(mn, mx, [&](uint32_t id)
+                             {
+                                 real r = radius + radii[id];
+                                 if ((positions[id] - center).lengthSquared() <= r * r)
+                                     fn(id); });
+                }
+                void QueryRadius(const V &center, real radius, std::vector<uint32_t> &out) const
+                {
+                    out.clear();
+                    QueryRadius(center, radius, [&](uint32_t id)
+                                { out.push_back(id); });
+                }
+
+                // 批量并行半径查询: 第 i 个查询的结果为 out.indices[out.offsets[i], out.offsets[i + 1]) (覆盖 out)
+                void QueryRadius(const V *centers, size_t n, real radius, Geometry2D::IndexBuffer &out) const
+                {
+                    const size_t Chunk = 256;
+                    size_t chunks = (n + Chunk - 1) / Chunk;
+                    std::vector<std::vector<uint32_t>> parts(chunks);
+                    std::vector<size_t> sizes(n);
+                    Parallel::For(
+                        chunks, [&](size_t b, size_t e)
+                        {
+                            for (size_t c = b; c < e; ++c)
+                                for (size_t i = c * Chunk; i < std::min(n, (c + 1) * Chunk); ++i)
+                                {
+                                    size_t before = parts[c].size();
+                                    QueryRadius(centers[i], radius, [&](uint32_t id)
+                                                { parts[c].push_back(id); });
+                                    sizes[i] = parts[c].size() - before;
+                                } },
+                        1);
+                    out.Clear();
+                    size_t total = 0;
+                    for (const std::vector<uint32_t> &part : parts)
+                        total += part.size();
+                    out.indices.reserve(total);
+                    for (const std::vector<uint32_t> &part : parts)
+                        out.indices.insert(out.indices.end(), part.begin(), part.end());
+                    out.offsets.reserve(n + 1);
+                    for (size_t i = 0; i < n; ++i)
+                        out.offsets.push_back(out.offsets.back() + sizes[i]);
+                }
+
+            private:
+                struct Node
+                {
+                    V center;
+                    real half = 0;
+                    uint32_t parent = None;
+                    uint32_t firstChild = None; // 2^D 个子节点连续存放
+                    uint32_t depth = 0;
+                    uint32_t total = 0; // 子树中的物体数
+                    real reach = 0;     // 子树中物体半径的上界, 只增不减, 节点回收时清零
+                    std::vector<uint32_t> items;
+                };
+
+                std::vector<Node> nodes;
+                std::vector<uint32_t> freeBlocks;
+                std::vector<V> positions;
+                std::vector<real> radii;
+                std::vector<uint32_t> nodeOf, slotOf, freeIds;
+                size_t count = 0;
+                uint32_t depthLimit = 10, leafCapacity = 16;
+
+                bool InCell(uint32_t node, const V &p) const
+                {
+                    const Node &nd = nodes[node];
+                    for (int k = 0; k < D; ++k)
+                        if (std::abs(p[k] - nd.center[k]) > nd.half)
+                            return false;
+                    return true;
+                }
+                // 非根节点要求中心在格子内且半径不超过格子半边长. 根节点的物体只有在放不进任何子节点时
+                // (中心在根格子外, 或半径超过子格子半边长) 才留在原处, 根仍是未满的叶节点时除外;
+                // 否则回到根格子内的物体会一直留在根节点, 拖慢之后的每次查询
+                bool Fits(uint32_t node, const V &p, real radius) const
+                {
+                    const Node &nd = nodes[node];
+                    if (node != 0)
+                        return radius <= nd.half && InCell(node, p);
+                    return (nd.firstChild == None && nd.items.size() <= leafCapacity) || radius > nd.half * real(0.5) || !InCell(0, p);
+                }
+                uint32_t ChildIndex(uint32_t node, const V &p) const
+                {
+                    uint32_t c = 0;
+                    for (int k = 0; k < D; ++k)
+                        c |= static_cast<uint32_t>(p[k] >= nodes[node].center[k]) << k;
+                    return nodes[node].firstChild + c;
+                }
+
+                uint32_t AllocBlock()
+                {
+                    if (!freeBlocks.empty())
+                    {
+                        uint32_t first = freeBlocks.back();
+                        freeBlocks.pop_back();
+                        return first;
+                    }
+                    uint32_t first = static_cast<uint32_t>(nodes.size());
+                    nodes.resize(nodes.size() + Children);
+                    return first;
+                }
+                void FreeBlock(uint32_t first)
+                {
+                    for (uint32_t c = first; c < first + Children; ++c)
+                    {
+                        if (nodes[c].firstChild != None)
+                            FreeBlock(nodes[c].firstChild);
+                        nodes[c].firstChild = None;
+                        nodes[c].total = 0;
+                        nodes[c].reach = 0;
+                        nodes[c].items.clear(); // 保留容量
+                    }
+                    freeBlocks.push_back(first);
+                }
+
+                void Subdivide(uint32_t node)
+                {
+                    uint32_t first = AllocBlock();
+                    real half = nodes[node].half * real(0.5);
+                    for (uint32_t c = 0; c < Children; ++c)
+                    {
+                        Node &child = nodes[first + c];
+                        child.center = nodes[node].center;
+                        for (int k = 0; k < D; ++k)
+                            child.center[k] += (c >> k) & 1 ? half : -half;
+                        child.half = half;
+                        child.parent = node;
+                        child.depth = nodes[node].depth + 1;
+                    }
+                    nodes[node].firstChild = first;
+                    // 能放进子节点的物体下移一层
+                    std::vector<uint32_t> &items = nodes[node].items;
+                    for (size_t i = 0; i < items.size();)
+                    {
+                        uint32_t id = items[i];
+                        if (radii[id] > half || (node == 0 && !InCell(0, positions[id])))
+                        {
+                            ++i;
+                            continue;
+                        }
+                        uint32_t child = ChildIndex(node, positions[id]);
+                        items[i] = items.back();
+                        slotOf[items[i]] = static_cast<uint32_t>(i);
+                        items.pop_back();
+                        slotOf[id] = static_cast<uint32_t>(nodes[child].items.size());
+                        nodes[child].items.push_back(id);
+                        nodes[child].total++;
+                        nodes[child].reach = std::max(nodes[child].reach, radii[id]);
+                        nodeOf[id] = child;
+                    }
+                }
+
+                // 从 start 向下找到放置节点, 沿途按需细分
+                void Place(uint32_t id, uint32_t start)
+                {
+                    const V &p = positions[id];
+                    real r = radii[id];
+                    uint32_t node = start;
+                    while (nodes[node].depth < depthLimit && r <= nodes[node].half * real(0.5) && (node != 0 || InCell(0, p)))
+                    {
+                        if (nodes[node].firstChild == None)
+                        {
+                            if (nodes[node].items.size() < leafCapacity)
+                                break;
+                            Subdivide(node);
+                        }
+                        node = ChildIndex(node, p);
+                    }
+                    nodeOf[id] = node;
+                    slotOf[id] = static_cast<uint32_t>(nodes[node].items.size());
+                    nodes[node].items.push_back(id);
+                    for (uint32_t a = node; a != None; a = nodes[a].parent)
+                    {
+                        nodes[a].total++;
+                        nodes[a].reach = std::max(nodes[a].reach, r);
+                    }
+                }
+
+                void Detach(uint32_t id)
+                {
+                    uint32_t node = nodeOf[id];
+                    std::vector<uint32_t> &items = nodes[node].items;
+                    uint32_t slot = slotOf[id];
+                    items[slot] = items.back();
+                    slotOf[items[slot]] = slot;
+                    items.pop_back();
+                    for (uint32_t a = node; a != None; a = nodes[a].parent)
+                        nodes[a].total--;
+                    nodeOf[id] = None;
+                }
+
+                // 子树 (除自身物体外) 为空的最高祖先释放其子节点块
+                void Collapse(uint32_t node)
+                {
+                    uint32_t top = None;
+                    for (uint32_t a = node; a != None; a = nodes[a].parent)
+                        if (nodes[a].firstChild != None && nodes[a].total == nodes[a].items.size())
+                            top = a;
+                    if (top != None)
+                    {
+                        FreeBlock(nodes[top].firstChild);
+                        nodes[top].firstChild = None;
+                    }
+                }
+
+                // 越界物体: 从最近的能容纳它的祖先重新向下放置, 之后回收变空的子树
+                void Relocate(uint32_t id, const V &position, real radius)
+                {
+                    uint32_t old = nodeOf[id];
+                    Detach(id);
+                    positions[id] = position;
+                    radii[id] = radius;
+                    uint32_t start = nodes[old].parent == None ? 0 : nodes[old].parent;
+                    while (start != 0 && !Fits(start, position, radius))
+                        start = nodes[start].parent;
+                    Place(id, start);
+                    Collapse(old);
+                }
+
+                // 遍历松散边界与 [mn, mx] 相交的节点, 对其中物体调用 fn
+                template <typename F>
+                void Traverse(const V &mn, const V &mx, F &&fn) const
+                {
+                    uint32_t stack[Children * (MaxDepth + 1)];
+                    size_t top = 0;
+                    stack[top++] = 0;
+                    while (top > 0)
+                    {
+                        const Node &nd = nodes[stack[--top]];
+                        for (uint32_t id : nd.items)
+                            fn(id);
+                        if (nd.firstChild == None || nd.total == nd.items.size())
+                            continue;
+                        // 子节点的松散边界为格子外扩 reach (不超过格子半边长)
+                        for (uint32_t c = nd.firstChild; c < nd.firstChild + Children; ++c)
+                        {
+                            const Node &ch = nodes[c];
+                            real ext = ch.half + ch.reach;
+                            bool hit = ch.total > 0;
+                            for (int k = 0; k < D; ++k)
+                                hit &= ch.center[k] - ext <= mx[k] && ch.center[k] + ext >= mn[k];
+                            if (hit)
+                                stack[top++] = c;
+                        }
+                    }
+                }
+            };
+        }
+
+        // 二维松散四叉树, 适合每帧移动的圆形物体 (如 Integration2D 推进的智能体)
+        using LooseQuadtree = Detail::LooseTree<Vec2, 2>;
+        // 三维松散八叉树, 物体为球
+        using LooseOctree = Detail::LooseTree<Vec3, 3>;
+    }
+
+    // ====================== 点云配准 ======================
+    namespace Registration
+    {
+        struct RigidTransform
+        {
+            Mat3 rotation;
+            Vec3 translation;
+
+            Vec3 Apply(const Vec3 &p) const { return rotation * p + translation; }
+            // 先应用 o, 再应用 *this
+            RigidTransform operator*(const RigidTransform &o) const { return {rotation * o.rotation, rotation * o.translation + translation}; }
+            RigidTransform Inverse() const
+            {
+                Mat3 rt = rotation.Transpose();
+                return {rt, -(rt * translation)};
+            }
+        };
+
+        // 已知对应关系下的最优刚体变换 (Kabsch / SVD), 最小化 Σ|R s + t - d|²
+        inline RigidTransform AlignPoints(const Vec3 *source, const Vec3 *target, size_t n)
+        {
+            RigidTransform result;
+            if (n == 0)
+                return result;
+            Vec3 cs = Statistics::Mean(source, n), cd = Statistics::Mean(target, n);
+            Mat3 H = Parallel::Reduce(
+                n, Mat3::Zero(), [&](size_t b, size_t e)
+                {
+                    Mat3 h = Mat3::Zero();
+                    for (size_t i = b; i < e; ++i)
+                        h += Mat3::OuterProduct(source[i] - cs, target[i] - cd);
+                    return h; },
+                [](const Mat3 &a, const Mat3 &b)
+                { return a + b; },
+                1 << 14);
+
+            Mat3 U, V;
+            Vec3 sigma;
+            H.SVD(U, sigma, V);
+            Mat3 R = V * U.Transpose();
+            if (R.Det() < 0)
+            {
+                V = Mat3::FromColumns(V.Column(0), V.Column(1), -V.Column(2));
+                R = V * U.Transpose();
+            }
+            result.rotation = R;
+            result.translation = cd - R * cs;
+            return result;
+        }
+
+        // 用 k 近邻的 PCA 最小主轴估计法向 (方向未定向)
+        inline void EstimateNormals(const Vec3 *points, size_t n, const Spatial::KDTree3 &tree, size_t k, Vec3 *normals)
+        {
+            Parallel::For(
+                n, [&](size_t b, size_t e)
+                {
+                    std::vector<size_t> idx(k);
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        size_t found = tree.KNearest(points[i], k, idx.data());
+                        Statistics::Moments3 m;
+                        for (size_t j = 0; j < found; ++j)
+                            m.Add(points[idx[j]]);
+                        normals[i] = found >= 3 ? Statistics::PCA(m).axes[2] : Vec3::Zero();
+                    } },
+                256);
+        }
+
+        struct ICPOptions
+        {
+            int maxIterations = 50;
+            real tolerance = 1e-6f;                                         // RMSE 变化或增量变换小于该值时提前结束
+            real maxCorrespondenceDistance = std::numeric_limits<real>::max(); // 超出该距离的对应点被剔除
+            size_t sampleStride = 1;                                        // 每隔 sampleStride 个源点取一个
+            bool pointToPlane = false;
+        };
+
+        struct ICPResult
+        {
+            RigidTransform transform; // 源点云 -> 目标点云
+            int iterations = 0;
+            real rmse = 0; // 最后一次迭代的对应点 RMSE
+            size_t correspondences = 0;
+            bool converged = false;
+        };
+
+        // 迭代最近点配准; 目标点云建树一次, 可对多帧源点云重复调用 Align
+        class ICP
+        {
+        public:
+            ICP(const Vec3 *target, size_t n, const Vec3 *targetNormals = nullptr)
+                : points(target, target + n), tree(target, n)
+            {
+                if (targetNormals)
+                    normals.assign(targetNormals, targetNormals + n);
+            }
+
+            // 点到平面模式需要目标法向, 未提供时可由此估计
+            void EstimateTargetNormals(size_t k = 8)
+            {
+                normals.resize(points.size());
+                EstimateNormals(points.data(), points.size(), tree, k, normals.data());
+            }
+
+            ICPResult Align(const Vec3 *source, size_t n, const ICPOptions &options = {}, const RigidTransform &initial = {}) const
+            {
+                if (options.pointToPlane && normals.size() != points.size())
+                    throw("ICP: point-to-plane requires target normals");
+
+                ICPResult result;
+                result.transform = initial;
+                size_t stride = std::max<size_t>(options.sampleStride, 1);
+                size_t m = (n + stride - 1) / stride;
+                std::vector<Vec3> moved(m);
+                std::vector<size_t> match(m);
+                std::vector<real> dist(m);
+                std::vector<Vec3> src, dst, nrm;
+                real maxD2 = options.maxCorrespondenceDistance < std::sqrt(std::numeric_limits<real>::max())
+                                 ? options.maxCorrespondenceDistance * options.maxCorrespondenceDistance
+                                 : std::numeric_limits<real>::max();
+                real prevRmse = std::numeric_limits<real>::max();
+
+                for (int iter = 0; iter < options.maxIterations; ++iter)
+                {
+                    const RigidTransform current = result.transform;
+                    Parallel::For(
+                        m, [&](size_t b, size_t e)
+                        {
+                            for (size_t i = b; i < e; ++i)
+                            {
+                                moved[i] = current.Apply(source[i * stride]);
+                                match[i] = tree.Nearest(moved[i], &dist[i], maxD2);
+                            } },
+                        512);
+
+                    src.clear();
+                    dst.clear();
+                    nrm.clear();
+                    real sum = 0;
+                    for (size_t i = 0; i < m; ++i)
+                    {
+                        if (match[i] == Spatial::npos)
+                            continue;
+                        src.push_back(moved[i]);
+                        dst.push_back(points[match[i]]);
+                        if (options.pointToPlane)
+                            nrm.push_back(normals[match[i]]);
+                        sum += dist[i];
+                    }
+                    result.iterations = iter + 1;
+                    result.correspondences = src.size();
+                    if (src.size() < (options.pointToPlane ? 6u : 3u))
+                        break;
+                    result.rmse = std::sqrt(sum / src.size());
+
+                    RigidTransform step = options.pointToPlane ? PointToPlaneStep(src, dst, nrm) : AlignPoints(src.data(), dst.data(), src.size());
+                    result.transform = step * current;
+
+                    real angle = std::acos(MathTools::Clamp((step.rotation.Trace() - 1) * 0.5f, -1, 1));
+                    if (std::abs(prevRmse - result.rmse) < options.tolerance ||
+                        (angle < options.tolerance && step.translation.length() < options.tolerance))
+                    {
+                        result.converged = true;
+                        break;
+                    }
+                    prevRmse = result.rmse;
+                }
+                return result;
+            }
+
+        private:
+            // 线性化的点到平面最小二乘: 未知量 [ω, t], 残差 (s + ω×s + t - d)·n
+            static RigidTransform PointToPlaneStep(const std::vector<Vec3> &src, const std::vector<Vec3> &dst, const std::vector<Vec3> &nrm)
+            {
+                struct System
+                {
+                    real a[6][6] = {};
+                    real b[6] = {};
+                };
+                System sys = Parallel::Reduce(
+                    src.size(), System{}, [&](size_t lo, size_t hi)
+                    {
+                        System s;
+                        for (size_t i = lo; i < hi; ++i)
+                        {
+                            Vec3 c = src[i].cross(nrm[i]);
+                            real row[6] = {c.x, c.y, c.z, nrm[i].x, nrm[i].y, nrm[i].z};
+                            real r = (dst[i] - src[i]).dot(nrm[i]);
+                            for (int j = 0; j < 6; ++j)
+                            {
+                                for (int k = j; k < 6; ++k)
+                                    s.a[j][k] += row[j] * row[k];
+                                s.b[j] += row[j] * r;
+                            }
+                        }
+                        return s; },
+                    [](System x, const System &y)
+                    {
+                        for (int j = 0; j < 6; ++j)
+                        {
+                            for (int k = 0; k < 6; ++k)
+                                x.a[j][k] += y.a[j][k];
+                            x.b[j] += y.b[j];
+                        }
+                        return x; },
+                    1 << 14);
+                for (int j = 0; j < 6; ++j)
+                    for (int k = 0; k < j; ++k)
+                        sys.a[j][k] = sys.a[k][j];
+
+                real x[6];
+                if (!MathTools::SolveLinear(&sys.a[0][0], sys.b, x, 6))
+                    return {};
+
+                RigidTransform step;
+                Vec3 omega(x[0], x[1], x[2]);
+                real angle = omega.length();
+                if (angle > 0)
+                    step.rotation = Mat3::Rotation(omega / angle, angle);
+                step.translation = {x[3], x[4], x[5]};
+                return step;
+            }
+
+            std::vector<Vec3> points;
+            std::vector<Vec3> normals;
+            Spatial::KDTree3 tree;
+        };
+    }
+
+    // ====================== 最小二乘拟合 ======================
+    namespace Fitting
+    {
+        // 总体最小二乘直线 (PCA 主方向)
+        inline Geometry2D::Line FitLine(const Vec2 *points, size_t n)
+        {
+            Statistics::Moments2 m;
+            m.Add(points, n);
+            Statistics::PrincipalAxes2 pca = Statistics::PCA(m);
+            return {pca.mean, pca.axes[0]};
+        }
+
+        // 总体最小二乘平面 (PCA 最小主方向为法向)
+        inline Geometry3D::Plane FitPlane(const Vec3 *points, size_t n)
+        {
+            Statistics::Moments3 m;
+            m.Add(points, n);
+            return Geometry3D::Plane::FromPointNormal(m.mean, Statistics::PCA(m).axes[2]);
+        }
+
+        // 圆拟合: 中心化的 Kåsa 代数解作初值, 再做 refineIterations 次 Gauss-Newton 几何距离迭代
+        inline Geometry2D::Circle FitCircle(const Vec2 *points, size_t n, int refineIterations = 4)
+        {
+            Geometry2D::Circle circle;
+            if (n < 3)
+                return circle;
+            Vec2 mean;
+            for (size_t i = 0; i < n; ++i)
+                mean += points[i];
+            mean /= static_cast<real>(n);
+
+            real suu = 0, suv = 0, svv = 0, suz = 0, svz = 0, sz = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                real u = points[i].x - mean.x, v = points[i].y - mean.y, z = u * u + v * v;
+                suu += u * u;
+                suv += u * v;
+                svv += v * v;
+                suz += u * z;
+                svz += v * z;
+                sz += z;
+            }
+            real a[9] = {suu, suv, 0, suv, svv, 0, 0, 0, static_cast<real>(n)};
+            real b[3] = {-suz, -svz, -sz};
+            real x[3];
+            if (!MathTools::SolveLinear(a, b, x, 3))
+                return circle;
+            circle.center = mean + Vec2{-x[0] * 0.5f, -x[1] * 0.5f};
+            circle.radius = std::sqrt(std::max<real>(0, (x[0] * x[0] + x[1] * x[1]) * 0.25f - x[2]));
+
+            for (int it = 0; it < refineIterations; ++it)
+            {
+                real jtj[9] = {}, jtr[3] = {};
+                for (size_t i = 0; i < n; ++i)
+                {
+                    Vec2 d = points[i] - circle.center;
+                    real len = d.length();
+                    if (len < Constants::Epsilon)
+                        continue;
+                    real row[3] = {-d.x / len, -d.y / len, -1};
+                    real r = len - circle.radius;
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                            jtj[j * 3 + k] += row[j] * row[k];
+                        jtr[j] -= row[j] * r;
+                    }
+                }
+                real step[3];
+                if (!MathTools::SolveLinear(jtj, jtr, step, 3))
+                    break;
+                circle.center += Vec2{step[0], step[1]};
+                circle.radius += step[2];
+                if (std::abs(step[0]) + std::abs(step[1]) + std::abs(step[2]) < Constants::Epsilon * (circle.radius + 1))
+                    break;
+            }
+            return circle;
+        }
+
+        // 多项式回归, coeffs[0..degree] 为升幂系数; x 先归一化到 [-1, 1] 再解法方程以改善条件数.
+        // degree < 0 时不写 coeffs 直接返回 false; 其余失败情况 coeffs 全为零
+        inline bool FitPolynomial(const real *xs, const real *ys, size_t n, int degree, real *coeffs)
+        {
+            if (degree < 0)
+                return false;
+            int m = degree + 1;
+            std::fill(coeffs, coeffs + m, real(0));
+            if (n < static_cast<size_t>(m))
+                return false;
+            real lo = *std::min_element(xs, xs + n), hi = *std::max_element(xs, xs + n);
+            real c = (lo + hi) * 0.5f, s = (hi - lo) * 0.5f;
+            if (s < Constants::Epsilon)
+                s = 1;
+
+            std::vector<real> powerSums(2 * m - 1, 0), a(m * m), b(m, 0), q(m);
+            for (size_t i = 0; i < n; ++i)
+            {
+                real t = (xs[i] - c) / s, tp = 1;
+                for (int k = 0; k < 2 * m - 1; ++k)
+                {
+                    powerSums[k] += tp;
+                    if (k < m)
+                        b[k] += ys[i] * tp;
+                    tp *= t;
+                }
+            }
+            for (int j = 0; j < m; ++j)
+                for (int k = 0; k < m; ++k)
+                    a[j * m + k] = powerSums[j + k];
+            if (!MathTools::SolveLinear(a.data(), b.data(), q.data(), m))
+                return false;
+
+            // 展开 Σ q_j ((x - c) / s)^j
+            std::vector<real> binom(m, 0);
+            for (int j = 0; j < m; ++j)
+            {
+                binom[j] = 1;
+                for (int i = j - 1; i > 0; --i)
+                    binom[i] += binom[i - 1];
+                real scale = q[j] / std::pow(s, static_cast<real>(j)), negC = 1;
+                for (int i = j; i >= 0; --i)
+                {
+                    coeffs[i] += scale * binom[i] * negC;
+                    negC *= -c;
+                }
+            }
+            return true;
+        }
+        inline real EvaluatePolynomial(const real *coeffs, int degree, real x)
+        {
+            real r = 0;
+            for (int i = degree; i >= 0; --i)
+                r = r * x + coeffs[i];
+            return r;
+        }
+
+        // 批量拟合: 第 i 组数据为 [offsets[i], offsets[i + 1])
+        inline void FitLines(const Vec2 *points, const size_t *offsets, size_t count, Geometry2D::Line *out)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = FitLine(points + offsets[i], offsets[i + 1] - offsets[i]); },
+                256);
+        }
+        inline void FitCircles(const Vec2 *points, const size_t *offsets, size_t count, Geometry2D::Circle *out, int refineIterations = 4)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = FitCircle(points + offsets[i], offsets[i + 1] - offsets[i], refineIterations); },
+                256);
+        }
+        inline void FitPlanes(const Vec3 *points, const size_t *offsets, size_t count, Geometry3D::Plane *out)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = FitPlane(points + offsets[i], offsets[i + 1] - offsets[i]); },
+                256);
+        }
+        // coeffs 每组占 degree + 1 个; 返回拟合失败的组数 (degree < 0 时全部失败)
+        inline size_t FitPolynomials(const real *xs, const real *ys, const size_t *offsets, size_t count, int degree, real *coeffs)
+        {
+            if (degree < 0)
+                return count;
+            std::atomic<size_t> failed(0);
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        if (!FitPolynomial(xs + offsets[i], ys + offsets[i], offsets[i + 1] - offsets[i], degree, coeffs + i * (degree + 1)))
+                            failed.fetch_add(1, std::memory_order_relaxed); },
+                256);
+            return failed.load();
+        }
+
+        // ---------------- 最小包围圆 / 球与有向包围盒 ----------------
+        namespace Detail
+        {
+            // 包含判定留相对容差, 避免浮点误差使随机增量算法反复重建
+            constexpr real EnclosingSlack = 1 + 64 * Constants::Epsilon;
+
+            // 以 a, b 为直径的圆 / 球
+            inline Geometry2D::Circle Diametral(const Vec2 &a, const Vec2 &b) { return {(a + b) * 0.5f, (b - a).length() * 0.5f}; }
+            inline Geometry3D::Sphere Diametral(const Vec3 &a, const Vec3 &b) { return {(a + b) * 0.5f, (b - a).length() * 0.5f}; }
+
+            inline bool Encloses(const Geometry2D::Circle &c, const Vec2 &p) { return (p - c.center).lengthSquared() <= c.radius * c.radius * EnclosingSlack; }
+            inline bool Encloses(const Geometry3D::Sphere &s, const Vec3 &p) { return (p - s.center).lengthSquared() <= s.radius * s.radius * EnclosingSlack; }
+
+            // 退化 (共线 / 共面) 时的兜底: 在 m <= 4 个点的直径圆 / 外接圆中取包含全部点的最小者
+            template <typename Ball, typename V, typename Circum>
+            inline Ball SmallestOf(const V *s, int m, Circum circum)
+            {
+                Ball best;
+                best.radius = std::numeric_limits<real>::max();
+                auto consider = [&](const Ball &b)
+                {
+                    if (b.radius >= best.radius)
+                        return;
+                    for (int i = 0; i < m; ++i)
+                        if (!Encloses(b, s[i]))
+                            return;
+                    best = b;
+                };
+                for (int i = 0; i < m; ++i)
+                    for (int j = i + 1; j < m; ++j)
+                    {
+                        consider(Diametral(s[i], s[j]));
+                        for (int k = j + 1; k < m; ++k)
+                        {
+                            Ball b;
+                            if (circum(s[i], s[j], s[k], b))
+                                consider(b);
+                        }
+                    }
+                return best;
+            }
+
+            // 空间中三点的外接圆 (所在平面内), 共线时返回 false
+            inline bool Circumcircle3(const Vec3 &a, const Vec3 &b, const Vec3 &c, Geometry3D::Sphere &out)
+            {
+                Vec3 ab = b - a, ac = c - a, n = ab.cross(ac);
+                real n2 = n.lengthSquared();
+                if (n2 < Constants::Epsilon * ab.lengthSquared() * ac.lengthSquared())
+                    return false;
+                Vec3 offset = (ac.cross(n) * ab.lengthSquared() + n.cross(ab) * ac.lengthSquared()) / (2 * n2);
+                out = {a + offset, offset.length()};
+                return true;
+            }
+            // 四点外接球, 共面时返回 false
+            inline bool Circumsphere(const Vec3 &a, const Vec3 &b, const Vec3 &c, const Vec3 &d, Geometry3D::Sphere &out)
+            {
+                Vec3 ab = b - a, ac = c - a, ad = d - a;
+                real det = 2 * ab.dot(ac.cross(ad));
+                real scale = ab.length() * ac.length() * ad.length();
+                if (std::abs(det) < Constants::Epsilon * scale)
+                    return false;
+                Vec3 offset = (ac.cross(ad) * ab.lengthSquared() + ad.cross(ab) * ac.lengthSquared() + ab.cross(ac) * ad.lengthSquared()) / det;
+                out = {a + offset, offset.length()};
+                return true;
+            }
+
+            // 打乱后的点 (平移到首点为原点以减小浮点误差), 每个线程复用一份缓冲
+            template <typename V>
+            inline std::vector<V> &ShuffledCopy(const V *points, size_t n, uint64_t seed, V &origin)
+            {
+                thread_local std::vector<V> scratch;
+                origin = points[0];
+                scratch.resize(n);
+                for (size_t i = 0; i < n; ++i)
+                    scratch[i] = points[i] - origin;
+                MathTools::FastRandom rng(seed);
+                for (size_t i = n; i > 1; --i)
+                    std::swap(scratch[i - 1], scratch[rng.Index(i)]);
+                return scratch;
+            }
+
+            // 旋转卡壳: 凸多边形 (逆时针, 无共线点) 的最小面积外接矩形, 四个卡壳随边单调前进, O(h)
+            inline Geometry2D::OBB MinAreaRect(const std::vector<Vec2> &hull)
+            {
+                Geometry2D::OBB box;
+                size_t h = hull.size();
+                if (h == 0)
+                    return box;
+                if (h < 3)
+                {
+                    Vec2 d = hull[h - 1] - hull[0];
+                    real len = d.length();
+                    box.center = (hull[0] + hull[h - 1]) * 0.5f;
+                    if (len > 0)
+                    {
+                        box.axes[0] = d / len;
+                        box.axes[1] = box.axes[0].perpendicular();
+                    }
+                    box.halfExtents = {len * 0.5f, 0};
+                    return box;
+                }
+                Vec2 origin = hull[0];
+                auto at = [&](size_t i)
+                { return hull[i % h] - origin; };
+                size_t right = 0, top = 0, left = 0;
+                real best = std::numeric_limits<real>::max();
+                for (size_t i = 0; i < h; ++i)
+                {
+                    // 凸包已去重, 边长非零; 不用 normalize (过短的边会被它置零)
+                    Vec2 edge = at(i + 1) - at(i), u = edge / edge.length(), v = u.perpendicular();
+                    if (i == 0)
+                        for (size_t k = 1; k < h; ++k)
+                        {
+                            if (at(k).dot(u) > at(right).dot(u))
+                                right = k;
+                            if (at(k).dot(v) > at(top).dot(v))
+                                top = k;
+                            if (at(k).dot(u) < at(left).dot(u))
+                                left = k;
+                        }
+                    while (at(right + 1).dot(u) > at(right).dot(u))
+                        right = (right + 1) % h;
+                    while (at(top + 1).dot(v) > at(top).dot(v))
+                        top = (top + 1) % h;
+                    while (at(left + 1).dot(u) < at(left).dot(u))
+                        left = (left + 1) % h;
+                    real minU = at(left).dot(u), maxU = at(right).dot(u), minV = at(i).dot(v), maxV = at(top).dot(v);
+                    real area = (maxU - minU) * (maxV - minV);
+                    if (area < best)
+                    {
+                        best = area;
+                        box.axes[0] = u;
+                        box.axes[1] = v;
+                        box.halfExtents = {(maxU - minU) * 0.5f, (maxV - minV) * 0.5f};
+                        box.center = origin + u * ((maxU + minU) * 0.5f) + v * ((maxV + minV) * 0.5f);
+                    }
+                }
+                return box;
+            }
+
+            // 给定两条正交轴, 由投影范围确定盒
+            inline Geometry2D::OBB BoxAlong(const Vec2 *points, size_t n, const Vec2 &u, const Vec2 &v)
+            {
+                real lo[2] = {std::numeric_limits<real>::max(), std::numeric_limits<real>::max()}, hi[2] = {std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest()};
+                for (size_t i = 0; i < n; ++i)
+                {
+                    Vec2 d = points[i] - points[0];
+                    real a = d.dot(u), b = d.dot(v);
+                    lo[0] = std::min(lo[0], a);
+                    hi[0] = std::max(hi[0], a);
+                    lo[1] = std::min(lo[1], b);
+                    hi[1] = std::max(hi[1], b);
+                }
+                Geometry2D::OBB box;
+                box.axes[0] = u;
+                box.axes[1] = v;
+                box.halfExtents = {(hi[0] - lo[0]) * 0.5f, (hi[1] - lo[1]) * 0.5f};
+                box.center = points[0] + u * ((hi[0] + lo[0]) * 0.5f) + v * ((hi[1] + lo[1]) * 0.5f);
+                return box;
+            }
+            inline Geometry3D::OBB BoxAlong(const Vec3 *points, size_t n, const Vec3 *axes)
+            {
+                Vec3 lo(std::numeric_limits<real>::max(), std::numeric_limits<real>::max(), std::numeric_limits<real>::max());
+                Vec3 hi(std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest());
+                for (size_t i = 0; i < n; ++i)
+                {
+                    Vec3 d = points[i] - points[0];
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        real t = d.dot(axes[k]);
+                        lo[k] = std::min(lo[k], t);
+                        hi[k] = std::max(hi[k], t);
+                    }
+                }
+                Geometry3D::OBB box;
+                box.center = points[0];
+                for (int k = 0; k < 3; ++k)
+                {
+                    box.axes[k] = axes[k];
+                    box.halfExtents[k] = (hi[k] - lo[k]) * 0.5f;
+                    box.center = box.center + axes[k] * ((hi[k] + lo[k]) * 0.5f);
+                }
+                return box;
+            }
+        }
+
+        // Welzl 最小包围圆 (随机增量的迭代形式, 期望线性时间); seed 决定打乱顺序
+        inline Geometry2D::Circle MinEnclosingCircle(const Vec2 *points, size_t n, uint64_t seed = 0)
+        {
+            if (n == 0)
+                return {};
+            Vec2 origin;
+            std::vector<Vec2> &p = Detail::ShuffledCopy(points, n, seed, origin);
+            auto circum = [](const Vec2 &a, const Vec2 &b, const Vec2 &c, Geometry2D::Circle &out)
+            { return Geometry2D::Circumcircle(a, b, c, out); };
+            Geometry2D::Circle c{p[0], 0};
+            for (size_t i = 1; i < n; ++i)
+            {
+                if (Detail::Encloses(c, p[i]))
+                    continue;
+                c = {p[i], 0};
+                for (size_t j = 0; j < i; ++j)
+                {
+                    if (Detail::Encloses(c, p[j]))
+                        continue;
+                    c = Detail::Diametral(p[i], p[j]);
+                    for (size_t k = 0; k < j; ++k)
+                    {
+                        if (Detail::Encloses(c, p[k]))
+                            continue;
+                        Vec2 s[3] = {p[i], p[j], p[k]};
+                        if (!Geometry2D::Circumcircle(p[i], p[j], p[k], c))
+                            c = Detail::SmallestOf<Geometry2D::Circle>(s, 3, circum);
+                    }
+                }
+            }
+            c.center = c.center + origin;
+            return c;
+        }
+        inline Geometry2D::Circle MinEnclosingCircle(const std::vector<Vec2> &points, uint64_t seed = 0) { return MinEnclosingCircle(points.data(), points.size(), seed); }
+
+        // Welzl 最小包围球, 边界点集逐层增至 4 个
+        inline Geometry3D::Sphere MinEnclosingSphere(const Vec3 *points, size_t n, uint64_t seed = 0)
+        {
+            if (n == 0)
+                return {};
+            Vec3 origin;
+            std::vector<Vec3> &p = Detail::ShuffledCopy(points, n, seed, origin);
+            auto circum = [](const Vec3 &a, const Vec3 &b, const Vec3 &c, Geometry3D::Sphere &out)
+            { return Detail::Circumcircle3(a, b, c, out); };
+            Geometry3D::Sphere s{p[0], 0};
+            for (size_t i = 1; i < n; ++i)
+            {
+                if (Detail::Encloses(s, p[i]))
+                    continue;
+                s = {p[i], 0};
+                for (size_t j = 0; j < i; ++j)
+                {
+                    if (Detail::Encloses(s, p[j]))
+                        continue;
+                    s = Detail::Diametral(p[i], p[j]);
+                    for (size_t k = 0; k < j; ++k)
+                    {
+                        if (Detail::Encloses(s, p[k]))
+                            continue;
+                        Vec3 three[3] = {p[i], p[j], p[k]};
+                        if (!Detail::Circumcircle3(p[i], p[j], p[k], s))
+                            s = Detail::SmallestOf<Geometry3D::Sphere>(three, 3, circum);
+                        for (size_t l = 0; l < k; ++l)
+                        {
+                            if (Detail::Encloses(s, p[l]))
+                                continue;
+                            Vec3 four[4] = {p[i], p[j], p[k], p[l]};
+                            if (!Detail::Circumsphere(p[i], p[j], p[k], p[l], s))
+                                s = Detail::SmallestOf<Geometry3D::Sphere>(four, 4, circum);
+                        }
+                    }
+                }
+            }
+            s.center = s.center + origin;
+            return s;
+        }
+        inline Geometry3D::Sphere MinEnclosingSphere(const std::vector<Vec3> &points, uint64_t seed = 0) { return MinEnclosingSphere(points.data(), points.size(), seed); }
+
+        // 有向包围盒拟合方法: PCA 取协方差主方向 (快, 近似);
+        // RotatingCalipers 在凸包上旋转卡壳 (2D 为最小面积的精确解; 3D 从 PCA 盒出发, 轮流固定一条轴在其正交平面内
+        // 求最小矩形, 结果不差于 PCA 但只是局部最优)
+        enum class OBBMethod
+        {
+            PCA,
+            RotatingCalipers
+        };
+
+        inline Geometry2D::OBB FitOBB(const Vec2 *points, size_t n, OBBMethod method = OBBMethod::RotatingCalipers)
+        {
+            if (n == 0)
+                return {};
+            if (method == OBBMethod::RotatingCalipers)
+                return Detail::MinAreaRect(Geometry2D::ConvexHull(points, n));
+            Statistics::PrincipalAxes2 pca = Statistics::PCA(points, n);
+            return Detail::BoxAlong(points, n, pca.axes[0], pca.axes[1]);
+        }
+
+        inline Geometry3D::OBB FitOBB(const Vec3 *points, size_t n, OBBMethod method = OBBMethod::RotatingCalipers)
+        {
+            if (n == 0)
+                return {};
+            Statistics::PrincipalAxes3 pca = Statistics::PCA(points, n);
+            Geometry3D::OBB best = Detail::BoxAlong(points, n, pca.axes);
+            if (method == OBBMethod::PCA)
+                return best;
+            std::vector<Vec2> projected(n);
+            // 交替优化: 依次固定当前最优盒的一条轴, 在其正交平面内做二维卡壳, 直到体积不再明显减小
+            for (int round = 0; round < 4; ++round)
+            {
+                real before = best.Volume();
+                for (int k = 0; k < 3; ++k)
+                {
+                    Vec3 fixed = best.axes[k], e0 = best.axes[(k + 1) % 3], e1 = best.axes[(k + 2) % 3];
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        Vec3 d = points[i] - points[0];
+                        projected[i] = {d.dot(e0), d.dot(e1)};
+                    }
+                    Geometry2D::OBB rect = Detail::MinAreaRect(Geometry2D::ConvexHull(projected.data(), n));
+                    Vec3 axes[3] = {e0 * rect.axes[0].x + e1 * rect.axes[0].y, e0 * rect.axes[1].x + e1 * rect.axes[1].y, fixed};
+                    Geometry3D::OBB box = Detail::BoxAlong(points, n, axes);
+                    if (box.Volume() < best.Volume())
+                        best = box;
+                }
+                if (best.Volume() > before * (1 - 1e-3f))
+                    break;
+            }
+            return best;
+        }
+
+        // 批量拟合: 第 i 组点为 [offsets[i], offsets[i + 1]), 各组并行
+        inline void MinEnclosingCircles(const Vec2 *points, const size_t *offsets, size_t count, Geometry2D::Circle *out, uint64_t seed = 0)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = MinEnclosingCircle(points + offsets[i], offsets[i + 1] - offsets[i], seed); },
+                64);
+        }
+        inline void MinEnclosingSpheres(const Vec3 *points, const size_t *offsets, size_t count, Geometry3D::Sphere *out, uint64_t seed = 0)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = MinEnclosingSphere(points + offsets[i], offsets[i + 1] - offsets[i], seed); },
+                64);
+        }
+        inline void FitOBBs(const Vec2 *points, const size_t *offsets, size_t count, Geometry2D::OBB *out, OBBMethod method = OBBMethod::RotatingCalipers)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = FitOBB(points + offsets[i], offsets[i + 1] - offsets[i], method); },
+                64);
+        }
+        inline void FitOBBs(const Vec3 *points, const size_t *offsets, size_t count, Geometry3D::OBB *out, OBBMethod method = OBBMethod::RotatingCalipers)
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = FitOBB(points + offsets[i], offsets[i + 1] - offsets[i], method); },
+                64);
+        }
+
+        // ---------------- RANSAC ----------------
+        struct RansacOptions
+        {
+            int maxIterations = 1000;
+            real inlierThreshold = 0.01f; // 点到模型的最大距离
+            real confidence = 0.99f;      // 达到该置信度后提前结束
+            uint64_t seed = 0;            // 第 h 个假设使用流 (seed, h), 结果与线程数无关
+            bool refit = true;            // 用全部内点做最小二乘精化
+        };
+
+        template <typename Model>
+        struct RansacResult
+        {
+            Model model;
+            size_t inliers = 0;
+            int iterations = 0;
+            bool found = false;
+        };
+
+        // 通用 RANSAC (最小样本数不超过 8): 每轮并行评估一批假设; 计数时一旦无法超过当前最优即提前退出
+        template <typename Model, typename Point, typename Hypothesize, typename DistanceFn>
+        RansacResult<Model> Ransac(const Point *points, size_t n, int sampleSize, const RansacOptions &options,
+                                   Hypothesize &&hypothesize, DistanceFn &&distance)
+        {
+            if (sampleSize > 8)
+                throw("Ransac: sample size must not exceed 8");
+            RansacResult<Model> best;
+            if (n < static_cast<size_t>(sampleSize))
+                return best;
+            const size_t batch = static_cast<size_t>(Parallel::ThreadPool::Instance().Concurrency()) * 8;
+            std::vector<Model> models(batch);
+            std::vector<size_t> counts(batch);
+            int needed = options.maxIterations;
+
+            while (best.iterations < needed)
+            {
+                size_t m = std::min(batch, static_cast<size_t>(needed - best.iterations));
+                size_t bound = best.inliers;
+                int base = best.iterations;
+                Parallel::For(
+                    m, [&](size_t b, size_t e)
+                    {
+                        for (size_t h = b; h < e; ++h)
+                        {
+                            counts[h] = 0;
+                            MathTools::FastRandom rng(options.seed, static_cast<uint64_t>(base) + h);
+                            Point sample[8];
+                            size_t picked[8];
+                            for (int k = 0; k < sampleSize; ++k)
+                            {
+                                size_t idx;
+                                bool dup;
+                                do
+                                {
+                                    idx = rng.Index(n);
+                                    dup = std::find(picked, picked + k, idx) != picked + k;
+                                } while (dup);
+                                picked[k] = idx;
+                                sample[k] = points[idx];
+                            }
+                            if (!hypothesize(sample, models[h]))
+                                continue;
+                            size_t c = 0;
+                            for (size_t i = 0; i < n; ++i)
+                            {
+                                if (distance(models[h], points[i]) <= options.inlierThreshold)
+                                    ++c;
+                                if ((i & 63) == 63 && c + (n - i - 1) <= bound)
+                                    break;
+                            }
+                            counts[h] = c;
+                        } },
+                    1);
+
+                for (size_t h = 0; h < m; ++h)
+                {
+                    if (counts[h] > best.inliers)
+                    {
+                        best.inliers = counts[h];
+                        best.model = models[h];
+                        best.found = true;
+                    }
+                }
+                best.iterations += static_cast<int>(m);
+
+                // 自适应迭代次数: log(1 - p) / log(1 - w^s)
+                real w = static_cast<real>(best.inliers) / static_cast<real>(n);
+                real ws = std::pow(w, static_cast<real>(sampleSize));
+                if (ws >= 1)
+                    break;
+                if (ws > 0)
+                {
+                    real k = std::log(1 - options.confidence) / std::log(1 - ws);
+                    needed = static_cast<int>(std::min<real>(static_cast<real>(options.maxIterations), std::ceil(k)));
+                }
+            }
+            return best;
+        }
+
+        template <typename Point, typename Model, typename DistanceFn>
+        std::vector<Point> CollectInliers(const Point *points, size_t n, const Model &model, real threshold, DistanceFn &&distance)
+        {
+            std::vector<Point> inliers;
+            for (size_t i = 0; i < n; ++i)
+                if (distance(model, points[i]) <= threshold)
+                    inliers.push_back(points[i]);
+            return inliers;
+        }
+
+        inline RansacResult<Geometry2D::Line> RansacLine(const Vec2 *points, size_t n, const RansacOptions &options = {})
+        {
+            auto distance = [](const Geometry2D::Line &l, const Vec2 &p)
+            { return l.Distance(p); };
+            auto result = Ransac<Geometry2D::Line>(
+                points, n, 2, options, [](const Vec2 *s, Geometry2D::Line &l)
+                {
+                    // 退化判断相对于样本坐标量级, 毫米/微米尺度的数据同样适用
+                    Vec2 d = s[1] - s[0];
+                    real len2 = d.lengthSquared();
+                    if (len2 <= Constants::Epsilon * (s[0].lengthSquared() + s[1].lengthSquared()))
+                        return false;
+                    l = {s[0], d / std::sqrt(len2)};
+                    return true; },
+                distance);
+            if (result.found && options.refit)
+            {
+                auto inliers = CollectInliers(points, n, result.model, options.inlierThreshold, distance);
+                result.model = FitLine(inliers.data(), inliers.size());
+            }
+            return result;
+        }
+
+        inline RansacResult<Geometry2D::Circle> RansacCircle(const Vec2 *points, size_t n, const RansacOptions &options = {})
+        {
+            auto distance = [](const Geometry2D::Circle &c, const Vec2 &p)
+            { return c.Distance(p); };
+            auto result = Ransac<Geometry2D::Circle>(
+                points, n, 3, options, [](const Vec2 *s, Geometry2D::Circle &c)
+                { return Geometry2D::Circumcircle(s[0], s[1], s[2], c); },
+                distance);
+            if (result.found && options.refit)
+            {
+                auto inliers = CollectInliers(points, n, result.model, options.inlierThreshold, distance);
+                result.model = FitCircle(inliers.data(), inliers.size());
+            }
+            return result;
+        }
+
+        inline RansacResult<Geometry3D::Plane> RansacPlane(const Vec3 *points, size_t n, const RansacOptions &options = {})
+        {
+            auto distance = [](const Geometry3D::Plane &pl, const Vec3 &p)
+            { return std::abs(pl.SignedDistance(p)); };
+            auto result = Ransac<Geometry3D::Plane>(
+                points, n, 3, options, [](const Vec3 *s, Geometry3D::Plane &pl)
+                {
+                    // 共线判断: |e1 x e2|^2 = |e1|^2 |e2|^2 sin^2, 与坐标尺度无关
+                    Vec3 e1 = s[1] - s[0], e2 = s[2] - s[0];
+                    Vec3 nrm = e1.cross(e2);
+                    real len2 = nrm.lengthSquared();
+                    if (len2 <= Constants::Epsilon * e1.lengthSquared() * e2.lengthSquared())
+                        return false;
+                    nrm = nrm / std::sqrt(len2);
+                    pl = {nrm, -nrm.dot(s[0])};
+                    return true; },
+                distance);
+            if (result.found && options.refit)
+            {
+                auto inliers = CollectInliers(points, n, result.model, options.inlierThreshold, distance);
+                result.model = FitPlane(inliers.data(), inliers.size());
+            }
+            return result;
+        }
+    }
+
+    // ====================== 流式外存处理 ======================
+    // 点文件为连续存放的 Vec3 原始二进制 (本机字节序, 每点 3 个 real).
+    // 读写均为双缓冲: 处理当前块时后台读取下一块 / 写出上一块, 内存占用不超过 memoryBudget
+    namespace Streaming
+    {
+        constexpr size_t DefaultMemoryBudget = size_t(256) << 20;
+
+        using FileHandle = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
+
+        inline FileHandle OpenFile(const char *path, const char *mode)
+        {
+            FileHandle file(std::fopen(path, mode), &std::fclose);
+            if (!file)
+                throw("Streaming: cannot open file");
+            return file;
+        }
+
+        // 后台顺序写出: 同一时刻最多一个写操作在进行, 与下一块的计算重叠
+        template <typename T>
+        class BufferedWriter
+        {
+        public:
+            BufferedWriter(const char *path, size_t capacity)
+                : file(OpenFile(path, "wb")), buffers{std::vector<T>(std::max<size_t>(capacity, 1)), std::vector<T>(std::max<size_t>(capacity, 1))} {}
+            ~BufferedWriter()
+            {
+                try
+                {
+                    Finish();
+                }
+                catch (...)
+                {
+                }
+            }
+
+            T *Buffer() { return buffers[current].data(); }
+            size_t Capacity() const { return buffers[0].size(); }
+
+            // 提交当前缓冲区的前 count 个元素
+            void Commit(size_t count)
+            {
+                if (pending.Valid())
+                    pending.Get();
+                const T *data = buffers[current].data();
+                std::FILE *f = file.get();
+                pending = Async::Run([data, count, f](Async::JobContext &)
+                                     {
+                    if (std::fwrite(data, sizeof(T), count, f) != count)
+                        throw("Streaming: write failed");
+                    return count; });
+                current ^= 1;
+            }
+            void Finish()
+            {
+                if (pending.Valid())
+                {
+                    Async::Task<size_t> last = pending;
+                    pending = {};
+                    last.Get();
+                }
+                if (file && std::fflush(file.get()) != 0)
+                    throw("Streaming: write failed");
+            }
+
+        private:
+            FileHandle file;
+            std::vector<T> buffers[2];
+            size_t current = 0;
+            Async::Task<size_t> pending;
+        };
+
+        // 逐块遍历点文件, fn(points, count, firstIndex); 每块最多 chunkPoints 个点
+        template <typename F>
+        size_t ForEachChunk(const char *path, size_t chunkPoints, F &&fn)
+        {
+            FileHandle file = OpenFile(path, "rb");
+            chunkPoints = std::max<size_t>(chunkPoints, 1);
+            std::vector<Vec3> front(chunkPoints), back(chunkPoints);
+            std::FILE *f = file.get();
+            size_t count = std::fread(front.data(), sizeof(Vec3), chunkPoints, f), index = 0;
+            while (count > 0)
+            {
+                Vec3 *next = back.data();
+                Async::Task<size_t> prefetch = Async::Run([f, next, chunkPoints](Async::JobContext &)
+                                                          { return std::fread(next, sizeof(Vec3), chunkPoints, f); });
+                try
+                {
+                    fn(static_cast<const Vec3 *>(front.data()), count, index);
+                }
+                catch (...)
+                {
+                    prefetch.Wait();
+                    throw;
+                }
+                index += count;
+                count = prefetch.Get();
+                std::swap(front, back);
+            }
+            if (std::ferror(f))
+                throw("Streaming: read failed");
+            return index;
+        }
+
+        // 包围盒
+        inline Geometry3D::AABB Bounds(const char *path, size_t memoryBudget = DefaultMemoryBudget)
+        {
+            Geometry3D::AABB box;
+            ForEachChunk(path, memoryBudget / (2 * sizeof(Vec3)), [&](const Vec3 *pts, size_t n, size_t)
+                         { box.Expand(Parallel::Reduce(
+                               n, Geometry3D::AABB{}, [&](size_t b, size_t e)
+                               {
+                                   Geometry3D::AABB local;
+                                   for (size_t i = b; i < e; ++i)
+                                       local.Expand(pts[i]);
+                                   return local; },
+                               [](Geometry3D::AABB a, const Geometry3D::AABB &b)
+                               {
+                                   a.Expand(b);
+                                   return a; },
+                               1 << 15)); });
+            return box;
+        }
+
+        // 均值与协方差 (各块并行归约后按 Chan 公式合并)
+        inline Statistics::Moments3 Moments(const char *path, size_t memoryBudget = DefaultMemoryBudget)
+        {
+            Statistics::Moments3 m;
+            ForEachChunk(path, memoryBudget / (2 * sizeof(Vec3)), [&](const Vec3 *pts, size_t n, size_t)
+                         { m.Merge(Statistics::ComputeMoments(pts, n)); });
+            return m;
+        }
+        inline Vec3 Centroid(const char *path, size_t memoryBudget = DefaultMemoryBudget) { return Moments(path, memoryBudget).mean; }
+
+        // p' = m * p + translation, 返回处理的点数
+        inline size_t Transform(const char *input, const char *output, const Mat3 &m, const Vec3 &translation = {},
+                                size_t memoryBudget = DefaultMemoryBudget)
+        {
+            size_t chunk = std::max<size_t>(memoryBudget / (4 * sizeof(Vec3)), 1);
+            BufferedWriter<Vec3> writer(output, chunk);
+            size_t total = ForEachChunk(input, chunk, [&](const Vec3 *pts, size_t n, size_t)
+                                        {
+                Vec3 *out = writer.Buffer();
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            out[i] = m * pts[i] + translation; },
+                    1 << 14);
+                writer.Commit(n); });
+            writer.Finish();
+            return total;
+        }
+
+        // 保留 keep(p) 为真的点, 返回保留的点数; keep 会被多个线程并发调用
+        template <typename Predicate>
+        size_t Filter(const char *input, const char *output, Predicate &&keep, size_t memoryBudget = DefaultMemoryBudget)
+        {
+            size_t chunk = std::max<size_t>(memoryBudget / (4 * sizeof(Vec3) + 1), 1);
+            BufferedWriter<Vec3> writer(output, chunk);
+            std::vector<unsigned char> flags(chunk);
+            size_t kept = 0;
+            ForEachChunk(input, chunk, [&](const Vec3 *pts, size_t n, size_t)
+                         {
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            flags[i] = keep(pts[i]) ? 1 : 0; },
+                    1 << 12);
+                Vec3 *out = writer.Buffer();
+                size_t k = 0;
+                for (size_t i = 0; i < n; ++i)
+                    if (flags[i])
+                        out[k++] = pts[i];
+                writer.Commit(k);
+                kept += k; });
+            writer.Finish();
+            return kept;
+        }
+
+        struct QuantizedPoint
+        {
+            int32_t x, y, z;
+        };
+
+        // 量化到以 origin 为原点、边长 cellSize 的整数网格 (四舍五入), 写出 QuantizedPoint 数组;
+        // 坐标非有限或格点超出 int32 范围时抛出异常 (此前的块已写出)
+        inline size_t Quantize(const char *input, const char *output, const Vec3 &origin, real cellSize,
+                               size_t memoryBudget = DefaultMemoryBudget)
+        {
+            if (!(cellSize > 0))
+                throw("Streaming: cell size must be positive");
+            size_t chunk = std::max<size_t>(memoryBudget / (2 * sizeof(Vec3) + 2 * sizeof(QuantizedPoint)), 1);
+            BufferedWriter<QuantizedPoint> writer(output, chunk);
+            real inv = 1 / cellSize;
+            // [-2^31, 2^31) 在 float 与 double 下都可精确表示; NaN 不满足比较, 一并拒绝
+            const real lo = static_cast<real>(std::numeric_limits<int32_t>::min()), hi = -lo;
+            size_t total = ForEachChunk(input, chunk, [&](const Vec3 *pts, size_t n, size_t)
+                                        {
+                QuantizedPoint *out = writer.Buffer();
+                std::atomic<bool> outOfRange(false);
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                        {
+                            real x = std::floor((pts[i].x - origin.x) * inv + 0.5f);
+                            real y = std::floor((pts[i].y - origin.y) * inv + 0.5f);
+                            real z = std::floor((pts[i].z - origin.z) * inv + 0.5f);
+                            if (!(x >= lo && x < hi && y >= lo && y < hi && z >= lo && z < hi))
+                            {
+                                outOfRange.store(true, std::memory_order_relaxed);
+                                continue;
+                            }
+                            out[i] = {static_cast<int32_t>(x), static_cast<int32_t>(y), static_cast<int32_t>(z)};
+                        } },
+                    1 << 14);
+                if (outOfRange.load())
+                    throw("Streaming: quantized coordinate out of int32 range");
+                writer.Commit(n); });
+            writer.Finish();
+            return total;
+        }
+    }
+
+    // ====================== 可见性剔除 ======================
+    namespace Culling
+    {
+        // SoA 存储的包围球 / 包围盒集合, 便于一次处理 8 个对象
+        struct SphereSet
+        {
+            std::vector<real> x, y, z, radius;
+
+            void Add(const Geometry3D::Sphere &s)
+            {
+                x.push_back(s.center.x);
+                y.push_back(s.center.y);
+                z.push_back(s.center.z);
+                radius.push_back(s.radius);
+            }
+            size_t Size() const { return x.size(); }
+        };
+
+        struct AABBSet
+        {
+            std::vector<real> minX, minY, minZ, maxX, maxY, maxZ;
+
+            void Add(const Geometry3D::AABB &box)
+            {
+                minX.push_back(box.min.x);
+                minY.push_back(box.min.y);
+                minZ.push_back(box.min.z);
+                maxX.push_back(box.max.x);
+                maxY.push_back(box.max.y);
+                maxZ.push_back(box.max.z);
+            }
+            size_t Size() const { return minX.size(); }
+        };
+
+        namespace Detail
+        {
+            constexpr size_t Lanes = 8;
+
+            // 分块并行: kernel(begin, end, out) 把块内可见下标写到 out 并返回数量,
+            // 之后按块顺序左移拼接, 输出与线程数无关且保持升序
+            template <typename Kernel>
+            size_t CompactParallel(size_t n, uint32_t *out, Kernel &&kernel)
+            {
+                const size_t Chunk = 1 << 14;
+                size_t chunks = (n + Chunk - 1) / Chunk;
+                std::vector<size_t> counts(chunks);
+                Parallel::For(
+                    chunks, [&](size_t b, size_t e)
+                    {
+                        for (size_t c = b; c < e; ++c)
+                            counts[c] = kernel(c * Chunk, std::min(n, (c + 1) * Chunk), out + c * Chunk); },
+                    1);
+                size_t total = 0;
+                for (size_t c = 0; c < chunks; ++c)
+                {
+                    if (total != c * Chunk)
+                        std::copy(out + c * Chunk, out + c * Chunk + counts[c], out + total);
+                    total += counts[c];
+                }
+                return total;
+            }
+        }
+
+        // 剔除包围球, 可见对象的下标按升序写入 visible (容量至少为 spheres.Size()), 返回可见数量
+        inline size_t CullSpheres(const Geometry3D::Frustum &frustum, const SphereSet &spheres, uint32_t *visible)
+        {
+            const real *X = spheres.x.data(), *Y = spheres.y.data(), *Z = spheres.z.data(), *R = spheres.radius.data();
+            return Detail::CompactParallel(spheres.Size(), visible, [&](size_t b, size_t e, uint32_t *out)
+                                           {
+                size_t k = 0;
+                auto block = [&](size_t base, size_t w)
+                {
+                    real score[Detail::Lanes];
+                    for (size_t j = 0; j < w; ++j)
+                        score[j] = std::numeric_limits<real>::max();
+                    for (const Geometry3D::Plane &pl : frustum.planes)
+                        for (size_t j = 0; j < w; ++j)
+                            score[j] = std::min(score[j], pl.normal.x * X[base + j] + pl.normal.y * Y[base + j] + pl.normal.z * Z[base + j] + pl.d + R[base + j]);
+                    // 无分支压缩
+                    for (size_t j = 0; j < w; ++j)
+                    {
+                        out[k] = static_cast<uint32_t>(base + j);
+                        k += score[j] >= 0;
+                    }
+                };
+                size_t base = b;
+                for (; base + Detail::Lanes <= e; base += Detail::Lanes)
+                    block(base, Detail::Lanes);
+                if (base < e)
+                    block(base, e - base);
+                return k; });
+        }
+
+        inline size_t CullAABBs(const Geometry3D::Frustum &frustum, const AABBSet &boxes, uint32_t *visible)
+        {
+            const real *x0 = boxes.minX.data(), *y0 = boxes.minY.data(), *z0 = boxes.minZ.data();
+            const real *x1 = boxes.maxX.data(), *y1 = boxes.maxY.data(), *z1 = boxes.maxZ.data();
+            return Detail::CompactParallel(boxes.Size(), visible, [&](size_t b, size_t e, uint32_t *out)
+                                           {
+                size_t k = 0;
+                auto block = [&](size_t base, size_t w)
+                {
+                    real cx[Detail::Lanes], cy[Detail::Lanes], cz[Detail::Lanes], ex[Detail::Lanes], ey[Detail::Lanes], ez[Detail::Lanes], score[Detail::Lanes];
+                    for (size_t j = 0; j < w; ++j)
+                    {
+                        cx[j] = (x0[base + j] + x1[base + j]) * 0.5f;
+                        cy[j] = (y0[base + j] + y1[base + j]) * 0.5f;
+                        cz[j] = (z0[base + j] + z1[base + j]) * 0.5f;
+                        ex[j] = (x1[base + j] - x0[base + j]) * 0.5f;
+                        ey[j] = (y1[base + j] - y0[base + j]) * 0.5f;
+                        ez[j] = (z1[base + j] - z0[base + j]) * 0.5f;
+                        score[j] = std::numeric_limits<real>::max();
+                    }
+                    for (const Geometry3D::Plane &pl : frustum.planes)
+                    {
+                        real ax = std::abs(pl.normal.x), ay = std::abs(pl.normal.y), az = std::abs(pl.normal.z);
+                        for (size_t j = 0; j < w; ++j)
+                            score[j] = std::min(score[j], pl.normal.x * cx[j] + pl.normal.y * cy[j] + pl.normal.z * cz[j] + pl.d + ax * ex[j] + ay * ey[j] + az * ez[j]);
+                    }
+                    for (size_t j = 0; j < w; ++j)
+                    {
+                        out[k] = static_cast<uint32_t>(base + j);
+                        k += score[j] >= 0;
+                    }
+                };
+                size_t base = b;
+                for (; base + Detail::Lanes <= e; base += Detail::Lanes)
+                    block(base, Detail::Lanes);
+                if (base < e)
+                    block(base, e - base);
+                return k; });
+        }
+
+        // 包围盒层次结构: 节点按深度优先存放 (左孩子紧随父节点), 每个节点的图元在 order 中连续,
+        // 因此整棵子树位于视锥内部时可直接整段输出
+        class BVH
+        {
+        public:
+            BVH() = default;
+            BVH(const Geometry3D::AABB *boxes, size_t n) { Build(boxes, n); }
+
+            void Build(const Geometry3D::AABB *boxes, size_t n)
+            {
+                nodes.clear();
+                order.resize(n);
+                std::vector<Vec3> centers(n);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    order[i] = static_cast<uint32_t>(i);
+                    centers[i] = boxes[i].Center();
+                }
+                if (n > 0)
+                {
+                    nodes.reserve(2 * n / LeafSize + 1);
+                    BuildNode(boxes, centers, 0, n);
+                }
+                primBoxes.resize(n);
+                for (size_t i = 0; i < n; ++i)
+                    primBoxes[i] = boxes[order[i]];
+            }
+            size_t Size() const { return order.size(); }
+
+            // 层次剔除: 父节点完全位于某平面内侧时, 子树不再测试该平面; 顶层子树并行处理
+            // 返回的下标按子树顺序排列
+            size_t Cull(const Geometry3D::Frustum &frustum, std::vector<uint32_t> &visible) const
+            {
+                visible.clear();
+                if (nodes.empty())
+                    return 0;
+                // 先在顶层展开出若干子树任务
+                std::vector<std::pair<uint32_t, uint32_t>> tasks, frontier = {{0u, 0x3Fu}};
+                size_t target = static_cast<size_t>(Parallel::ThreadPool::Instance().Concurrency()) * 4;
+                std::vector<std::vector<uint32_t>> results;
+                while (!frontier.empty() && frontier.size() + tasks.size() < target)
+                {
+                    std::vector<std::pair<uint32_t, uint32_t>> next;
+                    for (auto item : frontier)
+                    {
+                        const Node &nd = nodes[item.first];
+                        uint32_t mask = item.second;
+                        if (!Classify(frustum, nd.box, mask))
+                            continue;
+                        if (mask == 0 || nd.right == 0)
+                            tasks.push_back({item.first, mask});
+                        else
+                        {
+                            next.push_back({item.first + 1, mask});
+                            next.push_back({nd.right, mask});
+                        }
+                    }
+                    frontier.swap(next);
+                }
+                tasks.insert(tasks.end(), frontier.begin(), frontier.end());
+                std::sort(tasks.begin(), tasks.end());
+
+                results.resize(tasks.size());
+                Parallel::For(
+                    tasks.size(), [&](size_t b, size_t e)
+                    {
+                        for (size_t t = b; t < e; ++t)
+                            CullNode(frustum, tasks[t].first, tasks[t].second, results[t]); },
+                    1);
+                for (const auto &r : results)
+                    visible.insert(visible.end(), r.begin(), r.end());
+                return visible.size();
+            }
+
+        private:
+            static constexpr size_t LeafSize = 4;
+
+            struct Node
+            {
+                Geometry3D::AABB box;
+                uint32_t first;
+                uint32_t count;
+                uint32_t right; // 0 表示叶节点
+            };
+
+            uint32_t BuildNode(const Geometry3D::AABB *boxes, std::vector<Vec3> &centers, size_t lo, size_t hi)
+            {
+                uint32_t index = static_cast<uint32_t>(nodes.size());
+                nodes.push_back({});
+                Geometry3D::AABB box, centroidBox;
+                for (size_t i = lo; i < hi; ++i)
+                {
+                    box.Expand(boxes[order[i]]);
+                    centroidBox.Expand(centers[order[i]]);
+                }
+                uint32_t right = 0;
+                if (hi - lo > LeafSize)
+                {
+                    Vec3 ext = centroidBox.Size();
+                    int axis = ext.x >= ext.y && ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+                    size_t mid = lo + (hi - lo) / 2;
+                    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](uint32_t a, uint32_t b)
+                                     { return centers[a][axis] < centers[b][axis]; });
+                    BuildNode(boxes, centers, lo, mid);
+                    right = BuildNode(boxes, centers, mid, hi);
+                }
+                nodes[index] = {box, static_cast<uint32_t>(lo), static_cast<uint32_t>(hi - lo), right};
+                return index;
+            }
+
+            // 返回 false 表示完全在外; 通过的平面从 mask 中移除
+            static bool Classify(const Geometry3D::Frustum &frustum, const Geometry3D::AABB &box, uint32_t &mask)
+            {
+                Vec3 c = box.Center(), e = box.Size() * 0.5f;
+                for (int p = 0; p < 6; ++p)
+                {
+                    if (!(mask & (1u << p)))
+                        continue;
+                    const Geometry3D::Plane &pl = frustum.planes[p];
+                    real dist = pl.SignedDistance(c);
+                    real r = std::abs(pl.normal.x) * e.x + std::abs(pl.normal.y) * e.y + std::abs(pl.normal.z) * e.z;
+                    if (dist < -r)
+                        return false;
+                    if (dist >= r)
+                        mask &= ~(1u << p);
+                }
+                return true;
+            }
+
+            void CullNode(const Geometry3D::Frustum &frustum, uint32_t index, uint32_t mask, std::vector<uint32_t> &out) const
+            {
+                uint32_t stack[64][2];
+                int top = 0;
+                stack[top][0] = index;
+                stack[top++][1] = mask;
+                while (top > 0)
+                {
+                    --top;
+                    const Node &nd = nodes[stack[top][0]];
+                    uint32_t m = stack[top][1];
+                    if (!Classify(frustum, nd.box, m))
+                        continue;
+                    if (m == 0)
+                    {
+                        out.insert(out.end(), order.begin() + nd.first, order.begin() + nd.first + nd.count);
+                        continue;
+                    }
+                    if (nd.right == 0)
+                    {
+                        for (uint32_t i = nd.first; i < nd.first + nd.count; ++i)
+                        {
+                            uint32_t leafMask = m;
+                            if (Classify(frustum, primBoxes[i], leafMask))
+                                out.push_back(order[i]);
+                        }
+                        continue;
+                    }
+                    stack[top][0] = nd.right;
+                    stack[top++][1] = m;
+                    stack[top][0] = static_cast<uint32_t>(&nd - nodes.data()) + 1;
+                    stack[top++][1] = m;
+                }
+            }
+
+            std::vector<Node> nodes;
+            std::vector<uint32_t> order;
+            std::vector<Geometry3D::AABB> primBoxes; // 按 order 排列的图元包围盒
+        };
+    }
+
+    // ====================== 网格处理 ======================
+    namespace MeshTools
+    {
+        // 三角网格: indices 每 3 个为一个三角形; attributes 为可选的逐顶点属性 (UV、颜色等), 每顶点 attributeStride 个
+        struct TriangleMesh
+        {
+            std::vector<Vec3> vertices;
+            std::vector<uint32_t> indices;
+            std::vector<real> attributes;
+            size_t attributeStride = 0;
+
+            size_t VertexCount() const { return vertices.size(); }
+            size_t TriangleCount() const { return indices.size() / 3; }
+        };
+
+        struct SimplifyOptions
+        {
+            size_t targetTriangles = 0;                         // 达到该三角形数后停止
+            real maxError = std::numeric_limits<real>::max(); // 折叠代价超过该值后停止
+            real attributeWeight = 1;                         // 属性差异平方和计入代价的权重
+            bool preserveBorder = true;                       // 为边界边加入约束平面
+            bool parallel = true;                             // 先按空间网格分区并行简化, 再全局收尾
+        };
+
+        namespace Detail
+        {
+            // 二次误差矩阵 (对称 4x4, 存 10 个分量); float 下相减抵消严重, 固定用 double
+            struct Quadric
+            {
+                double a = 0, b = 0, c = 0, d = 0, e = 0, f = 0, g = 0, h = 0, i = 0, j = 0;
+
+                static Quadric FromPlane(double nx, double ny, double nz, double dd, double w)
+                {
+                    Quadric q;
+                    q.a = w * nx * nx, q.b = w * nx * ny, q.c = w * nx * nz, q.d = w * nx * dd;
+                    q.e = w * ny * ny, q.f = w * ny * nz, q.g = w * ny * dd;
+                    q.h = w * nz * nz, q.i = w * nz * dd, q.j = w * dd * dd;
+                    return q;
+                }
+                Quadric &operator+=(const Quadric &o)
+                {
+                    a += o.a, b += o.b, c += o.c, d += o.d, e += o.e;
+                    f += o.f, g += o.g, h += o.h, i += o.i, j += o.j;
+                    return *this;
+                }
+                double Evaluate(const Vec3 &p) const
+                {
+                    double x = p.x, y = p.y, z = p.z;
+                    return a * x * x + 2 * b * x * y + 2 * c * x * z + 2 * d * x + e * y * y + 2 * f * y * z + 2 * g * y + h * z * z + 2 * i * z + j;
+                }
+                // 误差最小点, 矩阵接近奇异时返回 false
+                bool Optimal(Vec3 &p) const
+                {
+                    double det = a * (e * h - f * f) - b * (b * h - f * c) + c * (b * f - e * c);
+                    double scale = std::abs(a) + std::abs(e) + std::abs(h);
+                    if (scale <= 0 || std::abs(det) < 1e-10 * scale * scale * scale)
+                        return false;
+                    double inv = 1 / det;
+                    p.x = static_cast<real>(-inv * (d * (e * h - f * f) - g * (b * h - c * f) + i * (b * f - c * e)));
+                    p.y = static_cast<real>(-inv * (a * (g * h - f * i) - b * (d * h - c * i) + c * (d * f - c * g)));
+                    p.z = static_cast<real>(-inv * (a * (e * i - f * g) - b * (b * i - d * f) + c * (b * g - d * e)));
+                    return true;
+                }
+            };
+
+            class QemSimplifier
+            {
+            public:
+                QemSimplifier(const TriangleMesh &mesh, const SimplifyOptions &options)
+                    : opt(options), pos(mesh.vertices), tris(mesh.indices), attrs(mesh.attributes), stride(mesh.attributeStride)
+                {
+                    size_t nv = pos.size(), nt = tris.size() / 3;
+                    quadrics.resize(nv);
+                    vertexTris.resize(nv);
+                    removed.assign(nv, 0);
+                    version.assign(nv, 0);
+                    cell.assign(nv, 0);
+                    triDead.assign(nt, 0);
+                    liveTriangles = nt;
+                    for (size_t t = 0; t < nt; ++t)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                            vertexTris[tris[3 * t + k]].push_back(static_cast<uint32_t>(t));
+                        Vec3 n = (pos[tris[3 * t + 1]] - pos[tris[3 * t]]).cross(pos[tris[3 * t + 2]] - pos[tris[3 * t]]);
+                        real area2 = n.length();
+                        if (area2 <= 0)
+                            continue;
+                        n /= area2;
+                        Quadric q = Quadric::FromPlane(n.x, n.y, n.z, -n.dot(pos[tris[3 * t]]), area2 * 0.5);
+                        for (int k = 0; k < 3; ++k)
+                            quadrics[tris[3 * t + k]] += q;
+                    }
+                    if (opt.preserveBorder)
+                        AddBorderQuadrics();
+                }
+
+                // 并行阶段: 顶点按空间网格分区, 跨区三角形的顶点被锁定, 各区只折叠内部边, 互不干扰
+                void SimplifyPartitioned(size_t target)
+                {
+                    size_t nv = pos.size();
+                    if (nv == 0 || liveTriangles <= target)
+                        return;
+                    Geometry3D::AABB box;
+                    for (const Vec3 &p : pos)
+                        box.Expand(p);
+                    unsigned conc = Parallel::ThreadPool::Instance().Concurrency();
+                    int g = std::max(2, static_cast<int>(std::ceil(std::cbrt(static_cast<double>(conc) * 2))));
+                    Vec3 size = box.Size();
+                    std::vector<unsigned char> locked(nv, 0);
+                    for (size_t v = 0; v < nv; ++v)
+                    {
+                        int cx = std::min(g - 1, static_cast<int>((pos[v].x - box.min.x) / std::max(size.x, Constants::Epsilon) * g));
+                        int cy = std::min(g - 1, static_cast<int>((pos[v].y - box.min.y) / std::max(size.y, Constants::Epsilon) * g));
+                        int cz = std::min(g - 1, static_cast<int>((pos[v].z - box.min.z) / std::max(size.z, Constants::Epsilon) * g));
+                        cell[v] = static_cast<uint32_t>((cz * g + cy) * g + cx);
+                    }
+                    for (size_t t = 0; t < triDead.size(); ++t)
+                    {
+                        uint32_t a = tris[3 * t], b = tris[3 * t + 1], c = tris[3 * t + 2];
+                        if (cell[a] != cell[b] || cell[a] != cell[c])
+                            locked[a] = locked[b] = locked[c] = 1;
+                    }
+                    for (size_t v = 0; v < nv; ++v)
+                        if (locked[v])
+                            cell[v] = Locked;
+
+                    size_t cells = static_cast<size_t>(g) * g * g;
+                    std::vector<std::vector<uint32_t>> cellVertices(cells);
+                    std::vector<size_t> cellTris(cells, 0);
+                    for (size_t v = 0; v < nv; ++v)
+                        if (cell[v] != Locked)
+                            cellVertices[cell[v]].push_back(static_cast<uint32_t>(v));
+                    for (size_t t = 0; t < triDead.size(); ++t)
+                        if (cell[tris[3 * t]] != Locked)
+                            ++cellTris[cell[tris[3 * t]]];
+
+                    double keep = static_cast<double>(target) / static_cast<double>(liveTriangles);
+                    std::vector<size_t> removedPerCell(cells, 0);
+                    Parallel::For(
+                        cells, [&](size_t b, size_t e)
+                        {
+                            for (size_t c = b; c < e; ++c)
+                            {
+                                size_t remove = cellTris[c] - static_cast<size_t>(cellTris[c] * keep);
+                                removedPerCell[c] = Run(cellVertices[c], static_cast<uint32_t>(c), remove);
+                            } },
+                        1);
+                    for (size_t r : removedPerCell)
+                        liveTriangles -= r;
+                }
+
+                // 全局阶段
+                void Simplify(size_t target)
+                {
+                    std::fill(cell.begin(), cell.end(), 0u);
+                    std::vector<uint32_t> all;
+                    all.reserve(pos.size());
+                    for (size_t v = 0; v < pos.size(); ++v)
+                        if (!removed[v])
+                            all.push_back(static_cast<uint32_t>(v));
+                    if (liveTriangles > target)
+                        liveTriangles -= Run(all, 0, liveTriangles - target);
+                }
+
+                TriangleMesh Result() const
+                {
+                    TriangleMesh out;
+                    out.attributeStride = stride;
+                    std::vector<uint32_t> remap(pos.size(), Locked);
+                    for (size_t t = 0; t < triDead.size(); ++t)
+                    {
+                        if (triDead[t])
+                            continue;
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            uint32_t v = tris[3 * t + k];
+                            if (remap[v] == Locked)
+                            {
+                                remap[v] = static_cast<uint32_t>(out.vertices.size());
+                                out.vertices.push_back(pos[v]);
+                                if (stride)
+                                    out.attributes.insert(out.attributes.end(), attrs.begin() + v * stride, attrs.begin() + (v + 1) * stride);
+                            }
+                            out.indices.push_back(remap[v]);
+                        }
+                    }
+                    return out;
+                }
+
+            private:
+                static constexpr uint32_t Locked = 0xFFFFFFFFu;
+
+                // 16 字节的堆元素, 通过顶点版本号之和惰性判定过期
+                struct Candidate
+                {
+                    float cost;
+                    uint32_t a, b;
+                    uint32_t stamp;
+                    bool operator<(const Candidate &o) const { return cost > o.cost; }
+                };
+
+                void AddBorderQuadrics()
+                {
+                    // 只属于一个三角形的边为边界边
+                    std::vector<std::pair<uint64_t, uint32_t>> edges;
+                    edges.reserve(tris.size());
+                    for (size_t t = 0; t < triDead.size(); ++t)
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            uint32_t a = tris[3 * t + k], b = tris[3 * t + (k + 1) % 3];
+                            edges.push_back({(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b), static_cast<uint32_t>(t)});
+                        }
+                    std::sort(edges.begin(), edges.end());
+                    for (size_t i = 0; i < edges.size();)
+                    {
+                        size_t j = i + 1;
+                        while (j < edges.size() && edges[j].first == edges[i].first)
+                            ++j;
+                        if (j - i == 1)
+                        {
+                            uint32_t a = static_cast<uint32_t>(edges[i].first >> 32), b = static_cast<uint32_t>(edges[i].first & 0xFFFFFFFFu);
+                            uint32_t t = edges[i].second;
+                            Vec3 fn = (pos[tris[3 * t + 1]] - pos[tris[3 * t]]).cross(pos[tris[3 * t + 2]] - pos[tris[3 * t]]);
+                            Vec3 edge = pos[b] - pos[a];
+                            Vec3 n = edge.cross(fn).normalize();
+                            if (!n.isZero())
+                            {
+                                Quadric q = Quadric::FromPlane(n.x, n.y, n.z, -n.dot(pos[a]), 1000.0 * edge.lengthSquared());
+                                quadrics[a] += q;
+                                quadrics[b] += q;
+                            }
+                        }
+                        i = j;
+                    }
+                }
+
+                bool Collapsible(uint32_t v, uint32_t c) const { return !removed[v] && cell[v] == c; }
+
+                // 计算边 (a, b) 的折叠代价及目标位置
+                double EdgeCost(uint32_t a, uint32_t b, Vec3 &target) const
+                {
+                    Quadric q = quadrics[a];
+                    q += quadrics[b];
+                    Vec3 ab = pos[b] - pos[a];
+                    Vec3 mid = (pos[a] + pos[b]) * 0.5f;
+                    double best;
+                    // 最优点离边太远说明矩阵接近奇异, 改为在端点和中点中选择
+                    if (q.Optimal(target) && (target - mid).length() <= 2 * ab.length())
+                        best = q.Evaluate(target);
+                    else
+                    {
+                        Vec3 options[3] = {pos[a], pos[b], mid};
+                        best = std::numeric_limits<double>::max();
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            double cost = q.Evaluate(options[k]);
+                            if (cost < best)
+                            {
+                                best = cost;
+                                target = options[k];
+                            }
+                        }
+                    }
+                    best = std::max(best, 0.0);
+                    if (stride && opt.attributeWeight > 0)
+                    {
+                        double diff = 0;
+                        for (size_t k = 0; k < stride; ++k)
+                        {
+                            double dd = attrs[a * stride + k] - attrs[b * stride + k];
+                            diff += dd * dd;
+                        }
+                        // 乘以边长平方, 与面积加权的几何误差同量纲
+                        best += opt.attributeWeight * diff * ab.lengthSquared();
+                    }
+                    return best;
+                }
+
+                void PushEdges(uint32_t v, uint32_t c, std::vector<Candidate> &heap) const
+                {
+                    for (uint32_t t : vertexTris[v])
+                    {
+                        if (triDead[t])
+                            continue;
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            uint32_t w = tris[3 * t + k];
+                            if (w == v || !Collapsible(w, c))
+                                continue;
+                            Vec3 target;
+                            double cost = EdgeCost(v, w, target);
+                            heap.push_back({static_cast<float>(std::min<double>(cost, std::numeric_limits<float>::max())), v, w, version[v] + version[w]});
+                            std::push_heap(heap.begin(), heap.end());
+                        }
+                    }
+                }
+
+                // 折叠后各相邻三角形的法向不得翻转
+                bool FlipsNormals(uint32_t keep, uint32_t gone, const Vec3 &target) const
+                {
+                    for (uint32_t v : {keep, gone})
+                    {
+                        for (uint32_t t : vertexTris[v])
+                        {
+                            if (triDead[t])
+                                continue;
+                            const uint32_t *tri = &tris[3 * t];
+                            bool hasKeep = tri[0] == keep || tri[1] == keep || tri[2] == keep;
+                            bool hasGone = tri[0] == gone || tri[1] == gone || tri[2] == gone;
+                            if (hasKeep && hasGone)
+                                continue;
+                            Vec3 p[3], q[3];
+                            for (int k = 0; k < 3; ++k)
+                            {
+                                p[k] = pos[tri[k]];
+                                q[k] = tri[k] == v ? target : p[k];
+                            }
+                            Vec3 n0 = (p[1] - p[0]).cross(p[2] - p[0]);
+                            Vec3 n1 = (q[1] - q[0]).cross(q[2] - q[0]);
+                            if (n0.dot(n1) <= 0.2f * n0.length() * n1.length())
+                                return true;
+                        }
+                    }
+                    return false;
+                }
+
+                void InterpolateAttributes(uint32_t a, uint32_t b, const Vec3 &target)
+                {
+                    real bestDist = std::numeric_limits<real>::max();
+                    uint32_t bestTri = Locked;
+                    Vec3 bestBary;
+                    for (uint32_t v : {a, b})
+                        for (uint32_t t : vertexTris[v])
+                        {
+                            if (triDead[t])
+                                continue;
+                            Vec3 bary;
+                            Vec3 q = Geometry3D::ClosestPointOnTriangle(target, pos[tris[3 * t]], pos[tris[3 * t + 1]], pos[tris[3 * t + 2]], &bary);
+                            real d = (q - target).lengthSquared();
+                            if (d < bestDist)
+                            {
+                                bestDist = d;
+                                bestTri = t;
+                                bestBary = bary;
+                            }
+                        }
+                    if (bestTri == Locked)
+                        return;
+                    const uint32_t *tri = &tris[3 * bestTri];
+                    for (size_t k = 0; k < stride; ++k)
+                        attrs[a * stride + k] = bestBary.x * attrs[tri[0] * stride + k] + bestBary.y * attrs[tri[1] * stride + k] + bestBary.z * attrs[tri[2] * stride + k];
+                }
+
+                // 在顶点集合 verts 上简化, 只处理 cell 标记等于 c 的顶点; 返回删除的三角形数
+                size_t Run(const std::vector<uint32_t> &verts, uint32_t c, size_t removeTarget)
+                {
+                    std::vector<Candidate> heap;
+                    for (uint32_t v : verts)
+                        for (uint32_t t : vertexTris[v])
+                        {
+                            if (triDead[t])
+                                continue;
+                            for (int k = 0; k < 3; ++k)
+                            {
+                                uint32_t w = tris[3 * t + k];
+                                if (w > v && Collapsible(w, c))
+                                {
+                                    Vec3 target;
+                                    double cost = EdgeCost(v, w, target);
+                                    heap.push_back({static_cast<float>(std::min<double>(cost, std::numeric_limits<float>::max())), v, w, version[v] + version[w]});
+                                }
+                            }
+                        }
+                    std::make_heap(heap.begin(), heap.end());
+
+                    size_t removedTris = 0;
+                    while (!heap.empty() && removedTris < removeTarget)
+                    {
+                        std::pop_heap(heap.begin(), heap.end());
+                        Candidate cand = heap.back();
+                        heap.pop_back();
+                        uint32_t a = cand.a, b = cand.b;
+                        if (!Collapsible(a, c) || !Collapsible(b, c) || cand.stamp != version[a] + version[b])
+                            continue;
+                        if (cand.cost > opt.maxError)
+                            break;
+
+                        Vec3 target;
+                        EdgeCost(a, b, target);
+                        if (FlipsNormals(a, b, target))
+                            continue;
+
+                        // 新顶点属性取原网格上离目标点最近处的重心插值, 线性属性场可被精确保持
+                        if (stride)
+                            InterpolateAttributes(a, b, target);
+
+                        // b 并入 a
+                        for (uint32_t t : vertexTris[b])
+                        {
+                            if (triDead[t])
+                                continue;
+                            uint32_t *tri = &tris[3 * t];
+                            if (tri[0] == a || tri[1] == a || tri[2] == a)
+                            {
+                                triDead[t] = 1;
+                                ++removedTris;
+                                continue;
+                            }
+                            for (int k = 0; k < 3; ++k)
+                                if (tri[k] == b)
+                                    tri[k] = a;
+                            vertexTris[a].push_back(t);
+                        }
+                        std::vector<uint32_t> &list = vertexTris[a];
+                        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t)
+                                                  { return triDead[t] != 0; }),
+                                   list.end());
+                        std::vector<uint32_t>().swap(vertexTris[b]);
+
+                        quadrics[a] += quadrics[b];
+                        pos[a] = target;
+                        removed[b] = 1;
+                        ++version[a];
+                        PushEdges(a, c, heap);
+                    }
+                    return removedTris;
+                }
+
+                SimplifyOptions opt;
+                std::vector<Vec3> pos;
+                std::vector<uint32_t> tris;
+                std::vector<real> attrs;
+                size_t stride;
+                std::vector<Quadric> quadrics;
+                std::vector<std::vector<uint32_t>> vertexTris;
+                std::vector<unsigned char> removed, triDead;
+                std::vector<uint32_t> version, cell;
+                size_t liveTriangles = 0;
+            };
+        }
+
+        // 二次误差度量 (QEM) 边折叠简化, 直到三角形数不超过 targetTriangles 或代价超过 maxError
+        inline TriangleMesh Simplify(const TriangleMesh &mesh, const SimplifyOptions &options)
+        {
+            Detail::QemSimplifier simplifier(mesh, options);
+            if (options.parallel && mesh.TriangleCount() > 20000)
+                simplifier.SimplifyPartitioned(options.targetTriangles);
+            simplifier.Simplify(options.targetTriangles);
+            return simplifier.Result();
+        }
+        namespace Detail
+        {
+            // 顶点 -> 相邻元素的 CSR 表 (offsets 长度为顶点数 + 1), 计数排序构建;
+            // 逐顶点并行收集时各线程只写自己的顶点, 无需原子累加
+            struct VertexAdjacency
+            {
+                std::vector<uint32_t> offsets, items;
+
+                size_t Begin(size_t v) const { return offsets[v]; }
+                size_t End(size_t v) const { return offsets[v + 1]; }
+
+                // 相邻三角形, 同一顶点下按三角形序号升序
+                static VertexAdjacency Triangles(const TriangleMesh &mesh)
+                {
+                    VertexAdjacency adj;
+                    adj.offsets.assign(mesh.VertexCount() + 1, 0);
+                    for (uint32_t v : mesh.indices)
+                        ++adj.offsets[v + 1];
+                    for (size_t v = 0; v < mesh.VertexCount(); ++v)
+                        adj.offsets[v + 1] += adj.offsets[v];
+                    std::vector<uint32_t> cursor(adj.offsets.begin(), adj.offsets.end() - 1);
+                    adj.items.resize(mesh.indices.size());
+                    for (size_t i = 0; i < mesh.indices.size(); ++i)
+                        adj.items[cursor[mesh.indices[i]]++] = static_cast<uint32_t>(i / 3);
+                    return adj;
+                }
+
+                // 相邻顶点 (去重, 升序)
+                static VertexAdjacency Neighbors(const TriangleMesh &mesh)
+                {
+                    size_t nv = mesh.VertexCount();
+                    VertexAdjacency adj;
+                    std::vector<uint32_t> offsets(nv + 1, 0);
+                    for (uint32_t v : mesh.indices)
+                        offsets[v + 1] += 2;
+                    for (size_t v = 0; v < nv; ++v)
+                        offsets[v + 1] += offsets[v];
+                    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                    std::vector<uint32_t> items(offsets[nv]);
+                    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            uint32_t v = mesh.indices[t + k];
+                            items[cursor[v]++] = mesh.indices[t + (k + 1) % 3];
+                            items[cursor[v]++] = mesh.indices[t + (k + 2) % 3];
+                        }
+                    std::vector<uint32_t> counts(nv);
+                    Parallel::For(nv, [&](size_t b, size_t e)
+                                  {
+                        for (size_t v = b; v < e; ++v)
+                        {
+                            std::sort(items.begin() + offsets[v], items.begin() + offsets[v + 1]);
+                            counts[v] = static_cast<uint32_t>(std::unique(items.begin() + offsets[v], items.begin() + offsets[v + 1]) - (items.begin() + offsets[v]));
+                        } });
+                    adj.offsets.assign(nv + 1, 0);
+                    for (size_t v = 0; v < nv; ++v)
+                        adj.offsets[v + 1] = adj.offsets[v] + counts[v];
+                    adj.items.resize(adj.offsets[nv]);
+                    for (size_t v = 0; v < nv; ++v)
+                        std::copy(items.begin() + offsets[v], items.begin() + offsets[v] + counts[v], adj.items.begin() + adj.offsets[v]);
+                    return adj;
+                }
+            };
+
+            // 标记边界顶点 (位于只属于一个三角形的边上)
+            inline std::vector<unsigned char> BorderVertices(const TriangleMesh &mesh)
+            {
+                std::vector<uint64_t> edges;
+                edges.reserve(mesh.indices.size());
+                for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        uint32_t a = mesh.indices[t + k], b = mesh.indices[t + (k + 1) % 3];
+                        edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+                    }
+                std::sort(edges.begin(), edges.end());
+                std::vector<unsigned char> border(mesh.VertexCount(), 0);
+                for (size_t i = 0; i < edges.size();)
+                {
+                    size_t j = i + 1;
+                    while (j < edges.size() && edges[j] == edges[i])
+                        ++j;
+                    if (j - i == 1)
+                        border[edges[i] >> 32] = border[edges[i] & 0xFFFFFFFFu] = 1;
+                    i = j;
+                }
+                return border;
+            }
+        }
+
+        // 逐三角形单位法向, 退化三角形为零向量
+        inline std::vector<Vec3> FaceNormals(const TriangleMesh &mesh)
+        {
+            std::vector<Vec3> normals(mesh.TriangleCount());
+            const Vec3 *p = mesh.vertices.data();
+            const uint32_t *idx = mesh.indices.data();
+            Parallel::For(normals.size(), [&](size_t b, size_t e)
+                          {
+                for (size_t t = b; t < e; ++t)
+                    normals[t] = (p[idx[3 * t + 1]] - p[idx[3 * t]]).cross(p[idx[3 * t + 2]] - p[idx[3 * t]]).normalize(); });
+            return normals;
+        }
+
+        // 逐顶点单位法向: 相邻三角形法向之和 (areaWeighted 时按面积加权);
+        // 先按顶点整理相邻三角形, 再逐顶点并行求和, 结果与线程数无关
+        inline std::vector<Vec3> VertexNormals(const TriangleMesh &mesh, bool areaWeighted = true)
+        {
+            const Vec3 *p = mesh.vertices.data();
+            const uint32_t *idx = mesh.indices.data();
+            std::vector<Vec3> face(mesh.TriangleCount());
+            Parallel::For(face.size(), [&](size_t b, size_t e)
+                          {
+                for (size_t t = b; t < e; ++t)
+                {
+                    face[t] = (p[idx[3 * t + 1]] - p[idx[3 * t]]).cross(p[idx[3 * t + 2]] - p[idx[3 * t]]);
+                    if (!areaWeighted)
+                        face[t].normalizeSelf();
+                } });
+            Detail::VertexAdjacency adj = Detail::VertexAdjacency::Triangles(mesh);
+            std::vector<Vec3> normals(mesh.VertexCount());
+            Parallel::For(normals.size(), [&](size_t b, size_t e)
+                          {
+                for (size_t v = b; v < e; ++v)
+                {
+                    Vec3 n(0, 0, 0);
+                    for (size_t k = adj.Begin(v); k < adj.End(v); ++k)
+                        n += face[adj.items[k]];
+                    normals[v] = n.normalize();
+                } });
+            return normals;
+        }
+
+        // 均匀权重 Laplacian 平滑: 每次迭代 p += lambda * (邻点均值 - p), 双缓冲并行更新;
+        // preserveBorder 时边界顶点保持不动
+        inline void SmoothLaplacian(TriangleMesh &mesh, int iterations, real lambda = 0.5f, bool preserveBorder = true)
+        {
+            if (iterations <= 0 || mesh.VertexCount() == 0)
+                return;
+            Detail::VertexAdjacency adj = Detail::VertexAdjacency::Neighbors(mesh);
+            std::vector<unsigned char> fixed = preserveBorder ? Detail::BorderVertices(mesh) : std::vector<unsigned char>(mesh.VertexCount(), 0);
+            std::vector<Vec3> next(mesh.VertexCount());
+            for (int it = 0; it < iterations; ++it)
+            {
+                const std::vector<Vec3> &cur = mesh.vertices;
+                Parallel::For(next.size(), [&](size_t b, size_t e)
+                              {
+                    for (size_t v = b; v < e; ++v)
+                    {
+                        size_t lo = adj.Begin(v), hi = adj.End(v);
+                        if (fixed[v] || lo == hi)
+                        {
+                            next[v] = cur[v];
+                            continue;
+                        }
+                        Vec3 sum(0, 0, 0);
+                        for (size_t k = lo; k < hi; ++k)
+                            sum += cur[adj.items[k]];
+                        next[v] = cur[v] + (sum / static_cast<real>(hi - lo) - cur[v]) * lambda;
+                    } });
+                mesh.vertices.swap(next);
+            }
+        }
+
+        // 合并距离不超过 tolerance 且属性差不超过 tolerance 的顶点, 删除因此退化的三角形;
+        // 以 tolerance 为边长的空间哈希网格查找候选, 保留每组中最先出现的顶点, 返回删除的顶点数
+        inline size_t WeldVertices(TriangleMesh &mesh, real tolerance = 0)
+        {
+            size_t nv = mesh.VertexCount(), stride = mesh.attributeStride;
+            if (nv == 0)
+                return 0;
+            double cellSize = std::max<double>(tolerance, Constants::Epsilon);
+            auto cellOf = [&](const Vec3 &p, int64_t c[3])
+            {
+                c[0] = static_cast<int64_t>(std::floor(p.x / cellSize));
+                c[1] = static_cast<int64_t>(std::floor(p.y / cellSize));
+                c[2] = static_cast<int64_t>(std::floor(p.z / cellSize));
+            };
+            auto hashOf = [](int64_t x, int64_t y, int64_t z)
+            {
+                return static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full ^ static_cast<uint64_t>(z) * 0x165667B19E3779F9ull;
+            };
+            auto same = [&](uint32_t a, uint32_t b)
+            {
+                if ((mesh.vertices[a] - mesh.vertices[b]).lengthSquared() > tolerance * tolerance)
+                    return false;
+                for (size_t k = 0; k < stride; ++k)
+                    if (std::abs(mesh.attributes[a * stride + k] - mesh.attributes[b * stride + k]) > tolerance)
+                        return false;
+                return true;
+            };
+
+            const uint32_t None = 0xFFFFFFFFu;
+            // 哈希表存每个格子链表的头, next 串起同一格子中的代表顶点
+            std::unordered_map<uint64_t, uint32_t> heads;
+            heads.reserve(nv);
+            std::vector<uint32_t> next(nv, None), remap(nv);
+            std::vector<uint32_t> kept;
+            for (size_t v = 0; v < nv; ++v)
+            {
+                int64_t c[3];
+                cellOf(mesh.vertices[v], c);
+                uint32_t found = None;
+                for (int dz = -1; dz <= 1 && found == None; ++dz)
+                    for (int dy = -1; dy <= 1 && found == None; ++dy)
+                        for (int dx = -1; dx <= 1 && found == None; ++dx)
+                        {
+                            auto it = heads.find(hashOf(c[0] + dx, c[1] + dy, c[2] + dz));
+                            if (it == heads.end())
+                                continue;
+                            for (uint32_t r = it->second; r != None; r = next[r])
+                                if (same(r, static_cast<uint32_t>(v)))
+                                {
+                                    found = r;
+                                    break;
+                                }
+                        }
+                if (found != None)
+                {
+                    remap[v] = remap[found];
+                    continue;
+                }
+                remap[v] = static_cast<uint32_t>(kept.size());
+                kept.push_back(static_cast<uint32_t>(v));
+                auto ins = heads.insert({hashOf(c[0], c[1], c[2]), static_cast<uint32_t>(v)});
+                if (!ins.second)
+                {
+                    next[v] = ins.first->second;
+                    ins.first->second = static_cast<uint32_t>(v);
+                }
+            }
+
+            std::vector<Vec3> vertices(kept.size());
+            std::vector<real> attributes(kept.size() * stride);
+            for (size_t i = 0; i < kept.size(); ++i)
+            {
+                vertices[i] = mesh.vertices[kept[i]];
+                std::copy(mesh.attributes.begin() + kept[i] * stride, mesh.attributes.begin() + (kept[i] + 1) * stride, attributes.begin() + i * stride);
+            }
+            size_t out = 0;
+            for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+            {
+                uint32_t a = remap[mesh.indices[t]], b = remap[mesh.indices[t + 1]], c = remap[mesh.indices[t + 2]];
+                if (a == b || b == c || a == c)
+                    continue;
+                mesh.indices[out++] = a;
+                mesh.indices[out++] = b;
+                mesh.indices[out++] = c;
+            }
+            mesh.indices.resize(out);
+            mesh.vertices.swap(vertices);
+            mesh.attributes.swap(attributes);
+            return nv - kept.size();
+        }
+        // 以 FIFO 顶点缓存模拟统计平均每个三角形的缓存未命中数 (ACMR), 越低越好, 下界约为 0.5
+        inline real CacheMissRatio(const TriangleMesh &mesh, size_t cacheSize = 16)
+        {
+            if (mesh.TriangleCount() == 0)
+                return 0;
+            std::vector<size_t> stamp(mesh.VertexCount(), 0);
+            size_t misses = 0, time = cacheSize + 1;
+            for (uint32_t v : mesh.indices)
+                if (time - stamp[v] > cacheSize)
+                {
+                    stamp[v] = time++;
+                    ++misses;
+                }
+            return static_cast<real>(misses) / static_cast<real>(mesh.TriangleCount());
+        }
+
+        namespace Detail
+        {
+            // Tipsify (Sander 等 2007): 沿当前扇心输出全部相邻三角形, 再从刚进入缓存的顶点中选下一扇心;
+            // 在 indices[0, count) 上原地重排, 顶点号须小于 vertexCount
+            inline void Tipsify(uint32_t *indices, size_t count, size_t vertexCount, size_t cacheSize)
+            {
+                size_t nt = count / 3;
+                std::vector<uint32_t> offsets(vertexCount + 1, 0), adj(count);
+                for (size_t i = 0; i < count; ++i)
+                    ++offsets[indices[i] + 1];
+                for (size_t v = 0; v < vertexCount; ++v)
+                    offsets[v + 1] += offsets[v];
+                std::vector<uint32_t> live(vertexCount);
+                for (size_t v = 0; v < vertexCount; ++v)
+                    live[v] = offsets[v + 1] - offsets[v];
+                {
+                    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                    for (size_t i = 0; i < count; ++i)
+                        adj[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+
+                std::vector<size_t> cacheTime(vertexCount, 0);
+                std::vector<unsigned char> emitted(nt, 0);
+                std::vector<uint32_t> deadEnd, candidates, out;
+                out.reserve(count);
+                size_t time = cacheSize + 1, cursor = 0;
+                long long fan = vertexCount ? 0 : -1;
+                while (fan >= 0)
+                {
+                    candidates.clear();
+                    for (size_t k = offsets[fan]; k < offsets[fan + 1]; ++k)
+                    {
+                        uint32_t t = adj[k];
+                        if (emitted[t])
+                            continue;
+                        emitted[t] = 1;
+                        for (int j = 0; j < 3; ++j)
+                        {
+                            uint32_t v = indices[3 * t + j];
+                            out.push_back(v);
+                            deadEnd.push_back(v);
+                            candidates.push_back(v);
+                            --live[v];
+                            if (time - cacheTime[v] > cacheSize)
+                                cacheTime[v] = time++;
+                        }
+                    }
+
+                    // 优先选仍在缓存中且相邻三角形能在被挤出前输出完的顶点, 其中越早进入缓存越好
+                    fan = -1;
+                    long long best = -1;
+                    for (uint32_t v : candidates)
+                    {
+                        if (live[v] == 0)
+                            continue;
+                        long long age = static_cast<long long>(time - cacheTime[v]);
+                        long long priority = age + 2 * static_cast<long long>(live[v]) <= static_cast<long long>(cacheSize) ? age : 0;
+                        if (priority > best)
+                        {
+                            best = priority;
+                            fan = v;
+                        }
+                    }
+                    // 死胡同: 先回溯最近输出的顶点, 再按顶点号顺序扫描
+                    while (fan < 0 && !deadEnd.empty())
+                    {
+                        uint32_t v = deadEnd.back();
+                        deadEnd.pop_back();
+                        if (live[v] > 0)
+                            fan = v;
+                    }
+                    while (fan < 0 && cursor < vertexCount)
+                    {
+                        if (live[cursor] > 0)
+                            fan = static_cast<long long>(cursor);
+                        ++cursor;
+                    }
+                }
+                std::copy(out.begin(), out.end(), indices);
+            }
+        }
+
+        // 重排三角形顺序以提高顶点缓存命中率 (Tipsify); 大网格按空间顺序切块并行处理, 块内使用局部顶点号
+        inline void OptimizeVertexCache(TriangleMesh &mesh, size_t cacheSize = 16)
+        {
+            const size_t ChunkTriangles = 1 << 16;
+            size_t nt = mesh.TriangleCount();
+            if (nt == 0)
+                return;
+            size_t chunks = (nt + ChunkTriangles - 1) / ChunkTriangles;
+            if (chunks == 1)
+            {
+                Detail::Tipsify(mesh.indices.data(), nt * 3, mesh.VertexCount(), cacheSize);
+                return;
+            }
+            // 先按三角形重心的 Morton 码排序, 使每块在空间上紧凑, 块间切口只带来少量额外未命中
+            Geometry3D::AABB box;
+            for (const Vec3 &p : mesh.vertices)
+                box.Expand(p);
+            Vec3 scale = box.Size();
+            scale = Vec3(1023 / std::max(scale.x, Constants::Epsilon), 1023 / std::max(scale.y, Constants::Epsilon), 1023 / std::max(scale.z, Constants::Epsilon));
+            std::vector<uint64_t> keys(nt);
+            Parallel::For(nt, [&](size_t b, size_t e)
+                          {
+                for (size_t t = b; t < e; ++t)
+                {
+                    Vec3 c = (mesh.vertices[mesh.indices[3 * t]] + mesh.vertices[mesh.indices[3 * t + 1]] + mesh.vertices[mesh.indices[3 * t + 2]]) / 3 - box.min;
+                    uint32_t code = MathTools::Morton3D(static_cast<uint32_t>(c.x * scale.x), static_cast<uint32_t>(c.y * scale.y), static_cast<uint32_t>(c.z * scale.z));
+                    keys[t] = (static_cast<uint64_t>(code) << 32) | t;
+                } });
+            std::sort(keys.begin(), keys.end());
+            std::vector<uint32_t> sorted(nt * 3);
+            for (size_t t = 0; t < nt; ++t)
+                std::copy(mesh.indices.begin() + (keys[t] & 0xFFFFFFFFu) * 3, mesh.indices.begin() + (keys[t] & 0xFFFFFFFFu) * 3 + 3, sorted.begin() + t * 3);
+            mesh.indices.swap(sorted);
+            Parallel::For(
+                chunks, [&](size_t b, size_t e)
+                {
+                    for (size_t c = b; c < e; ++c)
+                    {
+                        uint32_t *idx = mesh.indices.data() + c * ChunkTriangles * 3;
+                        size_t count = std::min(ChunkTriangles, nt - c * ChunkTriangles) * 3;
+                        std::vector<uint32_t> local(idx, idx + count);
+                        std::sort(local.begin(), local.end());
+                        local.erase(std::unique(local.begin(), local.end()), local.end());
+                        std::vector<uint32_t> tmp(count);
+                        for (size_t i = 0; i < count; ++i)
+                            tmp[i] = static_cast<uint32_t>(std::lower_bound(local.begin(), local.end(), idx[i]) - local.begin());
+                        Detail::Tipsify(tmp.data(), count, local.size(), cacheSize);
+                        for (size_t i = 0; i < count; ++i)
+                            idx[i] = local[tmp[i]];
+                    } },
+                1);
+        }
+
+        // 按索引中首次出现的顺序重新编号顶点, 使顶点读取近似顺序访问; 未被引用的顶点移到末尾
+        inline void OptimizeVertexFetch(TriangleMesh &mesh)
+        {
+            size_t nv = mesh.VertexCount(), stride = mesh.attributeStride;
+            const uint32_t None = 0xFFFFFFFFu;
+            std::vector<uint32_t> remap(nv, None), order;
+            order.reserve(nv);
+            for (uint32_t &v : mesh.indices)
+            {
+                if (remap[v] == None)
+                {
+                    remap[v] = static_cast<uint32_t>(order.size());
+                    order.push_back(v);
+                }
+                v = remap[v];
+            }
+            for (size_t v = 0; v < nv; ++v)
+                if (remap[v] == None)
+                    order.push_back(static_cast<uint32_t>(v));
+            std::vector<Vec3> vertices(nv);
+            std::vector<real> attributes(nv * stride);
+            Parallel::For(nv, [&](size_t b, size_t e)
+                          {
+                for (size_t i = b; i < e; ++i)
+                {
+                    vertices[i] = mesh.vertices[order[i]];
+                    std::copy(mesh.attributes.begin() + order[i] * stride, mesh.attributes.begin() + (order[i] + 1) * stride, attributes.begin() + i * stride);
+                } });
+            mesh.vertices.swap(vertices);
+            mesh.attributes.swap(attributes);
+        }
+    }
+
+    // ====================== 光栅化 ======================
+    namespace Raster
+    {
+        // Union: 覆盖率为被任一图元 (或非零环绕数) 覆盖的采样比例, 与已有值取最大;
+        // Accumulate: 各图元覆盖率 (环绕数绝对值) 相加, 用于热力图
+        enum class Mode
+        {
+            Union,
+            Accumulate
+        };
+
+        struct Options
+        {
+            int samplesPerAxis = 1; // 1 为像素中心单采样, 2/4 为 2x2/4x4 超采样抗锯齿
+            Mode mode = Mode::Union;
+        };
+
+        // 逐像素覆盖率, 像素 (x, y) 覆盖 [x, x + 1) x [y, y + 1)
+        struct CoverageMask
+        {
+            int width = 0, height = 0;
+            std::vector<real> coverage;
+
+            CoverageMask() {}
+            CoverageMask(int w, int h) : width(w), height(h), coverage(static_cast<size_t>(w) * h, 0) {}
+
+            real At(int x, int y) const { return coverage[static_cast<size_t>(y) * width + x]; }
+            void Clear() { std::fill(coverage.begin(), coverage.end(), real(0)); }
+            real Sum() const
+            {
+                double s = 0;
+                for (real c : coverage)
+                    s += c;
+                return static_cast<real>(s);
+            }
+        };
+
+        namespace Detail
+        {
+            constexpr int Tile = 32;
+            constexpr int Lanes = 8;
+
+            // 半平面 E(x, y) = a * x + b * y + c >= 0 的三条边 (已统一为逆时针), 及裁剪到画布后的像素包围盒
+            struct Edges
+            {
+                real a[3], b[3], c[3];
+                bool tie[3]; // E == 0 的采样归属: 共享边的两侧三角形恰有一个认领
+                int x0, y0, x1, y1;
+                int sign;
+            };
+
+            // 退化、含非有限坐标或完全在画布外时返回 false; 系数按端点对称计算, 使共享边两侧的 E 精确互为相反数
+            inline bool Setup(Vec2 p0, Vec2 p1, Vec2 p2, int sign, int width, int height, Edges &e)
+            {
+                for (const Vec2 &q : {p0, p1, p2})
+                    if (!std::isfinite(q.x) || !std::isfinite(q.y))
+                        return false;
+                real area = (p1 - p0).cross(p2 - p0);
+                if (!(area != 0))
+                    return false;
+                if (area < 0)
+                {
+                    std::swap(p1, p2);
+                    sign = -sign;
+                }
+                const Vec2 *p[3] = {&p0, &p1, &p2};
+                for (int k = 0; k < 3; ++k)
+                {
+                    const Vec2 &P = *p[k], &Q = *p[(k + 1) % 3];
+                    e.a[k] = P.y - Q.y;
+                    e.b[k] = Q.x - P.x;
+                    e.c[k] = P.x * Q.y - P.y * Q.x;
+                    e.tie[k] = e.a[k] > 0 || (e.a[k] == 0 && e.b[k] > 0);
+                }
+                real minX = std::min({p0.x, p1.x, p2.x}), maxX = std::max({p0.x, p1.x, p2.x});
+                real minY = std::min({p0.y, p1.y, p2.y}), maxY = std::max({p0.y, p1.y, p2.y});
+                if (!(maxX >= 0 && maxY >= 0 && minX < width && minY < height))
+                    return false;
+                // 先在 real 上裁剪到画布再取整, 远离画布的顶点不会溢出 int
+                e.x0 = minX <= 0 ? 0 : static_cast<int>(std::floor(minX));
+                e.y0 = minY <= 0 ? 0 : static_cast<int>(std::floor(minY));
+                e.x1 = maxX >= width ? width : std::min(width, static_cast<int>(std::floor(maxX)) + 1);
+                e.y1 = maxY >= height ? height : std::min(height, static_cast<int>(std::floor(maxY)) + 1);
+                e.sign = sign;
+                return e.x0 < e.x1 && e.y0 < e.y1;
+            }
+
+            // 把三角形在 tile 内覆盖的采样的环绕数累加到 winding (按采样平面排列, 每平面 Tile * Tile);
+            // 计数为 32 位, 同一采样上叠加的图元数不超过 2^31 - 1
+            inline void Scan(const Edges &e, int tx, int ty, int S, int32_t *winding)
+            {
+                int x0 = std::max(e.x0, tx), x1 = std::min(e.x1, tx + Tile);
+                int y0 = std::max(e.y0, ty), y1 = std::min(e.y1, ty + Tile);
+                if (x0 >= x1 || y0 >= y1)
+                    return;
+                const int32_t sign = e.sign;
+                for (int sj = 0; sj < S; ++sj)
+                    for (int si = 0; si < S; ++si)
+                    {
+                        int32_t *plane = winding + (sj * S + si) * Tile * Tile;
+                        real ox = (si + real(0.5)) / S, oy = (sj + real(0.5)) / S;
+                        for (int py = y0; py < y1; ++py)
+                        {
+                            real ys = py + oy;
+                            real r0 = e.b[0] * ys + e.c[0], r1 = e.b[1] * ys + e.c[1], r2 = e.b[2] * ys + e.c[2];
+                            int32_t *row = plane + (py - ty) * Tile - tx;
+                            // 每次评估 Lanes 个像素的边函数, 无分支累加
+                            auto block = [&](int base, int w)
+                            {
+                                for (int k = 0; k < w; ++k)
+                                {
+                                    real xs = static_cast<real>(base + k) + ox;
+                                    real e0 = e.a[0] * xs + r0, e1 = e.a[1] * xs + r1, e2 = e.a[2] * xs + r2;
+                                    bool in = (e0 > 0 || (e.tie[0] && e0 == 0)) & (e1 > 0 || (e.tie[1] && e1 == 0)) & (e2 > 0 || (e.tie[2] && e2 == 0));
+                                    row[base + k] += in ? sign : 0;
+                                }
+                            };
+                            int base = x0;
+                            for (; base + Lanes <= x1; base += Lanes)
+                                block(base, Lanes);
+                            if (base < x1)
+                                block(base, x1 - base);
+                        }
+                    }
+            }
+
+            // 两遍计数分箱 (先并行统计每块落入各 tile 的数量, 再并行写入), 然后逐 tile 并行光栅化;
+            // 同一 tile 内按图元原顺序处理, 结果与线程数无关
+            inline void Rasterize(CoverageMask &mask, const std::vector<Edges> &edges, const Options &opt)
+            {
+                if (edges.empty() || mask.width <= 0 || mask.height <= 0)
+                    return;
+                int S = std::max(1, std::min(opt.samplesPerAxis, 8));
+                int tilesX = (mask.width + Tile - 1) / Tile, tilesY = (mask.height + Tile - 1) / Tile;
+                size_t tiles = static_cast<size_t>(tilesX) * tilesY;
+                const size_t Chunk = 4096;
+                size_t chunks = (edges.size() + Chunk - 1) / Chunk;
+                auto forTiles = [&](const Edges &e, auto &&fn)
+                {
+                    for (int y = e.y0 / Tile; y <= (e.y1 - 1) / Tile; ++y)
+                        for (int x = e.x0 / Tile; x <= (e.x1 - 1) / Tile; ++x)
+                            fn(static_cast<size_t>(y) * tilesX + x);
+                };
+                std::vector<uint32_t> counts(chunks * tiles, 0);
+                Parallel::For(
+                    chunks, [&](size_t b, size_t e)
+                    {
+                        for (size_t c = b; c < e; ++c)
+                            for (size_t i = c * Chunk; i < std::min(edges.size(), (c + 1) * Chunk); ++i)
+                                forTiles(edges[i], [&](size_t t)
+                                         { ++counts[c * tiles + t]; }); },
+                    1);
+                // 偏移按 (tile, 块) 顺序前缀和, 每个 tile 的列表连续且保持图元顺序
+                std::vector<uint32_t> tileStart(tiles + 1, 0);
+                uint32_t total = 0;
+                for (size_t t = 0; t < tiles; ++t)
+                {
+                    tileStart[t] = total;
+                    for (size_t c = 0; c < chunks; ++c)
+                    {
+                        uint32_t n = counts[c * tiles + t];
+                        counts[c * tiles + t] = total;
+                        total += n;
+                    }
+                }
+                tileStart[tiles] = total;
+                std::vector<uint32_t> bins(total);
+                Parallel::For(
+                    chunks, [&](size_t b, size_t e)
+                    {
+                        for (size_t c = b; c < e; ++c)
+                            for (size_t i = c * Chunk; i < std::min(edges.size(), (c + 1) * Chunk); ++i)
+                                forTiles(edges[i], [&](size_t t)
+                                         { bins[counts[c * tiles + t]++] = static_cast<uint32_t>(i); }); },
+                    1);
+
+                const real inv = real(1) / (S * S);
+                Parallel::For(
+                    tiles, [&](size_t b, size_t e)
+                    {
+                        std::vector<int32_t> winding(static_cast<size_t>(S) * S * Tile * Tile);
+                        for (size_t t = b; t < e; ++t)
+                        {
+                            if (tileStart[t] == tileStart[t + 1])
+                                continue;
+                            int tx = static_cast<int>(t % tilesX) * Tile, ty = static_cast<int>(t / tilesX) * Tile;
+                            std::fill(winding.begin(), winding.end(), int32_t(0));
+                            for (uint32_t k = tileStart[t]; k < tileStart[t + 1]; ++k)
+                                Scan(edges[bins[k]], tx, ty, S, winding.data());
+                            int w = std::min(Tile, mask.width - tx), h = std::min(Tile, mask.height - ty);
+                            for (int y = 0; y < h; ++y)
+                                for (int x = 0; x < w; ++x)
+                                {
+                                    int covered = 0;
+                                    for (int s = 0; s < S * S; ++s)
+                                    {
+                                        int v = winding[static_cast<size_t>(s) * Tile * Tile + y * Tile + x];
+                                        covered += opt.mode == Mode::Union ? (v != 0) : std::abs(v);
+                                    }
+                                    real &dst = mask.coverage[static_cast<size_t>(ty + y) * mask.width + tx + x];
+                                    if (opt.mode == Mode::Union)
+                                        dst = std::max(dst, covered * inv);
+                                    else
+                                        dst += covered * inv;
+                                }
+                        }
+                    },
+                    1);
+            }
+        }
+
+        // 光栅化三角形集合, triangles 每 3 个点一个三角形 (像素坐标, 任意朝向)
+        inline void RasterizeTriangles(CoverageMask &mask, const std::vector<Vec2> &triangles, const Options &options = Options())
+        {
+            size_t n = triangles.size() / 3;
+            std::vector<Detail::Edges> all(n);
+            std::vector<unsigned char> valid(n);
+            Parallel::For(n, [&](size_t b, size_t e)
+                          {
+                for (size_t t = b; t < e; ++t)
+                {
+                    valid[t] = Detail::Setup(triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2], 1, mask.width, mask.height, all[t]);
+                    // 统一为正号, 逆时针与顺时针三角形同等计入
+                    all[t].sign = 1;
+                } });
+            std::vector<Detail::Edges> edges;
+            edges.reserve(n);
+            for (size_t t = 0; t < n; ++t)
+                if (valid[t])
+                    edges.push_back(all[t]);
+            Detail::Rasterize(mask, edges, options);
+        }
+
+        // 按非零环绕规则光栅化一组多边形环 (洞用与外环相反的朝向), 自交与凹多边形均可;
+        // 每个环以扇形分解为带符号三角形, 共享边归属唯一, 环绕数在采样点上精确
+        inline void RasterizePolygons(CoverageMask &mask, const std::vector<std::vector<Vec2>> &rings, const Options &options = Options())
+        {
+            std::vector<Detail::Edges> edges;
+            for (const std::vector<Vec2> &ring : rings)
+                for (size_t i = 1; i + 1 < ring.size(); ++i)
+                {
+                    Detail::Edges e;
+                    if (Detail::Setup(ring[0], ring[i], ring[i + 1], 1, mask.width, mask.height, e))
+                        edges.push_back(e);
+                }
+            Detail::Rasterize(mask, edges, options);
+        }
+
+        inline void RasterizePolygon(CoverageMask &mask, const std::vector<Vec2> &polygon, const Options &options = Options())
+        {
+            RasterizePolygons(mask, std::vector<std::vector<Vec2>>{polygon}, options);
+        }
+    }
+
+    // ====================== 批量矩阵运算 ======================
+    namespace Batch
+    {
+        namespace Detail
+        {
+            constexpr size_t Grain = 1 << 12;
+
+            // 展开的乘法核: 先算出全部元素再写回, c 可与 a 或 b 为同一对象
+            inline void MultiplyInto(const Mat2 &a, const Mat2 &b, Mat2 &c)
+            {
+                real c00 = a.m00 * b.m00 + a.m01 * b.m10, c01 = a.m00 * b.m01 + a.m01 * b.m11;
+                real c10 = a.m10 * b.m00 + a.m11 * b.m10, c11 = a.m10 * b.m01 + a.m11 * b.m11;
+                c.m00 = c00, c.m01 = c01, c.m10 = c10, c.m11 = c11;
+            }
+            inline void MultiplyInto(const Mat3 &a, const Mat3 &b, Mat3 &c)
+            {
+                real c00 = a.m00 * b.m00 + a.m01 * b.m10 + a.m02 * b.m20;
+                real c01 = a.m00 * b.m01 + a.m01 * b.m11 + a.m02 * b.m21;
+                real c02 = a.m00 * b.m02 + a.m01 * b.m12 + a.m02 * b.m22;
+                real c10 = a.m10 * b.m00 + a.m11 * b.m10 + a.m12 * b.m20;
+                real c11 = a.m10 * b.m01 + a.m11 * b.m11 + a.m12 * b.m21;
+                real c12 = a.m10 * b.m02 + a.m11 * b.m12 + a.m12 * b.m22;
+                real c20 = a.m20 * b.m00 + a.m21 * b.m10 + a.m22 * b.m20;
+                real c21 = a.m20 * b.m01 + a.m21 * b.m11 + a.m22 * b.m21;
+                real c22 = a.m20 * b.m02 + a.m21 * b.m12 + a.m22 * b.m22;
+                c.m00 = c00, c.m01 = c01, c.m02 = c02;
+                c.m10 = c10, c.m11 = c11, c.m12 = c12;
+                c.m20 = c20, c.m21 = c21, c.m22 = c22;
+            }
+
+            // C[i] = A[i * stepA] * B[i * stepB], step 为 0 时广播同一矩阵;
+            // C 可与逐元素的 A 或 B 重合 (原地), 但广播的矩阵不能位于 C 中.
+            // 输入是逐个存放的矩阵, 先按 Lanes 个转置成结构数组再相乘反而更慢
+            // (转置无法向量化, 见 benchmarks/batch_multiply.cpp), 故逐矩阵使用展开核
+            template <typename M>
+            inline void Multiply(const M *A, size_t stepA, const M *B, size_t stepB, M *C, size_t n)
+            {
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            MultiplyInto(A[i * stepA], B[i * stepB], C[i]); },
+                    Grain);
+            }
+        }
+
+        // C[i] = A[i] * B[i]
+        inline void MultiplyMany(const Mat3 *A, const Mat3 *B, Mat3 *C, size_t n) { Detail::Multiply(A, 1, B, 1, C, n); }
+        // C[i] = A * B[i]
+        inline void MultiplyMany(const Mat3 &A, const Mat3 *B, Mat3 *C, size_t n) { Detail::Multiply(&A, 0, B, 1, C, n); }
+        // C[i] = A[i] * B
+        inline void MultiplyMany(const Mat3 *A, const Mat3 &B, Mat3 *C, size_t n) { Detail::Multiply(A, 1, &B, 0, C, n); }
+
+        inline void MultiplyMany(const Mat2 *A, const Mat2 *B, Mat2 *C, size_t n) { Detail::Multiply(A, 1, B, 1, C, n); }
+        inline void MultiplyMany(const Mat2 &A, const Mat2 *B, Mat2 *C, size_t n) { Detail::Multiply(&A, 0, B, 1, C, n); }
+        inline void MultiplyMany(const Mat2 *A, const Mat2 &B, Mat2 *C, size_t n) { Detail::Multiply(A, 1, &B, 0, C, n); }
+        // 结构数组 (SoA) 形式的 Mat3 集合: m[r * 3 + c][i] 为第 i 个矩阵的 (r, c) 元素;
+        // 批量运算的内层循环沿连续数组逐元素进行, 由编译器向量化为一次处理多个矩阵
+        struct Mat3Batch
+        {
+            std::vector<real> m[9];
+
+            Mat3Batch() {}
+            explicit Mat3Batch(size_t n) { Resize(n); }
+            Mat3Batch(const Mat3 *mats, size_t n) { FromArray(mats, n); }
+
+            size_t Size() const { return m[0].size(); }
+            void Resize(size_t n)
+            {
+                for (std::vector<real> &e : m)
+                    e.resize(n);
+            }
+
+            Mat3 Get(size_t i) const { return Mat3(m[0][i], m[1][i], m[2][i], m[3][i], m[4][i], m[5][i], m[6][i], m[7][i], m[8][i]); }
+            void Set(size_t i, const Mat3 &a)
+            {
+                m[0][i] = a.m00, m[1][i] = a.m01, m[2][i] = a.m02;
+                m[3][i] = a.m10, m[4][i] = a.m11, m[5][i] = a.m12;
+                m[6][i] = a.m20, m[7][i] = a.m21, m[8][i] = a.m22;
+            }
+
+            void FromArray(const Mat3 *mats, size_t n)
+            {
+                Resize(n);
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            Set(i, mats[i]); },
+                    Detail::Grain);
+            }
+            void ToArray(Mat3 *out) const
+            {
+                Parallel::For(
+                    Size(), [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            out[i] = Get(i); },
+                    Detail::Grain);
+            }
+        };
+
+        namespace Detail
+        {
+            struct Columns
+            {
+                const real *m[9];
+                explicit Columns(const Mat3Batch &a)
+                {
+                    for (int k = 0; k < 9; ++k)
+                        m[k] = a.m[k].data();
+                }
+            };
+
+            // Lanes 个 3x3 矩阵按元素排列, e[r * 3 + c][j] 为第 j 个矩阵的 (r, c) 元素;
+            // 下列核函数的内层循环都沿 j 进行, 固定宽度便于编译器向量化
+            constexpr size_t Lanes = 8;
+            struct LaneMat3
+            {
+                real e[9][Lanes];
+            };
+
+            // w < Lanes 时其余 lane 填单位矩阵; 整块时是定长连续读取, 可以向量化
+            inline void LaneLoad(const Mat3Batch &a, size_t base, size_t w, LaneMat3 &x)
+            {
+                if (w == Lanes)
+                {
+                    for (int k = 0; k < 9; ++k)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            x.e[k][j] = a.m[k][base + j];
+                    return;
+                }
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        x.e[k][j] = j < w ? a.m[k][base + j] : (k % 4 == 0 ? real(1) : real(0));
+            }
+            inline void LaneStore(const LaneMat3 &x, size_t base, size_t w, Mat3Batch &a)
+            {
+                if (w == Lanes)
+                {
+                    for (int k = 0; k < 9; ++k)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            a.m[k][base + j] = x.e[k][j];
+                    return;
+                }
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < w; ++j)
+                        a.m[k][base + j] = x.e[k][j];
+            }
+            inline void LaneSet(LaneMat3 &x, size_t j, const Mat3 &m)
+            {
+                x.e[0][j] = m.m00, x.e[1][j] = m.m01, x.e[2][j] = m.m02;
+                x.e[3][j] = m.m10, x.e[4][j] = m.m11, x.e[5][j] = m.m12;
+                x.e[6][j] = m.m20, x.e[7][j] = m.m21, x.e[8][j] = m.m22;
+            }
+            inline void LaneIdentity(LaneMat3 &x)
+            {
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        x.e[k][j] = k % 4 == 0 ? real(1) : real(0);
+            }
+            // c = a * b, c 不能与 a 或 b 重合
+            inline void LaneMul(const LaneMat3 &a, const LaneMat3 &b, LaneMat3 &c)
+            {
+                for (int r = 0; r < 3; ++r)
+                    for (int col = 0; col < 3; ++col)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            c.e[r * 3 + col][j] = a.e[r * 3][j] * b.e[col][j] + a.e[r * 3 + 1][j] * b.e[3 + col][j] + a.e[r * 3 + 2][j] * b.e[6 + col][j];
+            }
+            // 伴随矩阵除以行列式; 行列式写入 det
+            inline void LaneInverse(const LaneMat3 &a, LaneMat3 &inv, real *det)
+            {
+                const auto &m = a.e;
+                for (size_t j = 0; j < Lanes; ++j)
+                {
+                    real c00 = m[4][j] * m[8][j] - m[5][j] * m[7][j], c10 = m[5][j] * m[6][j] - m[3][j] * m[8][j], c20 = m[3][j] * m[7][j] - m[4][j] * m[6][j];
+                    real d = m[0][j] * c00 + m[1][j] * c10 + m[2][j] * c20;
+                    real s = 1 / d;
+                    det[j] = d;
+                    inv.e[0][j] = c00 * s;
+                    inv.e[1][j] = (m[2][j] * m[7][j] - m[1][j] * m[8][j]) * s;
+                    inv.e[2][j] = (m[1][j] * m[5][j] - m[2][j] * m[4][j]) * s;
+                    inv.e[3][j] = c10 * s;
+                    inv.e[4][j] = (m[0][j] * m[8][j] - m[2][j] * m[6][j]) * s;
+                    inv.e[5][j] = (m[2][j] * m[3][j] - m[0][j] * m[5][j]) * s;
+                    inv.e[6][j] = c20 * s;
+                    inv.e[7][j] = (m[1][j] * m[6][j] - m[0][j] * m[7][j]) * s;
+                    inv.e[8][j] = (m[0][j] * m[4][j] - m[1][j] * m[3][j]) * s;
+                }
+            }
+            inline void LaneNorm(const LaneMat3 &a, real *out)
+            {
+                for (size_t j = 0; j < Lanes; ++j)
+                    out[j] = 0;
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        out[j] += a.e[k][j] * a.e[k][j];
+                for (size_t j = 0; j < Lanes; ++j)
+                    out[j] = std::sqrt(out[j]);
+            }
+
+            // 按 Lanes 个一块遍历, kernel(base, w) 处理 [base, base + w);
+            // 整块以常量 Lanes 调用, 内联后整块路径与尾块分开编译, 不会因尾块的条件读写而退化为标量
+            template <typename Kernel>
+            inline void ForLaneBlocks(size_t n, Kernel &&kernel)
+            {
+                Parallel::For(
+                    (n + Lanes - 1) / Lanes, [&](size_t b, size_t e)
+                    {
+                        for (size_t blk = b; blk < e; ++blk)
+                        {
+                            size_t base = blk * Lanes;
+                            if (n - base >= Lanes)
+                                kernel(base, Lanes);
+                            else
+                                kernel(base, n - base);
+                        } },
+                    Grain / Lanes);
+            }
+        }
+
+        inline void Det(const Mat3Batch &a, real *out)
+        {
+            Detail::Columns A(a);
+            Parallel::For(
+                a.Size(), [&](size_t b, size_t e)
+                {
+                    const real *const *m = A.m;
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = m[0][i] * (m[4][i] * m[8][i] - m[5][i] * m[7][i]) - m[1][i] * (m[3][i] * m[8][i] - m[5][i] * m[6][i]) + m[2][i] * (m[3][i] * m[7][i] - m[4][i] * m[6][i]); },
+                Detail::Grain);
+        }
+
+        inline void Trace(const Mat3Batch &a, real *out)
+        {
+            Detail::Columns A(a);
+            Parallel::For(
+                a.Size(), [&](size_t b, size_t e)
+                {
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = A.m[0][i] + A.m[4][i] + A.m[8][i]; },
+                Detail::Grain);
+        }
+
+        // 以下三个运算按 Lanes 个矩阵一块读入局部数组再计算, 整块读完后才写回, out 可以是 a 本身
+        inline void Transpose(const Mat3Batch &a, Mat3Batch &out)
+        {
+            out.Resize(a.Size());
+            Detail::ForLaneBlocks(a.Size(), [&](size_t base, size_t w)
+                                  {
+                Detail::LaneMat3 T;
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Detail::Lanes; ++j)
+                        T.e[k][j] = j < w ? a.m[(k % 3) * 3 + k / 3][base + j] : real(0);
+                Detail::LaneStore(T, base, w, out); });
+        }
+
+        // 逐元素乘积 out[i] = a[i] * b[i], out 可以是 a 或 b
+        inline void Multiply(const Mat3Batch &a, const Mat3Batch &b, Mat3Batch &out)
+        {
+            if (a.Size() != b.Size())
+                throw("Batch size mismatch");
+            out.Resize(a.Size());
+            Detail::ForLaneBlocks(a.Size(), [&](size_t base, size_t w)
+                                  {
+                Detail::LaneMat3 X, Y, Z;
+                Detail::LaneLoad(a, base, w, X);
+                Detail::LaneLoad(b, base, w, Y);
+                Detail::LaneMul(X, Y, Z);
+                Detail::LaneStore(Z, base, w, out); });
+        }
+
+        // 伴随矩阵除以行列式; 先并行检查全部行列式, 任一矩阵奇异时在写 out 之前抛出异常 (与 Mat3::Inv 一样无副作用)
+        inline void Inv(const Mat3Batch &a, Mat3Batch &out)
+        {
+            Detail::Columns A(a);
+            std::atomic<bool> singular(false);
+            Parallel::For(
+                a.Size(), [&](size_t b, size_t e)
+                {
+                    const real *const *m = A.m;
+                    bool bad = false;
+                    for (size_t i = b; i < e; ++i)
+                    {
+                        real d = m[0][i] * (m[4][i] * m[8][i] - m[5][i] * m[7][i]) - m[1][i] * (m[3][i] * m[8][i] - m[5][i] * m[6][i]) + m[2][i] * (m[3][i] * m[7][i] - m[4][i] * m[6][i]);
+                        bad |= std::abs(d) < Constants::Epsilon;
+                    }
+                    if (bad)
+                        singular.store(true, std::memory_order_relaxed); },
+                Detail::Grain);
+            if (singular.load())
+                throw("Matrix is singular");
+            out.Resize(a.Size());
+            Detail::ForLaneBlocks(a.Size(), [&](size_t base, size_t w)
+                                  {
+                Detail::LaneMat3 X, Y;
+                real det[Detail::Lanes];
+                Detail::LaneLoad(a, base, w, X);
+                Detail::LaneInverse(X, Y, det);
+                Detail::LaneStore(Y, base, w, out); });
+        }
+        // Mat2 的结构数组形式, m[r * 2 + c][i] 为第 i 个矩阵的 (r, c) 元素
+        struct Mat2Batch
+        {
+            std::vector<real> m[4];
+
+            Mat2Batch() {}
+            explicit Mat2Batch(size_t n) { Resize(n); }
+            Mat2Batch(const Mat2 *mats, size_t n) { FromArray(mats, n); }
+
+            size_t Size() const { return m[0].size(); }
+            void Resize(size_t n)
+            {
+                for (std::vector<real> &e : m)
+                    e.resize(n);
+            }
+
+            Mat2 Get(size_t i) const { return Mat2(m[0][i], m[1][i], m[2][i], m[3][i]); }
+            void Set(size_t i, const Mat2 &a) { m[0][i] = a.m00, m[1][i] = a.m01, m[2][i] = a.m10, m[3][i] = a.m11; }
+
+            void FromArray(const Mat2 *mats, size_t n)
+            {
+                Resize(n);
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            Set(i, mats[i]); },
+                    Detail::Grain);
+            }
+            void ToArray(Mat2 *out) const
+            {
+                Parallel::For(
+                    Size(), [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            out[i] = Get(i); },
+                    Detail::Grain);
+            }
+        };
+
+        // 二维闭式解逐元素计算, 分支写成条件选择
+        inline void PolarDecomposition(const Mat2Batch &a, Mat2Batch &R, Mat2Batch &S)
+        {
+            size_t n = a.Size();
+            const real *m00 = a.m[0].data(), *m01 = a.m[1].data(), *m10 = a.m[2].data(), *m11 = a.m[3].data();
+            R.Resize(n);
+            S.Resize(n);
+            real *r0 = R.m[0].data(), *r1 = R.m[1].data(), *r2 = R.m[2].data(), *r3 = R.m[3].data();
+            real *s0 = S.m[0].data(), *s1 = S.m[1].data(), *s2 = S.m[2].data(), *s3 = S.m[3].data();
+            Parallel::For(
+                n, [&](size_t lo, size_t hi)
+                {
+                    for (size_t i = lo; i < hi; ++i)
+                    {
+                        real sgn = m00[i] * m11[i] - m01[i] * m10[i] < 0 ? real(-1) : real(1);
+                        real x = m00[i] + sgn * m11[i], y = m01[i] - sgn * m10[i];
+                        real len = std::sqrt(x * x + y * y);
+                        bool ok = len >= Constants::Epsilon;
+                        real inv = ok ? 1 / len : real(0);
+                        real r00 = ok ? x * inv : real(1), r01 = y * inv, r10 = -sgn * y * inv, r11 = ok ? sgn * x * inv : real(1);
+                        real s00 = r00 * m00[i] + r10 * m10[i], s11 = r01 * m01[i] + r11 * m11[i];
+                        real s01 = ((r00 * m01[i] + r10 * m11[i]) + (r01 * m00[i] + r11 * m10[i])) * 0.5f;
+                        r0[i] = r00, r1[i] = r01, r2[i] = r10, r3[i] = r11;
+                        s0[i] = s00, s1[i] = s01, s2[i] = s01, s3[i] = s11;
+                    } },
+                Detail::Grain);
+        }
+
+        inline void Exp(const Mat2Batch &a, Mat2Batch &out)
+        {
+            size_t n = a.Size();
+            const real *m00 = a.m[0].data(), *m01 = a.m[1].data(), *m10 = a.m[2].data(), *m11 = a.m[3].data();
+            out.Resize(n);
+            real *o00 = out.m[0].data(), *o01 = out.m[1].data(), *o10 = out.m[2].data(), *o11 = out.m[3].data();
+            Parallel::For(
+                n, [&](size_t lo, size_t hi)
+                {
+                    for (size_t i = lo; i < hi; ++i)
+                    {
+                        real t = (m00[i] + m11[i]) * 0.5f, b00 = m00[i] - t, b01 = m01[i], b10 = m10[i];
+                        real d = b00 * b00 + b01 * b10;
+                        real r = std::sqrt(std::abs(d));
+                        real c = d > Constants::Epsilon ? std::cosh(r) : d < -Constants::Epsilon ? std::cos(r) : 1 + d / 2 + d * d / 24;
+                        real s = d > Constants::Epsilon ? std::sinh(r) / r : d < -Constants::Epsilon ? std::sin(r) / r : 1 + d / 6 + d * d / 120;
+                        real e = std::exp(t);
+                        o00[i] = e * (c + s * b00), o01[i] = e * s * b01, o10[i] = e * s * b10, o11[i] = e * (c - s * b00);
+                    } },
+                Detail::Grain);
+        }
+
+        // 任一矩阵的对数无定义时抛出异常
+        inline void Log(const Mat2Batch &a, Mat2Batch &out)
+        {
+            size_t n = a.Size();
+            const real *m00 = a.m[0].data(), *m01 = a.m[1].data(), *m10 = a.m[2].data(), *m11 = a.m[3].data();
+            out.Resize(n);
+            real *o00 = out.m[0].data(), *o01 = out.m[1].data(), *o10 = out.m[2].data(), *o11 = out.m[3].data();
+            std::atomic<bool> undefined(false);
+            Parallel::For(
+                n, [&](size_t lo, size_t hi)
+                {
+                    bool bad = false;
+                    for (size_t i = lo; i < hi; ++i)
+                    {
+                        real t = (m00[i] + m11[i]) * 0.5f, b00 = m00[i] - t, b01 = m01[i], b10 = m10[i];
+                        real d = b00 * b00 + b01 * b10;
+                        real r = std::sqrt(std::abs(d)), tol = Constants::Epsilon * t * t;
+                        bad |= d > tol ? t <= r : d < -tol ? false : t <= 0;
+                        real beta = d > tol ? std::atanh(r / t) / r : d < -tol ? std::atan2(r, t) / r : (1 + d / (3 * t * t)) / t;
+                        real alpha = 0.5f * std::log(t * t - d);
+                        o00[i] = alpha + beta * b00, o01[i] = beta * b01, o10[i] = beta * b10, o11[i] = alpha - beta * b00;
+                    }
+                    if (bad)
+                        undefined.store(true, std::memory_order_relaxed); },
+                Detail::Grain);
+            if (undefined.load())
+                throw("Matrix logarithm undefined");
+        }
+
+        // 逐块 Higham 迭代, 块内全部收敛后停止; 接近奇异的矩阵单独用 Mat3::PolarDecomposition (SVD) 处理
+        inline void PolarDecomposition(const Mat3Batch &a, Mat3Batch &R, Mat3Batch &S)
+        {
+            size_t n = a.Size();
+            R.Resize(n);
+            S.Resize(n);
+            Detail::ForLaneBlocks(n, [&](size_t base, size_t w)
+                                  {
+                using namespace Detail;
+                LaneMat3 A, X, Xi, P;
+                real norm[Lanes], det[Lanes], normX[Lanes], normXi[Lanes];
+                bool fallback[Lanes];
+                LaneLoad(a, base, w, A);
+                LaneNorm(A, norm);
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        X.e[k][j] = norm[j] > 0 ? A.e[k][j] / norm[j] : (k % 4 == 0 ? real(1) : real(0));
+                LaneInverse(X, Xi, det);
+                for (size_t j = 0; j < Lanes; ++j)
+                    fallback[j] = !(std::abs(det[j]) >= Constants::Epsilon);
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        X.e[k][j] = fallback[j] ? (k % 4 == 0 ? real(1) : real(0)) : X.e[k][j];
+                for (int it = 0; it < 32; ++it)
+                {
+                    LaneInverse(X, Xi, det);
+                    LaneNorm(X, normX);
+                    LaneNorm(Xi, normXi);
+                    real change = 0;
+                    for (int k = 0; k < 9; ++k)
+                    {
+                        int kt = (k % 3) * 3 + k / 3;
+                        for (size_t j = 0; j < Lanes; ++j)
+                        {
+                            real g = std::sqrt(normXi[j] / normX[j]);
+                            real next = (g * X.e[k][j] + Xi.e[kt][j] / g) * 0.5f;
+                            change = std::max(change, std::abs(next - X.e[k][j]));
+                            X.e[k][j] = next;
+                        }
+                    }
+                    if (change <= 4 * Constants::Epsilon)
+                        break;
+                }
+                // S = R^T A 并对称化
+                for (int r = 0; r < 3; ++r)
+                    for (int c = 0; c < 3; ++c)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            P.e[r * 3 + c][j] = X.e[r][j] * A.e[c][j] + X.e[3 + r][j] * A.e[3 + c][j] + X.e[6 + r][j] * A.e[6 + c][j];
+                for (int r = 0; r < 3; ++r)
+                    for (int c = r + 1; c < 3; ++c)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            P.e[r * 3 + c][j] = P.e[c * 3 + r][j] = (P.e[r * 3 + c][j] + P.e[c * 3 + r][j]) * 0.5f;
+                for (size_t j = 0; j < w; ++j)
+                    if (fallback[j])
+                    {
+                        Mat3 r, s;
+                        a.Get(base + j).PolarDecomposition(r, s);
+                        LaneSet(X, j, r);
+                        LaneSet(P, j, s);
+                    }
+                LaneStore(X, base, w, R);
+                LaneStore(P, base, w, S); });
+        }
+
+        // 逐矩阵选择缩放次数, [6/6] Padé 后按各自次数做带掩码的平方
+        inline void Exp(const Mat3Batch &a, Mat3Batch &out)
+        {
+            size_t n = a.Size();
+            out.Resize(n);
+            Detail::ForLaneBlocks(n, [&](size_t base, size_t w)
+                                  {
+                using namespace Detail;
+                LaneMat3 X, P, T, N, D, Di;
+                real norm[Lanes], det[Lanes];
+                int s[Lanes], maxS = 0;
+                LaneLoad(a, base, w, X);
+                LaneNorm(X, norm);
+                for (size_t j = 0; j < Lanes; ++j)
+                {
+                    s[j] = norm[j] > 0.5f ? static_cast<int>(std::ceil(std::log2(norm[j] / 0.5f))) : 0;
+                    maxS = std::max(maxS, s[j]);
+                    norm[j] = std::ldexp(real(1), -s[j]);
+                }
+                for (int k = 0; k < 9; ++k)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        X.e[k][j] *= norm[j];
+                LaneIdentity(N);
+                LaneIdentity(D);
+                LaneIdentity(P);
+                real c = 1;
+                for (int k = 1; k <= 6; ++k)
+                {
+                    c *= real(7 - k) / real(k * (13 - k));
+                    LaneMul(P, X, T);
+                    P = T;
+                    real sc = k % 2 ? -c : c;
+                    for (int e = 0; e < 9; ++e)
+                        for (size_t j = 0; j < Lanes; ++j)
+                        {
+                            N.e[e][j] += c * P.e[e][j];
+                            D.e[e][j] += sc * P.e[e][j];
+                        }
+                }
+                LaneInverse(D, Di, det);
+                LaneMul(Di, N, X);
+                for (int i = 0; i < maxS; ++i)
+                {
+                    LaneMul(X, X, T);
+                    for (int e = 0; e < 9; ++e)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            X.e[e][j] = i < s[j] ? T.e[e][j] : X.e[e][j];
+                }
+                LaneStore(X, base, w, out); });
+        }
+
+        // 与 Mat3::Log 相同的逆缩放平方, 开平方轮次逐矩阵计数; 任一矩阵的对数无定义时抛出异常
+        inline void Log(const Mat3Batch &a, Mat3Batch &out)
+        {
+            size_t n = a.Size();
+            out.Resize(n);
+            std::atomic<bool> undefined(false);
+            Detail::ForLaneBlocks(n, [&](size_t base, size_t w)
+                                  {
+                using namespace Detail;
+                static const real nodes[5] = {0.0469100770306680f, 0.2307653449471585f, 0.5f, 0.7692346550528415f, 0.9530899229693320f};
+                static const real weights[5] = {0.1184634425280945f, 0.2393143352496832f, 0.2844444444444444f, 0.2393143352496832f, 0.1184634425280945f};
+                LaneMat3 X, Y, Z, Yi, Zi, T, L;
+                real det[Lanes], scale[Lanes], dist[Lanes];
+                int k[Lanes] = {};
+                LaneLoad(a, base, w, X);
+                LaneInverse(X, T, det);
+                bool bad = false;
+                for (size_t j = 0; j < Lanes; ++j)
+                {
+                    bad |= !(det[j] > 0);
+                    scale[j] = det[j] > 0 ? std::cbrt(det[j]) : real(1);
+                }
+                if (bad)
+                {
+                    undefined.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                for (int e = 0; e < 9; ++e)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        X.e[e][j] /= scale[j];
+                for (int round = 0;; ++round)
+                {
+                    for (int e = 0; e < 9; ++e)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            T.e[e][j] = X.e[e][j] - (e % 4 == 0 ? real(1) : real(0));
+                    LaneNorm(T, dist);
+                    bool any = false;
+                    for (size_t j = 0; j < Lanes; ++j)
+                        any |= dist[j] > 0.25f;
+                    if (!any)
+                        break;
+                    if (round >= 40)
+                    {
+                        undefined.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    // Denman-Beavers: Y -> sqrt(X), Z -> X^-1/2
+                    Y = X;
+                    LaneIdentity(Z);
+                    for (int it = 0; it < 32; ++it)
+                    {
+                        LaneInverse(Y, Yi, det);
+                        LaneInverse(Z, Zi, det);
+                        real change = 0;
+                        for (int e = 0; e < 9; ++e)
+                            for (size_t j = 0; j < Lanes; ++j)
+                            {
+                                real ny = (Y.e[e][j] + Zi.e[e][j]) * 0.5f;
+                                change = std::max(change, std::abs(ny - Y.e[e][j]));
+                                Y.e[e][j] = ny;
+                                Z.e[e][j] = (Z.e[e][j] + Yi.e[e][j]) * 0.5f;
+                            }
+                        if (change <= 10 * Constants::Epsilon)
+                            break;
+                    }
+                    for (size_t j = 0; j < Lanes; ++j)
+                        k[j] += dist[j] > 0.25f;
+                    for (int e = 0; e < 9; ++e)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            X.e[e][j] = dist[j] > 0.25f ? Y.e[e][j] : X.e[e][j];
+                }
+                // log(I + Y) 的 Gauss-Legendre 求积, Y = X - I
+                for (int e = 0; e < 9; ++e)
+                    for (size_t j = 0; j < Lanes; ++j)
+                    {
+                        Y.e[e][j] = X.e[e][j] - (e % 4 == 0 ? real(1) : real(0));
+                        L.e[e][j] = 0;
+                    }
+                for (int q = 0; q < 5; ++q)
+                {
+                    for (int e = 0; e < 9; ++e)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            T.e[e][j] = nodes[q] * Y.e[e][j] + (e % 4 == 0 ? real(1) : real(0));
+                    LaneInverse(T, Zi, det);
+                    LaneMul(Y, Zi, T);
+                    for (int e = 0; e < 9; ++e)
+                        for (size_t j = 0; j < Lanes; ++j)
+                            L.e[e][j] += weights[q] * T.e[e][j];
+                }
+                for (int e = 0; e < 9; ++e)
+                    for (size_t j = 0; j < Lanes; ++j)
+                        L.e[e][j] = L.e[e][j] * std::ldexp(real(1), k[j]) + (e % 4 == 0 ? std::log(scale[j]) : real(0));
+                LaneStore(L, base, w, out); });
+            if (undefined.load())
+                throw("Matrix logarithm undefined");
+        }
+    }
+
+    // ====================== 低差异序列 ======================
+    namespace Sampling
+    {
+        enum class Sequence
+        {
+            Sobol,           // Joe-Kuo 方向数, 最多 8 维, 下标小于 2^32
+            OwenSobol,       // Sobol + 基于哈希的嵌套均匀 (Owen) 置乱, 保持 (t, m, s) 网性质
+            Halton,          // 前 16 个素数为底, 最多 16 维
+            ScrambledHalton, // 每维随机数字置换 (0 不动)
+            R2               // Roberts 广义黄金比序列, 点数不限
+        };
+
+        namespace Detail
+        {
+            constexpr int SobolDims = 8;
+            constexpr int HaltonDims = 16;
+            constexpr uint32_t Primes[HaltonDims] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+
+            // 方向数 V[d][k] (左对齐 32 位), 以及前缀异或 P[d][k] = V[d][0] ^ ... ^ V[d][k] 用于顺序递推
+            struct SobolTable
+            {
+                uint32_t V[SobolDims][32], P[SobolDims][32];
+
+                SobolTable()
+                {
+                    // new-joe-kuo-6.21201 的前 7 个本原多项式 (第 1 维为 van der Corput)
+                    static const uint32_t s[SobolDims] = {0, 1, 2, 3, 3, 4, 4, 5};
+                    static const uint32_t a[SobolDims] = {0, 0, 1, 1, 2, 1, 4, 2};
+                    static const uint32_t m[SobolDims][5] = {{0}, {1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3}, {1, 3, 5, 13}, {1, 1, 5, 5, 17}};
+                    for (int k = 0; k < 32; ++k)
+                        V[0][k] = 1u << (31 - k);
+                    for (int d = 1; d < SobolDims; ++d)
+                    {
+                        for (uint32_t k = 0; k < s[d]; ++k)
+                            V[d][k] = m[d][k] << (31 - k);
+                        for (uint32_t k = s[d]; k < 32; ++k)
+                        {
+                            V[d][k] = V[d][k - s[d]] ^ (V[d][k - s[d]] >> s[d]);
+                            for (uint32_t j = 1; j < s[d]; ++j)
+                                V[d][k] ^= ((a[d] >> (s[d] - 1 - j)) & 1) * V[d][k - j];
+                        }
+                    }
+                    for (int d = 0; d < SobolDims; ++d)
+                        for (int k = 0; k < 32; ++k)
+                            P[d][k] = V[d][k] ^ (k ? P[d][k - 1] : 0u);
+                }
+
+                static const SobolTable &Instance()
+                {
+                    static const SobolTable table;
+                    return table;
+                }
+            };
+
+            inline uint32_t ReverseBits(uint32_t x)
+            {
+                x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+                x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+                x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+                x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+                return (x >> 16) | (x << 16);
+            }
+
+            // Burley (2020) 的 Laine-Karras 式哈希: 在位反转域中只让低位影响高位, 等价于 Owen 置乱
+            inline uint32_t OwenScramble(uint32_t x, uint32_t seed)
+            {
+                x = ReverseBits(x);
+                x += seed;
+                x ^= x * 0x6C50B47Cu;
+                x ^= x * 0xB82F1E52u;
+                x ^= x * 0xC7AFE638u;
+                x ^= x * 0x8D22F6E6u;
+                return ReverseBits(x);
+            }
+
+            inline uint32_t DimensionSeed(uint32_t seed, int dim)
+            {
+                uint64_t z = (static_cast<uint64_t>(seed) << 32 | static_cast<uint32_t>(dim)) + 0x9E3779B97F4A7C15ull;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return static_cast<uint32_t>(z ^ (z >> 31));
+            }
+
+            inline real ToUnit(uint32_t bits)
+            {
+                // 只取能精确表示的高位, 保证结果严格小于 1
+                if (sizeof(real) == sizeof(double))
+                    return static_cast<real>(bits * (1.0 / 4294967296.0));
+                return static_cast<real>((bits >> 8) * (1.0f / 16777216.0f));
+            }
+
+            inline uint32_t SobolBits(uint32_t index, int dim)
+            {
+                const SobolTable &t = SobolTable::Instance();
+                uint32_t x = 0;
+                for (int k = 0; index; ++k, index >>= 1)
+                    x ^= (index & 1) * t.V[dim][k];
+                return x;
+            }
+
+            // 以 base 为底的根式逆, perm 为可选的数字置换
+            inline real RadicalInverse(uint64_t index, uint32_t base, const uint8_t *perm)
+            {
+                double inv = 1.0 / base, f = inv, result = 0;
+                for (; index; index /= base, f *= inv)
+                {
+                    uint32_t digit = static_cast<uint32_t>(index % base);
+                    result += (perm ? perm[digit] : digit) * f;
+                }
+                return static_cast<real>(std::min(result, 1.0 - std::numeric_limits<real>::epsilon() / 2));
+            }
+
+            // 每维一个数字置换, 0 保持不动以免无穷多个前导 0 带来偏移
+            inline const uint8_t *HaltonPermutation(uint32_t seed, int dim)
+            {
+                thread_local uint32_t cachedSeed = 0;
+                thread_local bool ready = false;
+                thread_local uint8_t perms[HaltonDims][64];
+                if (!ready || cachedSeed != seed)
+                {
+                    for (int d = 0; d < HaltonDims; ++d)
+                    {
+                        uint32_t b = Primes[d];
+                        for (uint32_t k = 0; k < b; ++k)
+                            perms[d][k] = static_cast<uint8_t>(k);
+                        MathTools::FastRandom rng(seed, static_cast<uint64_t>(d));
+                        for (uint32_t k = b - 1; k > 1; --k)
+                            std::swap(perms[d][k], perms[d][1 + rng.Index(k)]);
+                    }
+                    cachedSeed = seed;
+                    ready = true;
+                }
+                return perms[dim];
+            }
+
+            // R_d 序列的步长 alpha_k = phi_d^-k, phi_d 为 x^(d+1) = x + 1 的正根; 用 64 位定点避免大下标时的精度损失
+            inline uint64_t R2Step(int dim, int dims)
+            {
+                double phi = 2;
+                for (int it = 0; it < 64; ++it)
+                    phi = std::pow(1 + phi, 1.0 / (dims + 1));
+                double alpha = std::pow(1 / phi, dim + 1);
+                return static_cast<uint64_t>(std::ldexp(alpha, 64));
+            }
+
+            inline real R2At(uint64_t index, uint64_t step)
+            {
+                uint64_t x = 0x8000000000000000ull + index * step;
+                return ToUnit(static_cast<uint32_t>(x >> 32));
+            }
+
+            inline int MaxDims(Sequence seq)
+            {
+                return seq == Sequence::Sobol || seq == Sequence::OwenSobol ? SobolDims : seq == Sequence::R2 ? std::numeric_limits<int>::max() : HaltonDims;
+            }
+
+            // out[k * D + d] 为第 first + k 个点的第 d 维; Sobol 在块内按 x(i + 1) = x(i) ^ P[ctz(i + 1)] 递推
+            template <int D>
+            inline void Generate(Sequence seq, real *out, size_t count, uint64_t first, uint32_t seed)
+            {
+                if (D > MaxDims(seq))
+                    throw("Too many dimensions for sequence");
+                if ((seq == Sequence::Sobol || seq == Sequence::OwenSobol) && first + count > (1ull << 32))
+                    throw("Sobol index out of range");
+                uint64_t steps[D];
+                uint32_t seeds[D];
+                for (int d = 0; d < D; ++d)
+                {
+                    steps[d] = seq == Sequence::R2 ? R2Step(d, D) : 0;
+                    seeds[d] = DimensionSeed(seed, d);
+                }
+                Parallel::For(count, [&](size_t b, size_t e)
+                              {
+                    if (seq == Sequence::Sobol || seq == Sequence::OwenSobol)
+                    {
+                        const SobolTable &t = SobolTable::Instance();
+                        uint32_t x[D];
+                        uint32_t index = static_cast<uint32_t>(first + b);
+                        for (int d = 0; d < D; ++d)
+                            x[d] = SobolBits(index, d);
+                        for (size_t i = b; i < e; ++i, ++index)
+                        {
+                            if (i > b)
+                            {
+                                int tz = 0;
+                                for (uint32_t v = index; !(v & 1); v >>= 1)
+                                    ++tz;
+                                for (int d = 0; d < D; ++d)
+                                    x[d] ^= t.P[d][tz];
+                            }
+                            for (int d = 0; d < D; ++d)
+                                out[i * D + d] = ToUnit(seq == Sequence::OwenSobol ? OwenScramble(x[d], seeds[d]) : x[d]);
+                        }
+                    }
+                    else if (seq == Sequence::R2)
+                    {
+                        for (size_t i = b; i < e; ++i)
+                            for (int d = 0; d < D; ++d)
+                                out[i * D + d] = R2At(first + i, steps[d]);
+                    }
+                    else
+                    {
+                        const uint8_t *perm[D];
+                        for (int d = 0; d < D; ++d)
+                            perm[d] = seq == Sequence::ScrambledHalton ? HaltonPermutation(seed, d) : nullptr;
+                        for (size_t i = b; i < e; ++i)
+                            for (int d = 0; d < D; ++d)
+                                out[i * D + d] = RadicalInverse(first + i, Primes[d], perm[d]);
+                    } });
+            }
+        }
+
+        // 序列 seq 中第 index 个点的第 dim 维分量, 可随机访问, 便于各线程生成不相交的区间;
+        // dims 为总维数 (只有 R2 的各维步长依赖它), seed 只影响置乱序列
+        inline real Sample(Sequence seq, uint64_t index, int dim, int dims = 1, uint32_t seed = 0)
+        {
+            if (dim < 0 || dim >= (seq == Sequence::R2 ? dims : Detail::MaxDims(seq)))
+                throw("Too many dimensions for sequence");
+            switch (seq)
+            {
+            case Sequence::Sobol:
+            case Sequence::OwenSobol:
+            {
+                if (index >= (1ull << 32))
+                    throw("Sobol index out of range");
+                uint32_t x = Detail::SobolBits(static_cast<uint32_t>(index), dim);
+                return Detail::ToUnit(seq == Sequence::OwenSobol ? Detail::OwenScramble(x, Detail::DimensionSeed(seed, dim)) : x);
+            }
+            case Sequence::Halton:
+                return Detail::RadicalInverse(index, Detail::Primes[dim], nullptr);
+            case Sequence::ScrambledHalton:
+                return Detail::RadicalInverse(index, Detail::Primes[dim], Detail::HaltonPermutation(seed, dim));
+            default:
+                return Detail::R2At(index, Detail::R2Step(dim, dims));
+            }
+        }
+
+        // 批量生成第 [first, first + count) 个点
+        inline void Generate(Sequence seq, real *out, size_t count, uint64_t first = 0, uint32_t seed = 0)
+        {
+            Detail::Generate<1>(seq, out, count, first, seed);
+        }
+        inline void Generate(Sequence seq, Vec2 *out, size_t count, uint64_t first = 0, uint32_t seed = 0)
+        {
+            std::vector<real> tmp(count * 2);
+            Detail::Generate<2>(seq, tmp.data(), count, first, seed);
+            for (size_t i = 0; i < count; ++i)
+                out[i] = Vec2(tmp[2 * i], tmp[2 * i + 1]);
+        }
+        inline void Generate(Sequence seq, Vec3 *out, size_t count, uint64_t first = 0, uint32_t seed = 0)
+        {
+            std::vector<real> tmp(count * 3);
+            Detail::Generate<3>(seq, tmp.data(), count, first, seed);
+            for (size_t i = 0; i < count; ++i)
+                out[i] = Vec3(tmp[3 * i], tmp[3 * i + 1], tmp[3 * i + 2]);
+        }
+        namespace Detail
+        {
+            // Poisson 圆盘采样的背景网格: 格子边长不超过 r / sqrt(D), 每格至多一个点, 直接存坐标 (空格为 NaN)
+            template <int D>
+            struct PoissonGrid
+            {
+                using Point = std::array<real, D>;
+                Point origin, extent;
+                real radius, cell[D];
+                int res[D], reach[D]; // 各轴格数与邻域半宽 (格)
+                bool periodic;
+                std::vector<Point> cells;
+                std::vector<ptrdiff_t> offsets;      // 邻域格子的一维下标偏移
+                std::vector<std::array<int, D>> deltas; // 对应的各轴偏移, 用于边界附近
+
+                PoissonGrid(const Point &mn, const Point &mx, real r, bool wrap) : origin(mn), radius(r), periodic(wrap)
+                {
+                    size_t total = 1;
+                    for (int d = 0; d < D; ++d)
+                    {
+                        extent[d] = mx[d] - mn[d];
+                        cell[d] = r / std::sqrt(static_cast<real>(D));
+                        res[d] = std::max(1, static_cast<int>(std::ceil(extent[d] / cell[d])));
+                        // 周期域要求格子整除周期, 使跨边界的格子邻接关系正确; 边长只会变小, 每格仍至多一个点
+                        if (wrap)
+                            cell[d] = extent[d] / res[d];
+                        reach[d] = static_cast<int>(std::ceil(r / cell[d]));
+                        total *= static_cast<size_t>(res[d]);
+                    }
+                    Point empty;
+                    empty.fill(std::numeric_limits<real>::quiet_NaN());
+                    cells.assign(total, empty);
+                    // 各轴 [-reach, reach] 的邻域, 去掉与中心格最近距离已不小于 r 的格子
+                    int n[D];
+                    for (int d = 0; d < D; ++d)
+                        n[d] = -reach[d];
+                    while (true)
+                    {
+                        real gap = 0;
+                        ptrdiff_t flat = 0, stride = 1;
+                        for (int d = 0; d < D; ++d)
+                        {
+                            real g = std::max(0, std::abs(n[d]) - 1) * cell[d];
+                            gap += g * g;
+                            flat += n[d] * stride;
+                            stride *= res[d];
+                        }
+                        if (gap < radius * radius)
+                        {
+                            offsets.push_back(flat);
+                            deltas.push_back(std::array<int, D>());
+                            for (int d = 0; d < D; ++d)
+                                deltas.back()[d] = n[d];
+                        }
+                        int d = 0;
+                        for (; d < D && ++n[d] > reach[d]; ++d)
+                            n[d] = -reach[d];
+                        if (d == D)
+                            break;
+                    }
+                    // 由近及远检查, 被拒的候选点通常在前几格就能判定
+                    std::vector<size_t> order(offsets.size());
+                    for (size_t i = 0; i < order.size(); ++i)
+                        order[i] = i;
+                    auto norm = [&](size_t i)
+                    {
+                        int len = 0;
+                        for (int d = 0; d < D; ++d)
+                            len += deltas[i][d] * deltas[i][d];
+                        return len;
+                    };
+                    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return norm(a) < norm(b); });
+                    std::vector<ptrdiff_t> sortedOffsets;
+                    std::vector<std::array<int, D>> sortedDeltas;
+                    for (size_t i : order)
+                    {
+                        sortedOffsets.push_back(offsets[i]);
+                        sortedDeltas.push_back(deltas[i]);
+                    }
+                    offsets.swap(sortedOffsets);
+                    deltas.swap(sortedDeltas);
+                }
+
+                int CellCoord(const Point &p, int d) const { return std::min(res[d] - 1, std::max(0, static_cast<int>((p[d] - origin[d]) / cell[d]))); }
+                size_t Index(const int *c) const
+                {
+                    size_t idx = 0;
+                    for (int d = D - 1; d >= 0; --d)
+                        idx = idx * res[d] + c[d];
+                    return idx;
+                }
+
+                bool Near(const Point &p, const Point &o) const
+                {
+                    if (o[0] != o[0])
+                        return false;
+                    real dist = 0;
+                    for (int d = 0; d < D; ++d)
+                    {
+                        real delta = std::abs(p[d] - o[d]);
+                        if (periodic)
+                            delta = std::min(delta, extent[d] - delta);
+                        dist += delta * delta;
+                    }
+                    return dist < radius * radius;
+                }
+
+                // p 与已有点的距离均不小于 radius
+                bool Fits(const Point &p) const
+                {
+                    int c[D];
+                    bool interior = !periodic;
+                    for (int d = 0; d < D; ++d)
+                    {
+                        c[d] = CellCoord(p, d);
+                        interior = interior && c[d] >= reach[d] && c[d] + reach[d] < res[d];
+                    }
+                    const Point *center = cells.data() + Index(c);
+                    if (interior)
+                    {
+                        for (ptrdiff_t off : offsets)
+                            if (Near(p, center[off]))
+                                return false;
+                        return true;
+                    }
+                    for (const std::array<int, D> &delta : deltas)
+                    {
+                        int q[D];
+                        bool inside = true;
+                        for (int d = 0; d < D; ++d)
+                        {
+                            q[d] = c[d] + delta[d];
+                            if (periodic)
+                                q[d] = (q[d] % res[d] + res[d]) % res[d];
+                            else if (q[d] < 0 || q[d] >= res[d])
+                                inside = false;
+                        }
+                        if (inside && Near(p, cells[Index(q)]))
+                            return false;
+                    }
+                    return true;
+                }
+
+                void Insert(const Point &p)
+                {
+                    int c[D];
+                    for (int d = 0; d < D; ++d)
+                        c[d] = CellCoord(p, d);
+                    cells[Index(c)] = p;
+                }
+            };
+
+            // 在 [mn, mx) 内做 Bridson 采样 (Bridson, 2007): 从活动点周围 [r, 2r) 的壳层随机取 attempts 个候选,
+            // 均失败则移出活动表; 邻近检查使用整个网格, 因此可与相邻区域已有的点衔接
+            template <int D>
+            inline void Bridson(PoissonGrid<D> &grid, const std::array<real, D> &mn, const std::array<real, D> &mx, MathTools::FastRandom &rng, int attempts, std::vector<std::array<real, D>> &out)
+            {
+                using Point = std::array<real, D>;
+                real r = grid.radius;
+                auto accept = [&](Point &p)
+                {
+                    for (int d = 0; d < D; ++d)
+                    {
+                        if (grid.periodic)
+                            p[d] = p[d] - grid.extent[d] * std::floor((p[d] - grid.origin[d]) / grid.extent[d]);
+                        else if (p[d] < mn[d] || p[d] >= mx[d])
+                            return false;
+                    }
+                    if (!grid.Fits(p))
+                        return false;
+                    grid.Insert(p);
+                    out.push_back(p);
+                    return true;
+                };
+                std::vector<Point> active;
+                for (int k = 0; k < attempts; ++k)
+                {
+                    Point p;
+                    for (int d = 0; d < D; ++d)
+                        p[d] = rng.Range(mn[d], mx[d]);
+                    if (accept(p))
+                        active.push_back(p);
+                }
+                while (!active.empty())
+                {
+                    size_t pick = rng.Index(active.size());
+                    Point base = active[pick];
+                    bool found = false;
+                    for (int k = 0; k < attempts && !found; ++k)
+                    {
+                        // 壳层内按体积均匀取点
+                        Point dir;
+                        real len2;
+                        do
+                        {
+                            len2 = 0;
+                            for (int d = 0; d < D; ++d)
+                            {
+                                dir[d] = rng.Range(-1, 1);
+                                len2 += dir[d] * dir[d];
+                            }
+                        } while (len2 > 1 || len2 < real(1e-4));
+                        real u = 1 + rng.Uniform() * ((1 << D) - 1);
+                        real dist = r * (D == 2 ? std::sqrt(u) : std::cbrt(u));
+                        Point p;
+                        for (int d = 0; d < D; ++d)
+                            p[d] = base[d] + dir[d] / std::sqrt(len2) * dist;
+                        if (accept(p))
+                        {
+                            active.push_back(p);
+                            found = true;
+                        }
+                    }
+                    if (!found)
+                    {
+                        active[pick] = active.back();
+                        active.pop_back();
+                    }
+                }
+            }
+
+            // 分块并行: 块边长不小于 2r, 按坐标奇偶分为 2^D 个相位, 同相位的块互不相邻, 可同时采样而不冲突;
+            // 块大小只取决于半径, 每块用 (seed, 块号) 播种, 结果与线程数无关
+            template <int D>
+            inline std::vector<std::array<real, D>> PoissonTiled(const std::array<real, D> &mn, const std::array<real, D> &mx, real radius, uint64_t seed, int attempts, bool parallel)
+            {
+                using Point = std::array<real, D>;
+                if (!(radius > 0))
+                    throw("Poisson disk radius must be positive");
+                PoissonGrid<D> grid(mn, mx, radius, false);
+                real tile = parallel ? 24 * radius : std::numeric_limits<real>::max();
+                int tiles[D];
+                size_t count = 1;
+                for (int d = 0; d < D; ++d)
+                {
+                    tiles[d] = std::max(1, static_cast<int>(std::ceil((mx[d] - mn[d]) / tile)));
+                    count *= static_cast<size_t>(tiles[d]);
+                }
+                std::vector<std::vector<Point>> perTile(count);
+                for (int phase = 0; phase < (1 << D); ++phase)
+                {
+                    std::vector<size_t> ids;
+                    for (size_t t = 0; t < count; ++t)
+                    {
+                        size_t rest = t;
+                        int parity = 0;
+                        for (int d = 0; d < D; ++d)
+                        {
+                            parity |= static_cast<int>((rest % tiles[d]) & 1) << d;
+                            rest /= tiles[d];
+                        }
+                        if (parity == phase)
+                            ids.push_back(t);
+                    }
+                    Parallel::For(
+                        ids.size(), [&](size_t b, size_t e)
+                        {
+                            for (size_t k = b; k < e; ++k)
+                            {
+                                size_t t = ids[k], rest = t;
+                                Point lo, hi;
+                                for (int d = 0; d < D; ++d)
+                                {
+                                    int c = static_cast<int>(rest % tiles[d]);
+                                    rest /= tiles[d];
+                                    real size = (mx[d] - mn[d]) / tiles[d];
+                                    lo[d] = mn[d] + c * size;
+                                    hi[d] = c + 1 == tiles[d] ? mx[d] : mn[d] + (c + 1) * size;
+                                }
+                                MathTools::FastRandom rng(seed, t);
+                                Bridson<D>(grid, lo, hi, rng, attempts, perTile[t]);
+                            } },
+                        1);
+                }
+                std::vector<Point> out;
+                for (const std::vector<Point> &pts : perTile)
+                    out.insert(out.end(), pts.begin(), pts.end());
+                return out;
+            }
+        }
+
+        // 矩形 [mn, mx) 内最小间距为 radius 的 Poisson 圆盘点集 (蓝噪声);
+        // parallel 时按 24r 边长分块, 相位交替并行生成, 适合上千万点的大区域
+        inline std::vector<Vec2> PoissonDisk(const Vec2 &mn, const Vec2 &mx, real radius, uint64_t seed = 0, bool parallel = true, int attempts = 30)
+        {
+            auto pts = Detail::PoissonTiled<2>({mn.x, mn.y}, {mx.x, mx.y}, radius, seed, attempts, parallel);
+            std::vector<Vec2> out(pts.size());
+            for (size_t i = 0; i < pts.size(); ++i)
+                out[i] = Vec2(pts[i][0], pts[i][1]);
+            return out;
+        }
+        inline std::vector<Vec3> PoissonDisk(const Vec3 &mn, const Vec3 &mx, real radius, uint64_t seed = 0, bool parallel = true, int attempts = 30)
+        {
+            auto pts = Detail::PoissonTiled<3>({mn.x, mn.y, mn.z}, {mx.x, mx.y, mx.z}, radius, seed, attempts, parallel);
+            std::vector<Vec3> out(pts.size());
+            for (size_t i = 0; i < pts.size(); ++i)
+                out[i] = Vec3(pts[i][0], pts[i][1], pts[i][2]);
+            return out;
+        }
+
+        // 预计算的周期蓝噪声块: 单位正方形内按环面距离采样, 平铺时跨块边界同样满足最小间距
+        struct BlueNoiseTile
+        {
+            std::vector<Vec2> points; // [0, 1)^2
+            real radius = 0;
+
+            // radius 为相对块边长的最小间距
+            static BlueNoiseTile Generate(real radius, uint64_t seed = 0, int attempts = 30)
+            {
+                if (!(radius > 0 && radius < 0.5f))
+                    throw("Blue noise tile radius must be in (0, 0.5)");
+                Detail::PoissonGrid<2> grid({0, 0}, {1, 1}, radius, true);
+                MathTools::FastRandom rng(seed);
+                std::vector<std::array<real, 2>> pts;
+                Detail::Bridson<2>(grid, {0, 0}, {1, 1}, rng, attempts, pts);
+                BlueNoiseTile tile;
+                tile.radius = radius;
+                for (const auto &p : pts)
+                    tile.points.push_back(Vec2(p[0], p[1]));
+                return tile;
+            }
+
+            // 以 tileSize 为块边长平铺到 [mn, mx), 最小间距为 radius * tileSize
+            std::vector<Vec2> Fill(const Vec2 &mn, const Vec2 &mx, real tileSize) const
+            {
+                int nx = static_cast<int>(std::ceil((mx.x - mn.x) / tileSize)), ny = static_cast<int>(std::ceil((mx.y - mn.y) / tileSize));
+                std::vector<Vec2> out;
+                out.reserve(static_cast<size_t>(std::max(nx, 0)) * std::max(ny, 0) * points.size());
+                for (int j = 0; j < ny; ++j)
+                    for (int i = 0; i < nx; ++i)
+                        for (const Vec2 &p : points)
+                        {
+                            Vec2 q = mn + (Vec2(static_cast<real>(i), static_cast<real>(j)) + p) * tileSize;
+                            if (q.x < mx.x && q.y < mx.y)
+                                out.push_back(q);
+                        }
+                return out;
+            }
+        };
+    }
+
+    // ====================== 噪声 ======================
+    namespace Noise
+    {
+        enum class Type
+        {
+            Value,   // 格点随机值的 quintic 插值, 范围 [-1, 1]
+            Perlin,  // 改进 Perlin 梯度噪声 (Perlin, 2002), 约 [-1, 1]
+            Simplex  // 单纯形噪声 (Gustavson 形式), 约 [-1, 1]
+        };
+
+        // 分形叠加 (fBm) 与域扭曲参数; warp > 0 时先将采样点按两路 fBm 偏移 warp 倍再求值
+        struct FractalOptions
+        {
+            Type type = Type::Simplex;
+            int octaves = 5;
+            real frequency = 1;
+            real lacunarity = 2;
+            real gain = 0.5f;
+            real warp = 0;
+            uint32_t seed = 0;
+        };
+
+        namespace Detail
+        {
+            constexpr size_t Lanes = 8;
+            constexpr size_t Grain = 1024;
+
+            // 格点哈希与梯度均为无分支整数运算, 不查排列表, 按 Lanes 展开时可向量化
+            inline uint32_t Hash(int x, int y, uint32_t seed)
+            {
+                uint32_t h = seed * 0x9E3779B1u ^ static_cast<uint32_t>(x) * 0x8DA6B343u ^ static_cast<uint32_t>(y) * 0xD8163841u;
+                h ^= h >> 15;
+                h *= 0x2C1B3C6Du;
+                h ^= h >> 12;
+                h *= 0x297A2D39u;
+                return h ^ (h >> 15);
+            }
+            inline uint32_t Hash(int x, int y, int z, uint32_t seed) { return Hash(x, y, seed ^ static_cast<uint32_t>(z) * 0xCB1AB31Fu); }
+
+            inline int Floor(real v)
+            {
+                int i = static_cast<int>(v);
+                return i - (v < static_cast<real>(i));
+            }
+            inline real Fade(real t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+            inline real Lerp(real a, real b, real t) { return a + (b - a) * t; }
+            inline real ToSigned(uint32_t h) { return static_cast<real>(h >> 8) * (real(2) / 16777216) - 1; }
+
+            // 2D 梯度取 (±1, ±1), (±1, 0), (0, ±1) 八个方向
+            inline real Grad(uint32_t h, real x, real y)
+            {
+                real s = (h & 1) ? -x : x, t = (h & 2) ? -y : y;
+                real u = (h & 1) ? -y : y;
+                return (h & 4) ? ((h & 2) ? u : s) : s + t;
+            }
+            // 3D 梯度取立方体 12 条棱的中点方向
+            inline real Grad(uint32_t h, real x, real y, real z)
+            {
+                uint32_t k = h & 15;
+                real u = k < 8 ? x : y;
+                real v = k < 4 ? y : (k == 12 || k == 14 ? x : z);
+                return ((k & 1) ? -u : u) + ((k & 2) ? -v : v);
+            }
+
+            inline real Value(real x, real y, uint32_t seed)
+            {
+                int ix = Floor(x), iy = Floor(y);
+                real u = Fade(x - ix), v = Fade(y - iy);
+                return Lerp(Lerp(ToSigned(Hash(ix, iy, seed)), ToSigned(Hash(ix + 1, iy, seed)), u),
+                            Lerp(ToSigned(Hash(ix, iy + 1, seed)), ToSigned(Hash(ix + 1, iy + 1, seed)), u), v);
+            }
+            inline real Value(real x, real y, real z, uint32_t seed)
+            {
+                int ix = Floor(x), iy = Floor(y), iz = Floor(z);
+                real u = Fade(x - ix), v = Fade(y - iy), w = Fade(z - iz);
+                real c[2];
+                for (int k = 0; k < 2; ++k)
+                    c[k] = Lerp(Lerp(ToSigned(Hash(ix, iy, iz + k, seed)), ToSigned(Hash(ix + 1, iy, iz + k, seed)), u),
+                                Lerp(ToSigned(Hash(ix, iy + 1, iz + k, seed)), ToSigned(Hash(ix + 1, iy + 1, iz + k, seed)), u), v);
+                return Lerp(c[0], c[1], w);
+            }
+
+            inline real Perlin(real x, real y, uint32_t seed)
+            {
+                int ix = Floor(x), iy = Floor(y);
+                real fx = x - ix, fy = y - iy;
+                real u = Fade(fx), v = Fade(fy);
+                real n = Lerp(Lerp(Grad(Hash(ix, iy, seed), fx, fy), Grad(Hash(ix + 1, iy, seed), fx - 1, fy), u),
+                              Lerp(Grad(Hash(ix, iy + 1, seed), fx, fy - 1), Grad(Hash(ix + 1, iy + 1, seed), fx - 1, fy - 1), u), v);
+                return n * real(0.7071067811865476);
+            }
+            inline real Perlin(real x, real y, real z, uint32_t seed)
+            {
+                int ix = Floor(x), iy = Floor(y), iz = Floor(z);
+                real fx = x - ix, fy = y - iy, fz = z - iz;
+                real u = Fade(fx), v = Fade(fy), w = Fade(fz);
+                real c[2];
+                for (int k = 0; k < 2; ++k)
+                    c[k] = Lerp(Lerp(Grad(Hash(ix, iy, iz + k, seed), fx, fy, fz - k), Grad(Hash(ix + 1, iy, iz + k, seed), fx - 1, fy, fz - k), u),
+                                Lerp(Grad(Hash(ix, iy + 1, iz + k, seed), fx, fy - 1, fz - k), Grad(Hash(ix + 1, iy + 1, iz + k, seed), fx - 1, fy - 1, fz - k), u), v);
+                return Lerp(c[0], c[1], w);
+            }
+
+            inline real Simplex(real x, real y, uint32_t seed)
+            {
+                const real F2 = real(0.3660254037844386), G2 = real(0.21132486540518713);
+                real s = (x + y) * F2;
+                int i = Floor(x + s), j = Floor(y + s);
+                real t = (i + j) * G2;
+                real x0 = x - (i - t), y0 = y - (j - t);
+                int i1 = x0 > y0, j1 = 1 - i1;
+                real x1 = x0 - i1 + G2, y1 = y0 - j1 + G2;
+                real x2 = x0 - 1 + 2 * G2, y2 = y0 - 1 + 2 * G2;
+                real t0 = std::max(real(0), real(0.5) - x0 * x0 - y0 * y0);
+                real t1 = std::max(real(0), real(0.5) - x1 * x1 - y1 * y1);
+                real t2 = std::max(real(0), real(0.5) - x2 * x2 - y2 * y2);
+                t0 *= t0;
+                t1 *= t1;
+                t2 *= t2;
+                real n = t0 * t0 * Grad(Hash(i, j, seed), x0, y0) + t1 * t1 * Grad(Hash(i + i1, j + j1, seed), x1, y1) + t2 * t2 * Grad(Hash(i + 1, j + 1, seed), x2, y2);
+                return n * 70;
+            }
+            inline real Simplex(real x, real y, real z, uint32_t seed)
+            {
+                const real F3 = real(1) / 3, G3 = real(1) / 6;
+                real s = (x + y + z) * F3;
+                int i = Floor(x + s), j = Floor(y + s), k = Floor(z + s);
+                real t = (i + j + k) * G3;
+                real x0 = x - (i - t), y0 = y - (j - t), z0 = z - (k - t);
+                // 按坐标大小次序确定单纯形的第二, 第三个顶点 (无分支)
+                int i1 = (x0 >= y0) & (x0 >= z0), j1 = (y0 > x0) & (y0 >= z0), k1 = (z0 > x0) & (z0 > y0);
+                int i2 = (x0 >= y0) | (x0 >= z0), j2 = (y0 > x0) | (y0 >= z0), k2 = (z0 > x0) | (z0 > y0);
+                real p[4][3] = {{x0, y0, z0},
+                                {x0 - i1 + G3, y0 - j1 + G3, z0 - k1 + G3},
+                                {x0 - i2 + 2 * G3, y0 - j2 + 2 * G3, z0 - k2 + 2 * G3},
+                                {x0 - 1 + 3 * G3, y0 - 1 + 3 * G3, z0 - 1 + 3 * G3}};
+                int o[4][3] = {{0, 0, 0}, {i1, j1, k1}, {i2, j2, k2}, {1, 1, 1}};
+                real n = 0;
+                for (int c = 0; c < 4; ++c)
+                {
+                    real w = std::max(real(0), real(0.6) - p[c][0] * p[c][0] - p[c][1] * p[c][1] - p[c][2] * p[c][2]);
+                    w *= w;
+                    n += w * w * Grad(Hash(i + o[c][0], j + o[c][1], k + o[c][2], seed), p[c][0], p[c][1], p[c][2]);
+                }
+                return n * 32;
+            }
+
+            template <int D>
+            inline real Eval(Type type, const real *p, uint32_t seed)
+            {
+                if (D == 2)
+                    return type == Type::Value ? Value(p[0], p[1], seed) : type == Type::Perlin ? Perlin(p[0], p[1], seed) : Simplex(p[0], p[1], seed);
+                return type == Type::Value ? Value(p[0], p[1], p[2], seed) : type == Type::Perlin ? Perlin(p[0], p[1], p[2], seed) : Simplex(p[0], p[1], p[2], seed);
+            }
+
+            // n 个点 (每维一条连续数组) 的单层噪声, 类型分派在 Lanes 循环之外
+            template <int D, class Kernel>
+            inline void Sweep(Kernel kernel, const real *const *p, real scale, uint32_t seed, real amplitude, real *out, size_t n)
+            {
+                auto at = [&](size_t k)
+                {
+                    real q[D];
+                    for (int d = 0; d < D; ++d)
+                        q[d] = p[d][k] * scale;
+                    out[k] += amplitude * kernel(q, seed);
+                };
+                size_t i = 0;
+                for (; i + Detail::Lanes <= n; i += Detail::Lanes)
+                    for (size_t l = 0; l < Detail::Lanes; ++l)
+                        at(i + l);
+                for (; i < n; ++i)
+                    at(i);
+            }
+
+            template <int D>
+            inline void Octave(Type type, const real *const *p, real scale, uint32_t seed, real amplitude, real *out, size_t n)
+            {
+                if (type == Type::Value)
+                    Sweep<D>([](const real *q, uint32_t s) { return D == 2 ? Value(q[0], q[1], s) : Value(q[0], q[1], q[D - 1], s); }, p, scale, seed, amplitude, out, n);
+                else if (type == Type::Perlin)
+                    Sweep<D>([](const real *q, uint32_t s) { return D == 2 ? Perlin(q[0], q[1], s) : Perlin(q[0], q[1], q[D - 1], s); }, p, scale, seed, amplitude, out, n);
+                else
+                    Sweep<D>([](const real *q, uint32_t s) { return D == 2 ? Simplex(q[0], q[1], s) : Simplex(q[0], q[1], q[D - 1], s); }, p, scale, seed, amplitude, out, n);
+            }
+
+            inline real Normalizer(const FractalOptions &opt)
+            {
+                real sum = 0, amp = 1;
+                for (int o = 0; o < opt.octaves; ++o, amp *= opt.gain)
+                    sum += amp;
+                return sum > 0 ? 1 / sum : 0;
+            }
+
+            // 不含域扭曲的 fBm, 结果写入 out
+            template <int D>
+            inline void Fractal(const real *const *p, real *out, size_t n, const FractalOptions &opt)
+            {
+                std::fill(out, out + n, real(0));
+                real freq = opt.frequency, amp = Normalizer(opt);
+                for (int o = 0; o < opt.octaves; ++o, freq *= opt.lacunarity, amp *= opt.gain)
+                    Octave<D>(opt.type, p, freq, opt.seed + static_cast<uint32_t>(o), amp, out, n);
+            }
+
+            // 单点 fBm, 与批量路径使用相同的层种子和扭曲种子
+            template <int D>
+            inline real FractalAt(const real *p, const FractalOptions &opt)
+            {
+                real q[D], sum = 0, freq = opt.frequency, amp = Normalizer(opt);
+                for (int o = 0; o < opt.octaves; ++o, freq *= opt.lacunarity, amp *= opt.gain)
+                {
+                    for (int d = 0; d < D; ++d)
+                        q[d] = p[d] * freq;
+                    sum += amp * Eval<D>(opt.type, q, opt.seed + static_cast<uint32_t>(o));
+                }
+                return sum;
+            }
+            template <int D>
+            inline real FbmAt(const real *p, const FractalOptions &opt)
+            {
+                if (opt.warp == 0)
+                    return FractalAt<D>(p, opt);
+                real q[D];
+                for (int d = 0; d < D; ++d)
+                {
+                    FractalOptions w = opt;
+                    w.warp = 0;
+                    w.seed = opt.seed + 0x68E31DA4u * static_cast<uint32_t>(d + 1);
+                    q[d] = p[d] + opt.warp * FractalAt<D>(p, w);
+                }
+                return FractalAt<D>(q, opt);
+            }
+
+            // 一个分块: 需要时先求扭曲偏移, 再求 fBm
+            template <int D>
+            inline void Block(const real *const *p, real *out, size_t n, const FractalOptions &opt)
+            {
+                if (opt.warp == 0)
+                {
+                    Fractal<D>(p, out, n, opt);
+                    return;
+                }
+                real buf[D][Grain], off[Grain];
+                const real *q[D];
+                for (int d = 0; d < D; ++d)
+                {
+                    FractalOptions w = opt;
+                    w.warp = 0;
+                    w.seed = opt.seed + 0x68E31DA4u * static_cast<uint32_t>(d + 1);
+                    Fractal<D>(p, off, n, w);
+                    for (size_t i = 0; i < n; ++i)
+                        buf[d][i] = p[d][i] + opt.warp * off[i];
+                    q[d] = buf[d];
+                }
+                Fractal<D>(q, out, n, opt);
+            }
+
+            template <int D>
+            inline void Evaluate(const real *const *p, real *out, size_t n, const FractalOptions &opt)
+            {
+                Parallel::For(
+                    n, [&](size_t b, size_t e)
+                    {
+                        for (size_t i = b; i < e; i += Grain)
+                        {
+                            const real *q[D];
+                            for (int d = 0; d < D; ++d)
+                                q[d] = p[d] + i;
+                            Block<D>(q, out + i, std::min(Grain, e - i), opt);
+                        } },
+                    Grain);
+            }
+
+            // 网格上一层 Value / Perlin 噪声的列信息: 与 x 有关的格点下标, 小数部分与插值权重对所有行相同, 每层只算一次
+            struct GridColumns
+            {
+                int first = 0;
+                size_t span = 0; // 覆盖的格点列数 (含右端)
+                std::vector<int> cell;
+                std::vector<real> frac, fade;
+
+                void Build(real x0, real dx, size_t width)
+                {
+                    cell.resize(width);
+                    frac.resize(width);
+                    fade.resize(width);
+                    first = Floor(x0 + std::min(real(0), dx * static_cast<real>(width)));
+                    span = 0;
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        real x = x0 + dx * static_cast<real>(i);
+                        int ix = Floor(x);
+                        cell[i] = ix - first;
+                        span = std::max(span, static_cast<size_t>(cell[i]) + 2);
+                        frac[i] = x - ix;
+                        fade[i] = Fade(frac[i]);
+                    }
+                }
+            };
+
+            // 一行: 先对本行覆盖到的格点列各求一次上下两角的哈希, 再逐像素无分支插值
+            inline void Row(Type type, const GridColumns &cols, real y, uint32_t seed, real amplitude, real *out, std::vector<uint32_t> &lo, std::vector<uint32_t> &hi)
+            {
+                size_t width = cols.cell.size();
+                int iy = Floor(y);
+                real fy = y - iy, v = Fade(fy);
+                lo.resize(cols.span);
+                hi.resize(cols.span);
+                for (size_t k = 0; k < cols.span; ++k)
+                {
+                    lo[k] = Hash(cols.first + static_cast<int>(k), iy, seed);
+                    hi[k] = Hash(cols.first + static_cast<int>(k), iy + 1, seed);
+                }
+                if (type == Type::Value)
+                {
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        int k = cols.cell[i];
+                        real u = cols.fade[i];
+                        out[i] += amplitude * Lerp(Lerp(ToSigned(lo[k]), ToSigned(lo[k + 1]), u), Lerp(ToSigned(hi[k]), ToSigned(hi[k + 1]), u), v);
+                    }
+                    return;
+                }
+                for (size_t i = 0; i < width; ++i)
+                {
+                    int k = cols.cell[i];
+                    real fx = cols.frac[i], u = cols.fade[i];
+                    real n = Lerp(Lerp(Grad(lo[k], fx, fy), Grad(lo[k + 1], fx - 1, fy), u), Lerp(Grad(hi[k], fx, fy - 1), Grad(hi[k + 1], fx - 1, fy - 1), u), v);
+                    out[i] += amplitude * n * real(0.7071067811865476);
+                }
+            }
+        }
+
+        // 单点求值
+        inline real Evaluate(Type type, const Vec2 &p, uint32_t seed = 0)
+        {
+            real q[2] = {p.x, p.y};
+            return Detail::Eval<2>(type, q, seed);
+        }
+        inline real Evaluate(Type type, const Vec3 &p, uint32_t seed = 0)
+        {
+            real q[3] = {p.x, p.y, p.z};
+            return Detail::Eval<3>(type, q, seed);
+        }
+        inline real Value(const Vec2 &p, uint32_t seed = 0) { return Detail::Value(p.x, p.y, seed); }
+        inline real Value(const Vec3 &p, uint32_t seed = 0) { return Detail::Value(p.x, p.y, p.z, seed); }
+        inline real Perlin(const Vec2 &p, uint32_t seed = 0) { return Detail::Perlin(p.x, p.y, seed); }
+        inline real Perlin(const Vec3 &p, uint32_t seed = 0) { return Detail::Perlin(p.x, p.y, p.z, seed); }
+        inline real Simplex(const Vec2 &p, uint32_t seed = 0) { return Detail::Simplex(p.x, p.y, seed); }
+        inline real Simplex(const Vec3 &p, uint32_t seed = 0) { return Detail::Simplex(p.x, p.y, p.z, seed); }
+
+        // fBm, 各层振幅之和归一化为 1; 含 opt.warp 指定的域扭曲
+        inline real Fbm(const Vec2 &p, const FractalOptions &opt = FractalOptions())
+        {
+            real q[2] = {p.x, p.y};
+            return Detail::FbmAt<2>(q, opt);
+        }
+        inline real Fbm(const Vec3 &p, const FractalOptions &opt = FractalOptions())
+        {
+            real q[3] = {p.x, p.y, p.z};
+            return Detail::FbmAt<3>(q, opt);
+        }
+
+        // 域扭曲: p + strength * (fBm_1(p), fBm_2(p), ...), 各分量使用不同种子
+        inline Vec2 Warp(const Vec2 &p, real strength, const FractalOptions &opt = FractalOptions())
+        {
+            FractalOptions a = opt, b = opt;
+            a.warp = b.warp = 0;
+            a.seed = opt.seed + 0x68E31DA4u;
+            b.seed = opt.seed + 0x68E31DA4u * 2;
+            return p + Vec2(Fbm(p, a), Fbm(p, b)) * strength;
+        }
+        inline Vec3 Warp(const Vec3 &p, real strength, const FractalOptions &opt = FractalOptions())
+        {
+            FractalOptions a = opt, b = opt, c = opt;
+            a.warp = b.warp = c.warp = 0;
+            a.seed = opt.seed + 0x68E31DA4u;
+            b.seed = opt.seed + 0x68E31DA4u * 2;
+            c.seed = opt.seed + 0x68E31DA4u * 3;
+            return p + Vec3(Fbm(p, a), Fbm(p, b), Fbm(p, c)) * strength;
+        }
+
+        // 批量 fBm: 坐标为 SoA 数组 (xs, ys[, zs]), 按 Lanes 分组求值并并行分块
+        inline void Evaluate(const real *xs, const real *ys, real *out, size_t count, const FractalOptions &opt = FractalOptions())
+        {
+            const real *p[2] = {xs, ys};
+            Detail::Evaluate<2>(p, out, count, opt);
+        }
+        inline void Evaluate(const real *xs, const real *ys, const real *zs, real *out, size_t count, const FractalOptions &opt = FractalOptions())
+        {
+            const real *p[3] = {xs, ys, zs};
+            Detail::Evaluate<3>(p, out, count, opt);
+        }
+
+        // 批量 fBm: AoS 点数组, 分块转置为 SoA 后求值
+        inline void Evaluate(const Vec2 *points, real *out, size_t count, const FractalOptions &opt = FractalOptions())
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    real c[2][Detail::Grain];
+                    const real *p[2] = {c[0], c[1]};
+                    for (size_t i = b; i < e; i += Detail::Grain)
+                    {
+                        size_t n = std::min(Detail::Grain, e - i);
+                        for (size_t k = 0; k < n; ++k)
+                        {
+                            c[0][k] = points[i + k].x;
+                            c[1][k] = points[i + k].y;
+                        }
+                        Detail::Block<2>(p, out + i, n, opt);
+                    } },
+                Detail::Grain);
+        }
+        inline void Evaluate(const Vec3 *points, real *out, size_t count, const FractalOptions &opt = FractalOptions())
+        {
+            Parallel::For(
+                count, [&](size_t b, size_t e)
+                {
+                    real c[3][Detail::Grain];
+                    const real *p[3] = {c[0], c[1], c[2]};
+                    for (size_t i = b; i < e; i += Detail::Grain)
+                    {
+                        size_t n = std::min(Detail::Grain, e - i);
+                        for (size_t k = 0; k < n; ++k)
+                        {
+                            c[0][k] = points[i + k].x;
+                            c[1][k] = points[i + k].y;
+                            c[2][k] = points[i + k].z;
+                        }
+                        Detail::Block<3>(p, out + i, n, opt);
+                    } },
+                Detail::Grain);
+        }
+
+        // 规则网格上的 fBm: out[j * width + i] = Fbm(origin + (i * step.x, j * step.y));
+        // Value / Perlin 每层的列信息整块共用, 每行只对格点列求哈希; Simplex 与域扭曲按行走批量路径; 行间并行
+        inline void EvaluateGrid(const Vec2 &origin, const Vec2 &step, size_t width, size_t height, real *out, const FractalOptions &opt = FractalOptions())
+        {
+            real norm = Detail::Normalizer(opt);
+            bool lattice = opt.warp == 0 && opt.type != Type::Simplex;
+            Parallel::For(
+                height, [&](size_t b, size_t e)
+                {
+                    if (lattice)
+                    {
+                        std::fill(out + b * width, out + e * width, real(0));
+                        Detail::GridColumns cols;
+                        std::vector<uint32_t> lo, hi;
+                        real freq = opt.frequency, amp = norm;
+                        for (int o = 0; o < opt.octaves; ++o, freq *= opt.lacunarity, amp *= opt.gain)
+                        {
+                            cols.Build(origin.x * freq, step.x * freq, width);
+                            for (size_t j = b; j < e; ++j)
+                                Detail::Row(opt.type, cols, (origin.y + step.y * static_cast<real>(j)) * freq, opt.seed + static_cast<uint32_t>(o), amp, out + j * width, lo, hi);
+                        }
+                        return;
+                    }
+                    std::vector<real> xs(width), ys(width);
+                    for (size_t i = 0; i < width; ++i)
+                        xs[i] = origin.x + step.x * static_cast<real>(i);
+                    for (size_t j = b; j < e; ++j)
+                    {
+                        std::fill(ys.begin(), ys.end(), origin.y + step.y * static_cast<real>(j));
+                        for (size_t i = 0; i < width; i += Detail::Grain)
+                        {
+                            const real *q[2] = {xs.data() + i, ys.data() + i};
+                            Detail::Block<2>(q, out + j * width + i, std::min(Detail::Grain, width - i), opt);
+                        }
+                    } },
+                std::max<size_t>(1, 16384 / std::max<size_t>(width, 1)));
         }
     }
 
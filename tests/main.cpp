@@ -2,6 +2,9 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <vector>
+#include <cstdio>
+#include <array>
 #include "OxygenMathLite.h"
 
 using namespace OxygenMathLite;
@@ -63,6 +66,50 @@ int main()
     std::cout << "A*I = \n"
               << C << "\n";
 
+    // ---------- Rot2 测试 ----------
+    {
+        Rot2 r(Constants::DEG_TO_RAD * 30.0f), q(Constants::DEG_TO_RAD * 60.0f);
+        Vec2 a = (r * q).Rotate(Vec2(1, 0));
+        assert(std::fabs(a.x) < 1e-5f && std::fabs(a.y - 1) < 1e-5f);
+        Vec2 p(3, -2);
+        Vec2 b = r.Rotate(p), c = Mat2::Rotation(Constants::DEG_TO_RAD * 30.0f) * p, d = p.rotate(Constants::DEG_TO_RAD * 30.0f);
+        assert((b - c).length() < 1e-5f && (b - d).length() < 1e-5f);
+        assert((r.InvRotate(b) - p).length() < 1e-5f && ((r.Inv() * r).Rotate(p) - p).length() < 1e-5f);
+        assert(std::fabs(q.Angle() - Constants::DEG_TO_RAD * 60.0f) < 1e-5f);
+        Mat2 m = r.ToMat2();
+        assert(std::fabs(m.m01 + r.s) < 1e-7f && std::fabs(m.Det() - 1) < 1e-5f);
+
+        // 反复复合后快速归一化保持单位长度
+        Rot2 step(0.001f), acc;
+        for (int i = 0; i < 10000; ++i)
+            acc = (acc * step).Renormalize();
+        assert(std::fabs(acc.c * acc.c + acc.s * acc.s - 1) < 1e-5f);
+        assert(std::fabs(acc.Angle() - std::remainder(10.0f, 2 * Constants::PI)) < 1e-2f);
+        Rot2 w;
+        for (int i = 0; i < 1000; ++i)
+            w = w.Integrate(0.001f);
+        assert(std::fabs(w.Angle() - 1.0f) < 1e-3f && std::fabs(w.c * w.c + w.s * w.s - 1) < 1e-5f);
+
+        Rot2 between = Rot2::Between(Vec2(2, 0), Vec2(0, -5));
+        assert(std::fabs(between.Angle() + Constants::PI / 2) < 1e-5f);
+        Rot2 half = Rot2::Identity().Slerp(Rot2(3.0f), 0.5f);
+        assert(std::fabs(half.Angle() - 1.5f) < 1e-5f);
+        assert(std::fabs(Rot2(3.0f).Slerp(Rot2(-3.0f), 0.5f).c + 1) < 1e-5f);
+
+        std::vector<Vec2> pts = {{1, 0}, {0, 1}, {2, 3}}, out(3);
+        r.Rotate(pts.data(), out.data(), pts.size());
+        r.InvRotate(out.data(), out.data(), out.size());
+        std::vector<Rot2> rots = {r, q, Rot2::Identity()};
+        std::vector<Vec2> offs = {{1, 1}, {0, 0}, {-1, 2}}, moved(3);
+        Rot2::Transform(rots.data(), offs.data(), pts.data(), moved.data(), pts.size());
+        for (size_t i = 0; i < pts.size(); ++i)
+        {
+            assert((out[i] - pts[i]).length() < 1e-5f);
+            assert((moved[i] - (rots[i] * pts[i] + offs[i])).length() < 1e-6f);
+        }
+        std::cout << "Rot2(30deg) = " << r << "\n";
+    }
+
     // ---------- Mat3 测试 ----------
     Mat3 M = Mat3::Identity();
     Vec3 vv(1, 2, 3);
@@ -139,6 +186,1599 @@ int main()
     Integration2D::RK2(pos, vel, acc, 0.1f);
     std::cout << "After RK2 step pos=" << pos << ", vel=" << vel << "\n";
 
+    // ---------- Statistics 测试 ----------
+    {
+        std::vector<Vec3> cloud;
+        for (int i = 0; i < 100000; ++i)
+        {
+            real t = static_cast<real>(i % 1000) / 1000.0f - 0.5f;
+            real s = static_cast<real>(i / 1000) / 100.0f - 0.5f;
+            cloud.push_back(Vec3(1000.0f, 2000.0f, 3000.0f) + Vec3(1, 1, 0).normalize() * (4 * t) + Vec3(0, 0, 1) * s);
+        }
+        Statistics::Moments3 m = Statistics::ComputeMoments(cloud.data(), cloud.size());
+        std::cout << "cloud mean = " << m.mean << "\n";
+        assert(m.count == cloud.size());
+        assert(std::fabs(m.mean.x - 1000.0f) < 1e-2f && std::fabs(m.mean.z - 3000.0f) < 1e-2f);
+
+        // 分块流式累积与一次性结果一致
+        Statistics::Moments3 streamed;
+        for (size_t b = 0; b < cloud.size(); b += 7777)
+            streamed.Add(cloud.data() + b, std::min<size_t>(7777, cloud.size() - b));
+        Mat3 c1 = m.Covariance(), c2 = streamed.Covariance();
+        assert(std::fabs(c1.m00 - c2.m00) < 1e-3f && std::fabs(c1.m22 - c2.m22) < 1e-3f);
+
+        Statistics::PrincipalAxes3 pca = Statistics::PCA(m);
+        std::cout << "PCA variances = " << pca.variances << ", axis0 = " << pca.axes[0] << "\n";
+        assert(std::fabs(std::fabs(pca.axes[0].dot(Vec3(1, 1, 0).normalize())) - 1.0f) < 1e-3f);
+        assert(pca.variances.x >= pca.variances.y && pca.variances.y >= pca.variances.z);
+
+        Vec2 pts2[4] = {Vec2(-2, 0), Vec2(2, 0), Vec2(0, -1), Vec2(0, 1)};
+        Mat2 cov2 = Statistics::Covariance(pts2, 4);
+        assert(std::fabs(cov2.m00 - 2.0f) < 1e-4f && std::fabs(cov2.m11 - 0.5f) < 1e-4f);
+        Statistics::PrincipalAxes2 pca2 = Statistics::PCA(pts2, 4);
+        assert(std::fabs(std::fabs(pca2.axes[0].x) - 1.0f) < 1e-4f);
+
+        Mat3 S(4, 1, 2, 1, 3, 0, 2, 0, 5);
+        Vec3 ev;
+        Mat3 V;
+        S.EigenSymmetric(ev, V);
+        for (int i = 0; i < 3; ++i)
+        {
+            Vec3 r = S * V.Column(i) - V.Column(i) * (i == 0 ? ev.x : (i == 1 ? ev.y : ev.z));
+            assert(r.length() < 1e-3f);
+        }
+
+        // 块长固定为 grain: 浮点和与按块串行累加的结果逐位相同, 与线程数无关
+        std::vector<real> xs(100003);
+        for (size_t i = 0; i < xs.size(); ++i)
+            xs[i] = std::sin(static_cast<real>(i)) * 1000;
+        real total = Parallel::Reduce(
+            xs.size(), real(0), [&](size_t b, size_t e)
+            {
+                real sum = 0;
+                for (size_t i = b; i < e; ++i)
+                    sum += xs[i];
+                return sum; },
+            [](real a, real b)
+            { return a + b; },
+            1000);
+        real expect = 0;
+        for (size_t b = 0; b < xs.size(); b += 1000)
+        {
+            real sum = 0;
+            for (size_t i = b; i < std::min(xs.size(), b + 1000); ++i)
+                sum += xs[i];
+            expect = expect + sum;
+        }
+        assert(total == expect);
+    }
+
+    // ---------- KDTree3 / ICP 测试 ----------
+    {
+        std::vector<Vec3> target;
+        for (int i = 0; i < 60; ++i)
+            for (int j = 0; j < 60; ++j)
+            {
+                real x = i * 0.05f, y = j * 0.05f;
+                target.push_back(Vec3(x, y, 0.6f * std::sin(3 * x) * std::cos(2 * y)));
+            }
+        Spatial::KDTree3 tree(target.data(), target.size());
+        real d2 = 0;
+        size_t nearest = tree.Nearest(Vec3(1.01f, 1.49f, 5), &d2);
+        size_t brute = 0;
+        for (size_t i = 1; i < target.size(); ++i)
+            if ((target[i] - Vec3(1.01f, 1.49f, 5)).lengthSquared() < (target[brute] - Vec3(1.01f, 1.49f, 5)).lengthSquared())
+                brute = i;
+        assert(nearest == brute);
+        size_t knn[5];
+        assert(tree.KNearest(target[100], 5, knn) == 5 && knn[0] == 100);
+
+        Registration::RigidTransform truth{Mat3::Rotation(Vec3(0.2f, 0.3f, 1).normalize(), 0.1f), Vec3(0.05f, -0.04f, 0.03f)};
+        Registration::RigidTransform inv = truth.Inverse();
+        std::vector<Vec3> source;
+        for (const Vec3 &p : target)
+            source.push_back(inv.Apply(p));
+
+        Registration::RigidTransform kabsch = Registration::AlignPoints(source.data(), target.data(), source.size());
+        assert((kabsch.translation - truth.translation).length() < 1e-3f);
+
+        Registration::ICP icp(target.data(), target.size());
+        Registration::ICPOptions opt;
+        opt.sampleStride = 2;
+        Registration::ICPResult r1 = icp.Align(source.data(), source.size(), opt);
+        std::cout << "ICP point-to-point: iterations = " << r1.iterations << ", rmse = " << r1.rmse << "\n";
+        Vec3 probe(1, 1, 0);
+        assert(r1.converged && r1.rmse < 1e-3f);
+        assert((r1.transform.Apply(probe) - truth.Apply(probe)).length() < 1e-3f);
+
+        icp.EstimateTargetNormals();
+        opt.pointToPlane = true;
+        Registration::ICPResult r2 = icp.Align(source.data(), source.size(), opt);
+        std::cout << "ICP point-to-plane: iterations = " << r2.iterations << ", rmse = " << r2.rmse << "\n";
+        assert(r2.converged && r2.rmse < 1e-3f);
+        assert((r2.transform.Apply(probe) - truth.Apply(probe)).length() < 1e-3f);
+    }
+
+    // ---------- Fitting 测试 ----------
+    {
+        std::vector<Vec2> linePts, circlePts;
+        for (int i = 0; i < 200; ++i)
+        {
+            real t = i * 0.05f;
+            linePts.push_back(Vec2(t, 2 * t + 1));
+            real a = t * 0.7f;
+            circlePts.push_back(Vec2(3 + 2 * std::cos(a), -1 + 2 * std::sin(a)));
+        }
+        Geometry2D::Line line = Fitting::FitLine(linePts.data(), linePts.size());
+        assert(std::fabs(std::fabs(line.direction.dot(Vec2(1, 2).normalize())) - 1) < 1e-4f);
+        assert(line.Distance(Vec2(0, 1)) < 1e-3f);
+
+        Geometry2D::Circle circle = Fitting::FitCircle(circlePts.data(), circlePts.size());
+        std::cout << "fitted circle center = " << circle.center << ", radius = " << circle.radius << "\n";
+        assert((circle.center - Vec2(3, -1)).length() < 1e-3f && std::fabs(circle.radius - 2) < 1e-3f);
+
+        std::vector<Vec3> planePts;
+        for (int i = 0; i < 20; ++i)
+            for (int j = 0; j < 20; ++j)
+                planePts.push_back(Vec3(i * 0.1f, j * 0.1f, 0.5f * i * 0.1f - 0.25f * j * 0.1f + 2));
+        Geometry3D::Plane plane = Fitting::FitPlane(planePts.data(), planePts.size());
+        assert(std::fabs(plane.SignedDistance(Vec3(1, 1, 2.25f))) < 1e-4f);
+
+        real xs[50], ys[50], coeffs[3];
+        for (int i = 0; i < 50; ++i)
+        {
+            xs[i] = 10 + i * 0.1f;
+            ys[i] = 1 - 2 * xs[i] + 0.5f * xs[i] * xs[i];
+        }
+        assert(Fitting::FitPolynomial(xs, ys, 50, 2, coeffs));
+        std::cout << "polynomial coeffs = " << coeffs[0] << ", " << coeffs[1] << ", " << coeffs[2] << "\n";
+        assert(std::fabs(Fitting::EvaluatePolynomial(coeffs, 2, 12) - (1 - 24 + 72)) < 1e-2f);
+
+        size_t offsets[3] = {0, 100, 200};
+        Geometry2D::Line lines[2];
+        Fitting::FitLines(linePts.data(), offsets, 2, lines);
+        assert(lines[1].Distance(Vec2(0, 1)) < 1e-3f);
+
+        // 30% 离群点
+        std::vector<Vec2> noisy = linePts;
+        MathTools::FastRandom rng(42);
+        for (int i = 0; i < 60; ++i)
+            noisy[rng.Index(noisy.size())] = Vec2(rng.Range(0, 10), rng.Range(0, 20));
+        Fitting::RansacOptions ropt;
+        ropt.inlierThreshold = 0.05f;
+        auto rl = Fitting::RansacLine(noisy.data(), noisy.size(), ropt);
+        std::cout << "RANSAC line inliers = " << rl.inliers << ", iterations = " << rl.iterations << "\n";
+        assert(rl.found && rl.model.Distance(Vec2(5, 11)) < 1e-2f);
+        auto rc = Fitting::RansacCircle(circlePts.data(), circlePts.size(), ropt);
+        assert(rc.found && std::fabs(rc.model.radius - 2) < 1e-2f);
+        auto rp = Fitting::RansacPlane(planePts.data(), planePts.size(), ropt);
+        assert(rp.found && rp.inliers == planePts.size());
+
+        // 微米尺度: 退化样本判断与坐标量级无关
+        const real um = 1e-4f;
+        std::vector<Vec2> tinyLine;
+        std::vector<Vec3> tinyPlane;
+        for (const Vec2 &p : noisy)
+            tinyLine.push_back(p * um);
+        for (const Vec3 &p : planePts)
+            tinyPlane.push_back(p * um);
+        Fitting::RansacOptions tiny = ropt;
+        tiny.inlierThreshold = ropt.inlierThreshold * um;
+        auto tl = Fitting::RansacLine(tinyLine.data(), tinyLine.size(), tiny);
+        assert(tl.found && tl.inliers >= 140 && tl.model.Distance(Vec2(5, 11) * um) < 1e-2f * um);
+        auto tp = Fitting::RansacPlane(tinyPlane.data(), tinyPlane.size(), tiny);
+        assert(tp.found && tp.inliers == tinyPlane.size());
+
+        real guard[4] = {7, 7, 7, 7};
+        assert(!Fitting::FitPolynomial(xs, ys, 50, -2, guard + 2) && guard[0] == 7 && guard[1] == 7);
+        assert(Fitting::FitPolynomials(xs, ys, offsets, 2, -2, guard) == 2 && guard[0] == 7);
+    }
+
+    // ---------- QueryBatch 测试 ----------
+    {
+        Geometry2D::QueryBatch batch;
+        std::vector<real> dists(500), lineDists(500);
+        std::vector<Vec2> closest(500);
+        real segDist = -1;
+        for (int i = 0; i < 500; ++i)
+        {
+            Vec2 q(static_cast<real>(i % 37), static_cast<real>(i % 11) - 5);
+            batch.Distance(q, Vec2(1, 1), &dists[i]);
+            batch.ClosestPointOnLineSegment(Vec2(0, 0), Vec2(10, 0), q, &closest[i]);
+            batch.DistancePointToLine(Vec2(0, 0), Vec2(10, 0), q, &lineDists[i]);
+        }
+        batch.DistanceLineToLine(p1, p2, q1, q2, &segDist);
+        assert(batch.Size() == 1501);
+        batch.Flush();
+        assert(batch.Size() == 0);
+        for (int i = 0; i < 500; ++i)
+        {
+            Vec2 q(static_cast<real>(i % 37), static_cast<real>(i % 11) - 5);
+            assert(std::fabs(dists[i] - Geometry2D::Distance(q, Vec2(1, 1))) < 1e-4f);
+            assert((closest[i] - Geometry2D::ClosestPointOnLineSegment(Vec2(0, 0), Vec2(10, 0), q)).length() < 1e-4f);
+            assert(std::fabs(lineDists[i] - Geometry2D::DistancePointToLine(Vec2(0, 0), Vec2(10, 0), q)) < 1e-4f);
+        }
+        assert(std::fabs(segDist - 1.0f) < 1e-3f);
+    }
+
+    // ---------- ConvexHull / Async 测试 ----------
+    {
+        std::vector<Vec2> cloud;
+        MathTools::FastRandom rng(7);
+        for (int i = 0; i < 200000; ++i)
+            cloud.push_back(Vec2(rng.Range(-1, 1), rng.Range(-1, 1)));
+        cloud.push_back(Vec2(-2, -2));
+        cloud.push_back(Vec2(2, -2));
+        cloud.push_back(Vec2(2, 2));
+        cloud.push_back(Vec2(-2, 2));
+        std::vector<Vec2> hull = Geometry2D::ConvexHull(cloud.data(), cloud.size());
+        assert(hull.size() == 4 && hull[0].x == -2 && hull[0].y == -2 && hull[1].x == 2 && hull[1].y == -2);
+
+        auto hullTask = Geometry2D::ConvexHullAsync(cloud);
+        std::vector<Vec2> segsA = {Vec2(0, 0), Vec2(2, 0), Vec2(0, 0), Vec2(2, 2)};
+        std::vector<Vec2> segsB = {Vec2(0, 1), Vec2(2, 1), Vec2(0, 2), Vec2(2, 0), Vec2(5, 0), Vec2(6, 0)};
+        std::vector<real> matrix(2 * 3);
+        std::atomic<size_t> rowsSeen(0);
+        auto matrixTask = Geometry2D::SegmentDistanceMatrixAsync(segsA.data(), 2, segsB.data(), 3, matrix.data(),
+                                                                 [&](size_t b, size_t e)
+                                                                 { rowsSeen += e - b; },
+                                                                 1);
+        assert(matrixTask.Get() == 2 && rowsSeen == 2 && matrixTask.Progress() == 1);
+        for (int i = 0; i < 2; ++i)
+            for (int j = 0; j < 3; ++j)
+                assert(matrix[i * 3 + j] == Geometry2D::DistanceLineToLine(segsA[2 * i], segsA[2 * i + 1], segsB[2 * j], segsB[2 * j + 1]));
+        assert(hullTask.Get().size() == 4);
+
+        auto chained = Async::Run([](Async::JobContext &)
+                                  { return 20; })
+                           .Then([](int &v, Async::JobContext &)
+                                 { return v + 1.5; });
+        assert(chained.Get() == 21.5);
+
+        auto endless = Async::Run([](Async::JobContext &ctx)
+                                  {
+                                      while (!ctx.IsCancelled())
+                                          std::this_thread::yield();
+                                      return 0; });
+        endless.Cancel();
+        bool cancelled = false;
+        try
+        {
+            endless.Get();
+        }
+        catch (const char *)
+        {
+            cancelled = true;
+        }
+        assert(cancelled);
+
+        // 等待中的线程不代为执行无关的长任务: 两个长任务排队时, 并行循环与短任务的等待都不被拖住
+        using Clock = std::chrono::steady_clock;
+        auto sleeper = [](Async::JobContext &)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            return 1;
+        };
+        auto slow1 = Async::Run(sleeper), slow2 = Async::Run(sleeper);
+        std::vector<real> values(100000, 1);
+        auto start = Clock::now();
+        Parallel::For(values.size(), [&](size_t b, size_t e)
+                      {
+                          for (size_t i = b; i < e; ++i)
+                              values[i] *= 2; });
+        auto quick = Async::Run([](Async::JobContext &)
+                                { return 7; });
+        assert(quick.Get() == 7);
+        assert(Clock::now() - start < std::chrono::milliseconds(150));
+        assert(values[0] == 2 && values.back() == 2);
+        // 任务内等待另一个尚未开始的任务: 直接在当前线程执行它, 单工作线程也不会死锁
+        auto outer = Async::Run([](Async::JobContext &)
+                                {
+                                    auto inner = Async::Run([](Async::JobContext &)
+                                                            { return 5; });
+                                    return inner.Get() + 1; });
+        assert(outer.Get() == 6);
+        assert(slow1.Get() + slow2.Get() == 2);
+        // await_resume 返回副本, 之后 Get 仍得到原值
+        auto vec = Async::Run([](Async::JobContext &)
+                              { return std::vector<int>{1, 2, 3}; });
+        vec.Wait();
+        assert(vec.await_resume().size() == 3 && vec.Get().size() == 3);
+    }
+
+    // ---------- Streaming 测试 ----------
+    {
+        const char *inPath = "oxy_stream_in.bin";
+        const char *outPath = "oxy_stream_out.bin";
+        std::vector<Vec3> pts;
+        for (int i = 0; i < 10000; ++i)
+            pts.push_back(Vec3(static_cast<real>(i % 100), static_cast<real>(i / 100), 1.0f));
+        std::FILE *f = std::fopen(inPath, "wb");
+        std::fwrite(pts.data(), sizeof(Vec3), pts.size(), f);
+        std::fclose(f);
+
+        const size_t budget = 4096; // 强制分成多块
+        Geometry3D::AABB box = Streaming::Bounds(inPath, budget);
+        assert(box.min.x == 0 && box.max.x == 99 && box.max.y == 99 && box.min.z == 1);
+        Vec3 centroid = Streaming::Centroid(inPath, budget);
+        assert(std::fabs(centroid.x - 49.5f) < 1e-3f && std::fabs(centroid.y - 49.5f) < 1e-3f);
+
+        assert(Streaming::Transform(inPath, outPath, Mat3::Identity() * 2, Vec3(0, 0, 1), budget) == pts.size());
+        assert(std::fabs(Streaming::Bounds(outPath, budget).max.z - 3) < 1e-5f);
+        assert(Streaming::Filter(inPath, outPath, [](const Vec3 &p)
+                                 { return p.x < 10; }, budget) == 1000);
+        size_t seen = Streaming::ForEachChunk(outPath, 64, [](const Vec3 *p, size_t n, size_t)
+                                              {
+            for (size_t i = 0; i < n; ++i)
+                assert(p[i].x < 10); });
+        assert(seen == 1000);
+        assert(Streaming::Quantize(inPath, outPath, Vec3(0, 0, 0), 0.5f, budget) == pts.size());
+        Streaming::QuantizedPoint q[2];
+        f = std::fopen(outPath, "rb");
+        assert(std::fread(q, sizeof(q[0]), 2, f) == 2);
+        std::fclose(f);
+        assert(q[1].x == 2 && q[1].y == 0 && q[1].z == 2);
+        // 超出 int32 的格点与非有限坐标抛出异常
+        for (real bad : {real(1e10f), std::numeric_limits<real>::quiet_NaN()})
+        {
+            pts[5000].y = bad;
+            f = std::fopen(inPath, "wb");
+            std::fwrite(pts.data(), sizeof(Vec3), pts.size(), f);
+            std::fclose(f);
+            bool threw = false;
+            try
+            {
+                Streaming::Quantize(inPath, outPath, Vec3(0, 0, 0), 0.5f, budget);
+            }
+            catch (const char *)
+            {
+                threw = true;
+            }
+            assert(threw);
+        }
+        std::remove(inPath);
+        std::remove(outPath);
+    }
+
+    // ---------- Frustum / Culling 测试 ----------
+    {
+        Geometry3D::Frustum frustum = Geometry3D::Frustum::FromPerspective(Vec3(0, 0, 0), Vec3(0, 0, 1), Vec3(0, 1, 0),
+                                                                           Constants::HALF_PI, 1.0f, 0.1f, 100.0f);
+        assert(frustum.Contains(Vec3(0, 0, 10)) && !frustum.Contains(Vec3(0, 0, -1)) && !frustum.Contains(Vec3(20, 0, 10)));
+
+        Culling::SphereSet spheres;
+        Culling::AABBSet boxSet;
+        std::vector<Geometry3D::AABB> boxes;
+        MathTools::FastRandom rng(3);
+        for (int i = 0; i < 50000; ++i)
+        {
+            Vec3 c(rng.Range(-200, 200), rng.Range(-200, 200), rng.Range(-200, 200));
+            real r = rng.Range(0.1f, 2);
+            spheres.Add({c, r});
+            Geometry3D::AABB box;
+            box.Expand(c - Vec3(r, r, r));
+            box.Expand(c + Vec3(r, r, r));
+            boxSet.Add(box);
+            boxes.push_back(box);
+        }
+        std::vector<uint32_t> visible(spheres.Size());
+        size_t count = Culling::CullSpheres(frustum, spheres, visible.data());
+        size_t expected = 0;
+        for (size_t i = 0; i < spheres.Size(); ++i)
+            if (frustum.Intersects(Geometry3D::Sphere{Vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]}))
+            {
+                assert(visible[expected] == i);
+                ++expected;
+            }
+        std::cout << "visible spheres = " << count << " / " << spheres.Size() << "\n";
+        assert(count == expected && count > 0);
+
+        count = Culling::CullAABBs(frustum, boxSet, visible.data());
+        expected = 0;
+        for (const auto &box : boxes)
+            expected += frustum.Intersects(box);
+        assert(count == expected);
+
+        Culling::BVH bvh(boxes.data(), boxes.size());
+        std::vector<uint32_t> bvhVisible;
+        bvh.Cull(frustum, bvhVisible);
+        std::sort(bvhVisible.begin(), bvhVisible.end());
+        assert(bvhVisible.size() == count && std::equal(bvhVisible.begin(), bvhVisible.end(), visible.begin()));
+    }
+
+    // ---------- Mesh 简化测试 ----------
+    {
+        auto height = [](real x, real y)
+        { return 0.2f * std::sin(x) * std::cos(y); };
+        MeshTools::TriangleMesh grid;
+        const int N = 150;
+        for (int j = 0; j < N; ++j)
+            for (int i = 0; i < N; ++i)
+            {
+                real x = i * 0.04f, y = j * 0.04f;
+                grid.vertices.push_back(Vec3(x, y, height(x, y)));
+                grid.attributes.push_back(x);
+            }
+        grid.attributeStride = 1;
+        for (int j = 0; j + 1 < N; ++j)
+            for (int i = 0; i + 1 < N; ++i)
+            {
+                uint32_t v = j * N + i;
+                grid.indices.insert(grid.indices.end(), {v, v + 1, v + N, v + 1, v + N + 1, v + N});
+            }
+
+        MeshTools::SimplifyOptions sopt;
+        sopt.targetTriangles = 2000;
+        MeshTools::TriangleMesh lod = MeshTools::Simplify(grid, sopt);
+        std::cout << "QEM: " << grid.TriangleCount() << " -> " << lod.TriangleCount() << " triangles, " << lod.VertexCount() << " vertices\n";
+        assert(lod.TriangleCount() <= 2000 && lod.TriangleCount() > 1000);
+        assert(lod.attributes.size() == lod.VertexCount());
+        for (size_t i = 0; i < lod.VertexCount(); ++i)
+        {
+            const Vec3 &p = lod.vertices[i];
+            assert(std::fabs(p.z - height(p.x, p.y)) < 0.02f);
+            assert(std::fabs(lod.attributes[i] - p.x) < 0.02f);
+        }
+
+        sopt.targetTriangles = 0;
+        sopt.maxError = 1e-8f;
+        sopt.parallel = false;
+        MeshTools::TriangleMesh flat = MeshTools::Simplify(grid, sopt);
+        assert(flat.TriangleCount() < grid.TriangleCount());
+    }
+
+    // ---------- Mesh 处理测试 ----------
+    {
+        // 每个面独立顶点的立方体, 焊接后应为 8 个顶点
+        MeshTools::TriangleMesh cube;
+        const int faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+        for (const auto &f : faces)
+        {
+            uint32_t base = static_cast<uint32_t>(cube.vertices.size());
+            for (int k = 0; k < 4; ++k)
+                cube.vertices.push_back(Vec3(real(f[k] & 1), real((f[k] >> 1) & 1), real((f[k] >> 2) & 1)) + Vec3(0, 0, 1e-5f * k));
+            cube.indices.insert(cube.indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+        }
+        assert(MeshTools::WeldVertices(cube, 1e-3f) == 16);
+        assert(cube.VertexCount() == 8 && cube.TriangleCount() == 12);
+        std::vector<Vec3> fn = MeshTools::FaceNormals(cube);
+        for (const Vec3 &n : fn)
+            assert(std::fabs(n.length() - 1) < 1e-5f);
+        std::vector<Vec3> vn = MeshTools::VertexNormals(cube, false);
+        for (size_t i = 0; i < cube.VertexCount(); ++i)
+        {
+            Vec3 outward = (cube.vertices[i] - Vec3(0.5f, 0.5f, 0.5f)).normalize();
+            assert(vn[i].dot(outward) > 0.9f);
+        }
+        // 折叠成点的三角形被删除
+        MeshTools::TriangleMesh tiny;
+        tiny.vertices = {Vec3(0, 0, 0), Vec3(1e-4f, 0, 0), Vec3(0, 1e-4f, 0)};
+        tiny.indices = {0, 1, 2};
+        MeshTools::WeldVertices(tiny, 1e-3f);
+        assert(tiny.VertexCount() == 1 && tiny.TriangleCount() == 0);
+
+        // 带噪声的平面网格, 平滑后起伏减小且边界不动
+        MeshTools::TriangleMesh plane;
+        const int N = 60;
+        MathTools::FastRandom rng(7);
+        for (int j = 0; j < N; ++j)
+            for (int i = 0; i < N; ++i)
+                plane.vertices.push_back(Vec3(real(i), real(j), rng.Range(-0.5f, 0.5f)));
+        for (int j = 0; j + 1 < N; ++j)
+            for (int i = 0; i + 1 < N; ++i)
+            {
+                uint32_t v = j * N + i;
+                plane.indices.insert(plane.indices.end(), {v, v + 1, v + N, v + 1, v + N + 1, v + N});
+            }
+        std::vector<Vec3> before = plane.vertices;
+        auto roughness = [&](const std::vector<Vec3> &pts)
+        {
+            real s = 0;
+            for (const Vec3 &p : pts)
+                s += p.z * p.z;
+            return s;
+        };
+        MeshTools::SmoothLaplacian(plane, 10, 0.5f);
+        assert(roughness(plane.vertices) < 0.2f * roughness(before));
+        assert(plane.vertices[0] == before[0] && plane.vertices[N - 1] == before[N - 1]);
+        assert(std::fabs(plane.vertices[N + 1].x - 1) < 0.3f);
+    }
+
+    // ---------- 顶点缓存优化测试 ----------
+    {
+        MeshTools::TriangleMesh grid;
+        const int N = 200;
+        for (int j = 0; j < N; ++j)
+            for (int i = 0; i < N; ++i)
+            {
+                grid.vertices.push_back(Vec3(real(i), real(j), 0));
+                grid.attributes.push_back(real(i + j));
+            }
+        grid.attributeStride = 1;
+        std::vector<std::array<uint32_t, 3>> tris;
+        for (int j = 0; j + 1 < N; ++j)
+            for (int i = 0; i + 1 < N; ++i)
+            {
+                uint32_t v = j * N + i;
+                tris.push_back({v, v + 1, v + N});
+                tris.push_back({v + 1, v + N + 1, v + N});
+            }
+        // 打乱三角形顺序
+        std::mt19937 gen(3);
+        std::shuffle(tris.begin(), tris.end(), gen);
+        for (const auto &t : tris)
+            grid.indices.insert(grid.indices.end(), t.begin(), t.end());
+        auto canonical = [](const MeshTools::TriangleMesh &m)
+        {
+            std::vector<std::array<real, 9>> out;
+            for (size_t t = 0; t < m.TriangleCount(); ++t)
+            {
+                std::array<Vec3, 3> p = {m.vertices[m.indices[3 * t]], m.vertices[m.indices[3 * t + 1]], m.vertices[m.indices[3 * t + 2]]};
+                size_t r = std::min_element(p.begin(), p.end(), [](const Vec3 &a, const Vec3 &b)
+                                            { return a.x < b.x || (a.x == b.x && a.y < b.y); }) - p.begin();
+                std::array<real, 9> key;
+                for (int k = 0; k < 3; ++k)
+                    key[3 * k] = p[(r + k) % 3].x, key[3 * k + 1] = p[(r + k) % 3].y, key[3 * k + 2] = p[(r + k) % 3].z;
+                out.push_back(key);
+            }
+            std::sort(out.begin(), out.end());
+            return out;
+        };
+        auto reference = canonical(grid);
+
+        real before = MeshTools::CacheMissRatio(grid);
+        MeshTools::OptimizeVertexCache(grid);
+        real after = MeshTools::CacheMissRatio(grid);
+        std::cout << "ACMR: " << before << " -> " << after << "\n";
+        assert(after < 0.8f && after < before * 0.5f);
+        assert(canonical(grid) == reference);
+
+        MeshTools::OptimizeVertexFetch(grid);
+        uint32_t next = 0;
+        for (uint32_t v : grid.indices)
+        {
+            assert(v <= next);
+            if (v == next)
+                ++next;
+        }
+        assert(canonical(grid) == reference);
+        for (size_t v = 0; v < grid.VertexCount(); ++v)
+            assert(grid.attributes[v] == grid.vertices[v].x + grid.vertices[v].y);
+        assert(MeshTools::CacheMissRatio(grid) == after);
+    }
+
+    // ---------- 光栅化测试 ----------
+    {
+        // 对角线穿过采样点的正方形: 共享边上的采样只被一个三角形认领
+        Raster::CoverageMask mask(64, 64);
+        Raster::Options acc;
+        acc.mode = Raster::Mode::Accumulate;
+        std::vector<Vec2> quad = {Vec2(0.5f, 0.5f), Vec2(40.5f, 0.5f), Vec2(40.5f, 40.5f), Vec2(0.5f, 0.5f), Vec2(40.5f, 40.5f), Vec2(0.5f, 40.5f)};
+        Raster::RasterizeTriangles(mask, quad, acc);
+        real peak = *std::max_element(mask.coverage.begin(), mask.coverage.end());
+        assert(peak == 1 && mask.Sum() == 40 * 40);
+
+        // 4x4 超采样的覆盖率之和接近面积
+        Raster::CoverageMask aa(64, 64);
+        Raster::Options ssaa;
+        ssaa.samplesPerAxis = 4;
+        Raster::RasterizeTriangles(aa, {Vec2(3.3f, 2.1f), Vec2(50.7f, 10.2f), Vec2(20.1f, 60.9f)}, ssaa);
+        real area = std::fabs((Vec2(50.7f, 10.2f) - Vec2(3.3f, 2.1f)).cross(Vec2(20.1f, 60.9f) - Vec2(3.3f, 2.1f))) / 2;
+        assert(std::fabs(aa.Sum() - area) < 0.01f * area);
+        assert(aa.At(20, 20) == 1 && aa.At(60, 60) == 0);
+
+        // 带洞的多边形 (洞反向) 与凹多边形
+        Raster::CoverageMask ring(64, 64);
+        Raster::RasterizePolygons(ring, {{Vec2(8, 8), Vec2(56, 8), Vec2(56, 56), Vec2(8, 56)}, {Vec2(20, 20), Vec2(20, 44), Vec2(44, 44), Vec2(44, 20)}});
+        assert(ring.Sum() == 48 * 48 - 24 * 24);
+        assert(ring.At(10, 10) == 1 && ring.At(30, 30) == 0);
+        Raster::CoverageMask ell(64, 64);
+        Raster::RasterizePolygon(ell, {Vec2(0, 0), Vec2(30, 0), Vec2(30, 10), Vec2(10, 10), Vec2(10, 30), Vec2(0, 30)});
+        assert(ell.Sum() == 30 * 10 + 10 * 20 && ell.At(20, 20) == 0);
+
+        // 大量随机三角形跨越 tile 与画布边界, 与逐像素判定比较
+        MathTools::FastRandom rng(11);
+        std::vector<Vec2> soup;
+        for (int i = 0; i < 3000; ++i)
+        {
+            Vec2 c(rng.Range(-20, 320), rng.Range(-20, 220));
+            for (int k = 0; k < 3; ++k)
+                soup.push_back(c + Vec2(rng.Range(-15, 15), rng.Range(-15, 15)));
+        }
+        Raster::CoverageMask big(300, 200);
+        Raster::RasterizeTriangles(big, soup);
+        int mismatches = 0;
+        for (int y = 0; y < 200; y += 3)
+            for (int x = 0; x < 300; x += 3)
+            {
+                Vec2 p(x + 0.5f, y + 0.5f);
+                bool inside = false;
+                for (size_t t = 0; t < soup.size() && !inside; t += 3)
+                {
+                    real d0 = (soup[t + 1] - soup[t]).cross(p - soup[t]), d1 = (soup[t + 2] - soup[t + 1]).cross(p - soup[t + 1]), d2 = (soup[t] - soup[t + 2]).cross(p - soup[t + 2]);
+                    inside = (d0 > 0 && d1 > 0 && d2 > 0) || (d0 < 0 && d1 < 0 && d2 < 0);
+                }
+                mismatches += inside != (big.At(x, y) == 1);
+            }
+        assert(mismatches == 0);
+
+        // 同一采样上叠加超过 32767 个图元时环绕数不回绕
+        std::vector<Vec2> stacked;
+        for (int i = 0; i < 65536; ++i)
+            stacked.insert(stacked.end(), {Vec2(0, 0), Vec2(4, 0), Vec2(0, 4)});
+        Raster::CoverageMask heat(4, 4), cover(4, 4);
+        Raster::RasterizeTriangles(heat, std::vector<Vec2>(stacked.begin(), stacked.begin() + 3 * 40000), acc);
+        assert(heat.At(1, 1) == 40000);
+        Raster::RasterizeTriangles(cover, stacked);
+        assert(cover.At(1, 1) == 1);
+
+        // 远离画布或非有限的顶点: 按画布裁剪, 非有限三角形被忽略
+        Raster::CoverageMask clip(8, 8);
+        const real inf = std::numeric_limits<real>::infinity();
+        Raster::RasterizeTriangles(clip, {Vec2(-1e30f, -1e30f), Vec2(1e30f, -1e30f), Vec2(0, 1e30f), Vec2(1, 1), Vec2(inf, 1), Vec2(1, 5), Vec2(std::nanf(""), 0), Vec2(3, 3), Vec2(0, 3)});
+        assert(clip.Sum() == 64);
+    }
+
+    // ---------- 批量矩阵乘法测试 ----------
+    {
+        MathTools::FastRandom rng(5);
+        const size_t n = 1003;
+        std::vector<Mat3> A(n), B(n), C(n);
+        std::vector<Mat2> A2(n), B2(n), C2(n);
+        auto close3 = [](const Mat3 &x, const Mat3 &y)
+        {
+            Mat3 d = x - y;
+            return std::fabs(d.m00) + std::fabs(d.m01) + std::fabs(d.m02) + std::fabs(d.m10) + std::fabs(d.m11) + std::fabs(d.m12) + std::fabs(d.m20) + std::fabs(d.m21) + std::fabs(d.m22) < 1e-5f;
+        };
+        auto close2 = [](const Mat2 &x, const Mat2 &y)
+        {
+            Mat2 d = x - y;
+            return std::fabs(d.m00) + std::fabs(d.m01) + std::fabs(d.m10) + std::fabs(d.m11) < 1e-5f;
+        };
+        for (size_t i = 0; i < n; ++i)
+        {
+            A[i] = Mat3(rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1));
+            B[i] = Mat3::Rotation(Vec3(1, 2, 3).normalize(), rng.Range(0, 6));
+            A2[i] = Mat2(rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1));
+            B2[i] = Mat2::Rotation(rng.Range(0, 6));
+        }
+        Batch::MultiplyMany(A.data(), B.data(), C.data(), n);
+        Batch::MultiplyMany(A2.data(), B2.data(), C2.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            assert(close3(C[i], A[i] * B[i]) && close2(C2[i], A2[i] * B2[i]));
+        Batch::MultiplyMany(A[7], B.data(), C.data(), n);
+        Batch::MultiplyMany(A2[7], B2.data(), C2.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            assert(close3(C[i], A[7] * B[i]) && close2(C2[i], A2[7] * B2[i]));
+        Batch::MultiplyMany(A.data(), B[3], C.data(), n);
+        Batch::MultiplyMany(A2.data(), B2[3], C2.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            assert(close3(C[i], A[i] * B[3]) && close2(C2[i], A2[i] * B2[3]));
+        // 原地: A[i] = A[i] * B[i]
+        std::vector<Mat3> ref = A;
+        Batch::MultiplyMany(A.data(), B.data(), A.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            assert(close3(A[i], ref[i] * B[i]));
+    }
+
+    // ---------- Mat3Batch 测试 ----------
+    {
+        MathTools::FastRandom rng(9);
+        const size_t n = 1001;
+        std::vector<Mat3> mats(n);
+        for (size_t i = 0; i < n; ++i)
+            mats[i] = Mat3::Rotation(Vec3(rng.Range(-1, 1), rng.Range(-1, 1), 1).normalize(), rng.Range(0, 6)) * Mat3(rng.Range(1, 2), 0, 0, 0, rng.Range(1, 2), 0, 0, 0, rng.Range(1, 2)) + Mat3(0, rng.Range(-0.3f, 0.3f), 0, 0, 0, 0, 0, 0, 0);
+        Batch::Mat3Batch batch(mats.data(), n);
+        assert(batch.Size() == n);
+        std::vector<Mat3> back(n);
+        batch.ToArray(back.data());
+        for (size_t i = 0; i < n; ++i)
+            assert(back[i].m01 == mats[i].m01 && back[i].m22 == mats[i].m22);
+
+        auto close = [](const Mat3 &x, const Mat3 &y, real eps)
+        {
+            Mat3 d = x - y;
+            return std::fabs(d.m00) + std::fabs(d.m01) + std::fabs(d.m02) + std::fabs(d.m10) + std::fabs(d.m11) + std::fabs(d.m12) + std::fabs(d.m20) + std::fabs(d.m21) + std::fabs(d.m22) < eps;
+        };
+        std::vector<real> det(n), tr(n);
+        Batch::Det(batch, det.data());
+        Batch::Trace(batch, tr.data());
+        Batch::Mat3Batch t, inv, prod;
+        Batch::Transpose(batch, t);
+        Batch::Inv(batch, inv);
+        Batch::Multiply(batch, inv, prod);
+        for (size_t i = 0; i < n; ++i)
+        {
+            assert(std::fabs(det[i] - mats[i].Det()) < 1e-4f * std::fabs(mats[i].Det()));
+            assert(std::fabs(tr[i] - mats[i].Trace()) < 1e-5f);
+            assert(close(t.Get(i), mats[i].Transpose(), 1e-6f));
+            assert(close(inv.Get(i), mats[i].Inv(), 1e-4f));
+            assert(close(prod.Get(i), Mat3::Identity(), 1e-4f));
+        }
+        // 原地运算
+        Batch::Transpose(t, t);
+        Batch::Multiply(t, t, t);
+        for (size_t i = 0; i < n; ++i)
+            assert(close(t.Get(i), mats[i] * mats[i], 1e-4f));
+        Batch::Mat3Batch self(mats.data(), n);
+        Batch::Inv(self, self);
+        for (size_t i = 0; i < n; ++i)
+            assert(close(self.Get(i), inv.Get(i), 1e-6f));
+
+        batch.Set(500, Mat3::Zero());
+        bool threw = false;
+        try
+        {
+            Batch::Inv(batch, inv);
+        }
+        catch (const char *)
+        {
+            threw = true;
+        }
+        assert(threw);
+        // 抛出前不写 out: 原地求逆失败时输入保持不变
+        threw = false;
+        try
+        {
+            Batch::Inv(batch, batch);
+        }
+        catch (const char *)
+        {
+            threw = true;
+        }
+        assert(threw && close(batch.Get(500), Mat3::Zero(), 1e-30f));
+        for (size_t i = 0; i < n; ++i)
+            assert(i == 500 || close(batch.Get(i), mats[i], 1e-30f));
+        assert(close(inv.Get(0), mats[0].Inv(), 1e-4f));
+    }
+
+    // ---------- 极分解与矩阵指数/对数测试 ----------
+    {
+        auto close3 = [](const Mat3 &x, const Mat3 &y, real eps)
+        { return (x - y).Norm() < eps; };
+        auto close2 = [](const Mat2 &x, const Mat2 &y, real eps)
+        { return (x - y).Norm() < eps; };
+        MathTools::FastRandom rng(21);
+        const size_t n = 203;
+        std::vector<Mat3> F(n), W(n);
+        std::vector<Mat2> F2(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            // 形变梯度: 旋转乘以对称正定拉伸, 另加一个反射和一个奇异矩阵
+            Mat3 rot = Mat3::Rotation(Vec3(rng.Range(-1, 1), rng.Range(-1, 1), 1).normalize(), rng.Range(-1.2f, 1.2f));
+            Mat3 stretch = Mat3::Identity() + Mat3::OuterProduct(Vec3(1, 0.5f, 0), Vec3(1, 0.5f, 0)) * rng.Range(0, 1) + Mat3::Identity() * rng.Range(-0.3f, 0.3f);
+            F[i] = rot * stretch;
+            W[i] = Mat3(0, -1, 0.3f, 1, 0, -0.6f, -0.3f, 0.6f, 0) * rng.Range(-2, 2) + Mat3::Identity() * rng.Range(-0.5f, 0.5f);
+            F2[i] = Mat2::Rotation(rng.Range(-1.2f, 1.2f)) * Mat2(rng.Range(0.5f, 2), 0.3f, 0.3f, rng.Range(0.5f, 2));
+        }
+        F[5] = Mat3(-1, 0, 0, 0, 1, 0, 0, 0, 1) * F[5];
+        F[6] = Mat3::OuterProduct(Vec3(1, 2, 3), Vec3(0, 1, 1));
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            Mat3 R, S;
+            F[i].PolarDecomposition(R, S);
+            assert(close3(R * S, F[i], 1e-4f) && close3(R.Transpose() * R, Mat3::Identity(), 1e-4f));
+            assert(S.m01 == S.m10 && S.m02 == S.m20 && S.m12 == S.m21);
+            if (i != 5 && i != 6)
+            {
+                assert(std::fabs(R.Det() - 1) < 1e-4f);
+                assert(close3(F[i].Log().Exp(), F[i], 1e-3f * F[i].Norm()));
+            }
+            assert(close3(W[i].Exp().Log().Exp(), W[i].Exp(), 1e-3f * W[i].Exp().Norm()));
+
+            Mat2 r, s;
+            F2[i].PolarDecomposition(r, s);
+            assert(close2(r * s, F2[i], 1e-5f) && std::fabs(r.Det() - 1) < 1e-5f);
+            assert(close2(F2[i].Log().Exp(), F2[i], 1e-4f));
+        }
+        // exp(log) 与 SVD 结果一致: 旋转矩阵的对数为反对称阵
+        Mat3 rot = Mat3::Rotation(Vec3(0, 0, 1), 1.0f);
+        assert(close3(rot.Log(), Mat3(0, -1, 0, 1, 0, 0, 0, 0, 0), 1e-4f));
+        assert(close2(Mat2(0, -1, 1, 0).Exp(), Mat2::Rotation(1.0f), 1e-5f));
+        bool threw = false;
+        try
+        {
+            Mat2(-1, 0, 0, 2).Log();
+        }
+        catch (const char *)
+        {
+            threw = true;
+        }
+        assert(threw);
+
+        // 批量版本与逐个计算一致
+        Batch::Mat3Batch fb(F.data(), n), wb(W.data(), n), Rb, Sb, Eb, Lb;
+        Batch::PolarDecomposition(fb, Rb, Sb);
+        Batch::Exp(wb, Eb);
+        std::vector<Mat3> G(F.begin() + 7, F.end());
+        Batch::Mat3Batch gb(G.data(), G.size());
+        Batch::Log(gb, Lb);
+        for (size_t i = 0; i < n; ++i)
+        {
+            Mat3 R, S;
+            F[i].PolarDecomposition(R, S);
+            assert(close3(Rb.Get(i), R, 1e-4f) && close3(Sb.Get(i), S, 1e-4f));
+            assert(close3(Eb.Get(i), W[i].Exp(), 1e-4f * W[i].Exp().Norm()));
+            if (i < G.size())
+                assert(close3(Lb.Get(i), G[i].Log(), 1e-4f));
+        }
+        Batch::Mat2Batch f2(F2.data(), n), r2, s2, e2, l2;
+        Batch::PolarDecomposition(f2, r2, s2);
+        Batch::Log(f2, l2);
+        Batch::Exp(l2, e2);
+        for (size_t i = 0; i < n; ++i)
+        {
+            Mat2 r, s;
+            F2[i].PolarDecomposition(r, s);
+            assert(close2(r2.Get(i), r, 1e-6f) && close2(s2.Get(i), s, 1e-5f));
+            assert(close2(l2.Get(i), F2[i].Log(), 1e-5f) && close2(e2.Get(i), F2[i], 1e-4f));
+        }
+    }
+
+    // ---------- Philox 计数器随机数测试 ----------
+    {
+        // Random123 已知答案: 计数器与密钥全零
+        uint32_t kat[4];
+        MathTools::Philox(0, 0).Block(0, kat);
+        assert(kat[0] == 0x6627e8d5u && kat[1] == 0xe169c58du && kat[2] == 0xbc57ac4cu && kat[3] == 0x9b00dbd8u);
+
+        MathTools::Philox rng(12345, 7);
+        const size_t n = 100003;
+        std::vector<real> all(n);
+        rng.FillUniform(all.data(), n);
+        double mean = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            assert(all[i] >= 0 && all[i] < 1);
+            mean += all[i];
+        }
+        assert(std::fabs(mean / n - 0.5) < 0.005);
+        assert(rng.Uniform(0) == all[0] && rng.Uniform(777) == all[777] && rng.Uniform(n - 1) == all[n - 1]);
+
+        // 按任意方式切分并行生成, 结果逐位一致
+        std::vector<real> split(n);
+        const size_t pieces = 7;
+        Parallel::For(
+            pieces, [&](size_t b, size_t e)
+            {
+                for (size_t p = b; p < e; ++p)
+                {
+                    size_t lo = n * p / pieces, hi = n * (p + 1) / pieces;
+                    rng.FillUniform(split.data() + lo, hi - lo, lo);
+                } },
+            1);
+        assert(split == all);
+
+        // 不同流互不相同
+        assert(MathTools::Philox(12345, 8).Uniform(0) != all[0]);
+        std::vector<real> range(100);
+        rng.FillRange(range.data(), range.size(), -2, 3, 50);
+        for (size_t i = 0; i < range.size(); ++i)
+            assert(std::fabs(range[i] - rng.Range(50 + i, -2, 3)) < 1e-6f);
+    }
+
+    // ---------- 低差异序列测试 ----------
+    {
+        using Sampling::Sequence;
+        assert(Sampling::Sample(Sequence::Sobol, 1, 0) == 0.5f && Sampling::Sample(Sequence::Sobol, 2, 0) == 0.25f && Sampling::Sample(Sequence::Sobol, 3, 1) == 0.25f);
+        assert(Sampling::Sample(Sequence::Halton, 5, 0) == 0.625f && std::fabs(Sampling::Sample(Sequence::Halton, 1, 1) - 1.0f / 3) < 1e-6f);
+
+        // 前 2^m 个点: Sobol 前两维构成 (0, m, 2) 网, 每个面积 2^-m 的基本区间恰有一个点; Owen 置乱保持该性质
+        const int m = 8;
+        const size_t n = size_t(1) << m;
+        for (Sequence seq : {Sequence::Sobol, Sequence::OwenSobol})
+        {
+            std::vector<Vec2> pts(n);
+            Sampling::Generate(seq, pts.data(), n, 0, 99);
+            for (int a = 0; a <= m; ++a)
+            {
+                std::vector<int> cells(n, 0);
+                for (const Vec2 &p : pts)
+                    ++cells[(static_cast<size_t>(p.x * (1 << a)) << (m - a)) + static_cast<size_t>(p.y * (1 << (m - a)))];
+                for (int c : cells)
+                    assert(c == 1);
+            }
+            for (size_t i = 0; i < n; i += 37)
+                assert(pts[i].x == Sampling::Sample(seq, i, 0, 2, 99) && pts[i].y == Sampling::Sample(seq, i, 1, 2, 99));
+        }
+
+        // 批量生成与随机访问一致, 且可从任意下标开始
+        for (Sequence seq : {Sequence::Sobol, Sequence::OwenSobol, Sequence::Halton, Sequence::ScrambledHalton, Sequence::R2})
+        {
+            std::vector<Vec3> pts(5000);
+            Sampling::Generate(seq, pts.data(), pts.size(), 1000, 7);
+            double integral = 0;
+            for (size_t i = 0; i < pts.size(); ++i)
+            {
+                const Vec3 &p = pts[i];
+                assert(p.x >= 0 && p.x < 1 && p.y >= 0 && p.y < 1 && p.z >= 0 && p.z < 1);
+                assert(p.z == Sampling::Sample(seq, 1000 + i, 2, 3, 7));
+                integral += p.x * p.y * p.z;
+            }
+            // 拟蒙特卡洛积分 ∫ xyz = 1/8; 同样点数的伪随机误差约 2e-3
+            assert(std::fabs(integral / pts.size() - 0.125) < (seq == Sequence::R2 ? 2e-3 : 2e-4));
+        }
+        std::vector<real> line(1000);
+        Sampling::Generate(Sequence::R2, line.data(), line.size());
+        std::sort(line.begin(), line.end());
+        for (size_t i = 1; i < line.size(); ++i)
+            assert(line[i] - line[i - 1] > 0.2f / line.size());
+    }
+
+    // ---------- Poisson 圆盘采样测试 ----------
+    {
+        using namespace OxygenMathLite;
+        auto minDist2 = [](const std::vector<Vec2> &pts)
+        {
+            real best = 1e30f;
+            for (size_t i = 0; i < pts.size(); ++i)
+                for (size_t j = i + 1; j < pts.size(); ++j)
+                    best = std::min(best, (pts[i] - pts[j]).lengthSquared());
+            return best;
+        };
+        real r = 0.05f;
+        auto seq = Sampling::PoissonDisk(Vec2(0, 0), Vec2(1, 1), r, 7, false);
+        auto par = Sampling::PoissonDisk(Vec2(0, 0), Vec2(3, 2), r, 7, true);
+        assert(minDist2(seq) >= r * r * 0.999f);
+        assert(minDist2(par) >= r * r * 0.999f);
+        // 最大 Poisson 点集的密度约为 0.7 / r^2
+        assert(seq.size() > 0.55f / (r * r) && seq.size() < 0.95f / (r * r));
+        assert(par.size() > 6 * 0.55f / (r * r));
+        for (const Vec2 &p : par)
+            assert(p.x >= 0 && p.x < 3 && p.y >= 0 && p.y < 2);
+        // 覆盖完整: 任意位置 2r 内都有采样点
+        for (int k = 0; k < 200; ++k)
+        {
+            Vec2 q(0.015f * k, 0.01f * k);
+            bool near = false;
+            for (const Vec2 &p : par)
+                near = near || (p - q).lengthSquared() < 4 * r * r;
+            assert(near);
+        }
+        auto again = Sampling::PoissonDisk(Vec2(0, 0), Vec2(3, 2), r, 7, true);
+        assert(again.size() == par.size() && (again[par.size() / 2] - par[par.size() / 2]).lengthSquared() == 0);
+
+        auto pts3 = Sampling::PoissonDisk(Vec3(0, 0, 0), Vec3(1, 1, 1), 0.1f, 3);
+        real best3 = 1e30f;
+        for (size_t i = 0; i < pts3.size(); ++i)
+            for (size_t j = i + 1; j < pts3.size(); ++j)
+                best3 = std::min(best3, (pts3[i] - pts3[j]).lengthSquared());
+        assert(pts3.size() > 300 && best3 >= 0.01f * 0.999f);
+
+        auto tile = Sampling::BlueNoiseTile::Generate(0.1f, 5);
+        auto tiled = tile.Fill(Vec2(0, 0), Vec2(2.5f, 1.5f), 0.5f);
+        assert(minDist2(tiled) >= 0.05f * 0.05f * 0.999f);
+        assert(tiled.size() > 15 * tile.points.size() / 2);
+        // 环面距离下的最小间距, 覆盖格子无法整除周期的半径
+        for (int k = 0; k < 9; ++k)
+            for (uint64_t seed = 0; seed < 40; ++seed)
+            {
+                real radius = 0.07f + 0.02f * k;
+                auto t = Sampling::BlueNoiseTile::Generate(radius, seed);
+                real best = 1e30f;
+                for (size_t i = 0; i < t.points.size(); ++i)
+                    for (size_t j = i + 1; j < t.points.size(); ++j)
+                    {
+                        real dx = std::fabs(t.points[i].x - t.points[j].x), dy = std::fabs(t.points[i].y - t.points[j].y);
+                        dx = std::min(dx, 1 - dx), dy = std::min(dy, 1 - dy);
+                        best = std::min(best, dx * dx + dy * dy);
+                    }
+                assert(t.points.size() > 1 && best >= radius * radius * 0.999f);
+            }
+    }
+
+    // ---------- 噪声测试 ----------
+    {
+        using namespace OxygenMathLite;
+        Noise::Type types[3] = {Noise::Type::Value, Noise::Type::Perlin, Noise::Type::Simplex};
+        for (Noise::Type type : types)
+        {
+            real lo = 1, hi = -1;
+            for (int i = 0; i < 20000; ++i)
+            {
+                Vec2 p(i * 0.0137f - 50, (i % 173) * 0.291f - 20);
+                Vec3 q(p.x, p.y, i * 0.0071f);
+                real a = Noise::Evaluate(type, p), b = Noise::Evaluate(type, q, 9);
+                lo = std::min(lo, std::min(a, b));
+                hi = std::max(hi, std::max(a, b));
+                // 确定性
+                assert(a == Noise::Evaluate(type, p));
+            }
+            assert(lo >= -1.05f && hi <= 1.05f && hi - lo > 1.0f);
+            // 连续性
+            Vec2 p(3.3f, -7.1f);
+            assert(std::abs(Noise::Evaluate(type, p) - Noise::Evaluate(type, p + Vec2(1e-3f, 0))) < 0.02f);
+        }
+        // Perlin / 梯度噪声在格点上为 0
+        assert(std::abs(Noise::Perlin(Vec2(3, -4))) < 1e-6f && std::abs(Noise::Perlin(Vec3(1, 2, -5))) < 1e-6f);
+
+        // 批量 SoA / AoS 与网格路径与单点 fBm 一致
+        const size_t W = 37, H = 23;
+        std::vector<real> xs(W * H), ys(W * H), soa(W * H), aos(W * H), grid(W * H);
+        std::vector<Vec2> pts(W * H);
+        Vec2 origin(-3.7f, 2.1f), step(0.173f, 0.091f);
+        for (size_t j = 0; j < H; ++j)
+            for (size_t i = 0; i < W; ++i)
+            {
+                pts[j * W + i] = Vec2(origin.x + step.x * static_cast<real>(i), origin.y + step.y * static_cast<real>(j));
+                xs[j * W + i] = pts[j * W + i].x;
+                ys[j * W + i] = pts[j * W + i].y;
+            }
+        for (Noise::Type type : types)
+            for (real warp : {real(0), real(0.8f)})
+            {
+                Noise::FractalOptions opt;
+                opt.type = type;
+                opt.octaves = 4;
+                opt.frequency = 0.7f;
+                opt.warp = warp;
+                opt.seed = 42;
+                Noise::Evaluate(xs.data(), ys.data(), soa.data(), W * H, opt);
+                Noise::Evaluate(pts.data(), aos.data(), W * H, opt);
+                Noise::EvaluateGrid(origin, step, W, H, grid.data(), opt);
+                for (size_t k = 0; k < W * H; ++k)
+                {
+                    real ref = Noise::Fbm(pts[k], opt);
+                    assert(std::abs(soa[k] - ref) < 1e-5f && std::abs(aos[k] - ref) < 1e-5f && std::abs(grid[k] - ref) < 1e-5f);
+                    assert(std::abs(ref) <= 1.05f);
+                }
+            }
+
+        // 3D 批量与域扭曲
+        std::vector<real> zs(W * H, 0.37f), out3(W * H);
+        Noise::FractalOptions opt3;
+        opt3.warp = 0.5f;
+        Noise::Evaluate(xs.data(), ys.data(), zs.data(), out3.data(), W * H, opt3);
+        for (size_t k = 0; k < W * H; k += 7)
+            assert(std::abs(out3[k] - Noise::Fbm(Vec3(xs[k], ys[k], 0.37f), opt3)) < 1e-5f);
+        Vec2 w = Noise::Warp(Vec2(1, 2), 0.5f);
+        assert((w - Vec2(1, 2)).length() <= 0.75f && (w - Vec2(1, 2)).length() > 0);
+        assert(Noise::Fbm(Vec2(1, 2), Noise::FractalOptions()) != Noise::Fbm(Vec2(1, 2), opt3));
+    }
+
+    // ---------- 多边形三角化测试 ----------
+    {
+        using namespace OxygenMathLite;
+        // 三角形数为 n + 2h - 2, 全部逆时针, 面积之和等于 外环 - 洞
+        auto check = [](const std::vector<std::vector<Vec2>> &rings, const std::vector<uint32_t> &idx)
+        {
+            std::vector<Vec2> all;
+            real expected = 0;
+            for (size_t k = 0; k < rings.size(); ++k)
+            {
+                real a = 0;
+                for (size_t i = 0; i < rings[k].size(); ++i)
+                    a += rings[k][i].cross(rings[k][(i + 1) % rings[k].size()]);
+                expected += (k == 0 ? 0.5f : -0.5f) * std::abs(a);
+                all.insert(all.end(), rings[k].begin(), rings[k].end());
+            }
+            assert(idx.size() == 3 * (all.size() + 2 * (rings.size() - 1) - 2));
+            real area = 0;
+            for (size_t i = 0; i < idx.size(); i += 3)
+            {
+                real c = (all[idx[i + 1]] - all[idx[i]]).cross(all[idx[i + 2]] - all[idx[i]]);
+                assert(c >= 0);
+                area += c * 0.5f;
+            }
+            assert(std::abs(area - expected) < 1e-4f * expected);
+        };
+
+        std::vector<Vec2> star, smallStar;
+        for (int i = 0; i < 100; ++i)
+        {
+            real r = i % 2 ? 0.4f : 1.0f, a = i * Constants::TWO_PI / 100;
+            star.push_back(Vec2(r * std::cos(a), r * std::sin(a)));
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            real r = i % 2 ? 0.4f : 1.0f, a = i * Constants::TWO_PI / 10;
+            smallStar.push_back(Vec2(r * std::cos(a), r * std::sin(a)));
+        }
+        check({star}, Geometry2D::Triangulate(star));
+        check({smallStar}, Geometry2D::Triangulate(smallStar));
+        std::vector<Vec2> reversed(star.rbegin(), star.rend());
+        check({reversed}, Geometry2D::Triangulate(reversed));
+
+        // 带洞 (洞的方向任意) 以及含大量水平边 / 分裂 / 合并顶点的多边形
+        std::vector<std::vector<Vec2>> holes = {{{0, 0}, {10, 0}, {10, 10}, {0, 10}}};
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+            {
+                real x = 1.0f + 3 * i, y = 1.0f + 3 * j;
+                holes.push_back({{x, y}, {x + 2, y}, {x + 2, y + 2}, {x, y + 2}});
+            }
+        std::reverse(holes[2].begin(), holes[2].end());
+        check(holes, Geometry2D::Triangulate(holes));
+        std::vector<Vec2> comb = {{0, 0}};
+        for (int i = 0; i < 20; ++i)
+        {
+            comb.push_back({i * 2.0f + 1, 0});
+            comb.push_back({i * 2.0f + 1.5f, -5});
+            comb.push_back({i * 2.0f + 2, 0});
+        }
+        comb.insert(comb.end(), {{41, 0}, {41, 3}, {0, 3}});
+        check({comb}, Geometry2D::Triangulate(comb));
+        std::vector<Vec2> spiral;
+        for (int i = 0; i < 120; ++i)
+            spiral.push_back(Vec2((1 + i * 0.1f) * std::cos(i * 0.1f), (1 + i * 0.1f) * std::sin(i * 0.1f)));
+        for (int i = 119; i >= 0; --i)
+            spiral.push_back(Vec2((1.5f + i * 0.1f) * std::cos(i * 0.1f), (1.5f + i * 0.1f) * std::sin(i * 0.1f)));
+        check({spiral}, Geometry2D::Triangulate(spiral));
+
+        // 重复点被跳过, 退化输入不产生三角形
+        std::vector<Vec2> dup = {{0, 0}, {1, 0}, {1, 0}, {1, 1}, {0, 1}, {0, 0}};
+        assert(Geometry2D::Triangulate(dup).size() == 6);
+        assert(Geometry2D::Triangulate(std::vector<Vec2>{{0, 0}, {1, 1}, {2, 2}}).empty());
+
+        // 批量与异步
+        std::vector<std::vector<std::vector<Vec2>>> polys;
+        MathTools::FastRandom rng(5);
+        for (int p = 0; p < 300; ++p)
+        {
+            std::vector<Vec2> blob, hole;
+            int n = 5 + p % 60;
+            for (int i = 0; i < n; ++i)
+            {
+                real a = i * Constants::TWO_PI / n, r = 5 + rng.Range(0, 3);
+                blob.push_back(Vec2(r * std::cos(a), r * std::sin(a)));
+            }
+            for (int i = 0; i < 8; ++i)
+                hole.push_back(Vec2(2 * std::cos(i * Constants::TWO_PI / 8), 2 * std::sin(i * Constants::TWO_PI / 8)));
+            polys.push_back(p % 3 ? std::vector<std::vector<Vec2>>{blob} : std::vector<std::vector<Vec2>>{blob, hole});
+        }
+        Geometry2D::IndexBuffer buffer;
+        Geometry2D::TriangulateMany(polys, buffer);
+        assert(buffer.Size() == polys.size());
+        for (size_t p = 0; p < polys.size(); ++p)
+            check(polys[p], std::vector<uint32_t>(buffer.indices.begin() + buffer.offsets[p], buffer.indices.begin() + buffer.offsets[p + 1]));
+        // 回调时该块的结果已在调用方的缓冲中
+        size_t chunks = 0, partialOk = 0;
+        Geometry2D::IndexBuffer async;
+        auto task = Geometry2D::TriangulateManyAsync(polys, async, [&](size_t b, size_t e)
+                                                     {
+                                                         ++chunks;
+                                                         partialOk += async.Size() == e && std::equal(async.indices.begin() + async.offsets[b], async.indices.end(), buffer.indices.begin() + buffer.offsets[b]); },
+                                                     64);
+        assert(task.Get() == polys.size() && chunks == 5 && partialOk == 5);
+        assert(async.offsets == buffer.offsets && async.indices == buffer.indices);
+    }
+
+    // ---------- 折线简化测试 ----------
+    {
+        using namespace OxygenMathLite;
+        // 递归版 Douglas-Peucker 作为参照
+        std::function<void(const std::vector<Vec2> &, size_t, size_t, real, std::vector<uint8_t> &)> reference =
+            [&](const std::vector<Vec2> &pts, size_t a, size_t b, real tol, std::vector<uint8_t> &mark)
+        {
+            real best = -1;
+            size_t index = a;
+            for (size_t i = a + 1; i < b; ++i)
+            {
+                real d = Geometry2D::DistancePointToLine(pts[a], pts[b], pts[i]);
+                if (d > best)
+                    best = d, index = i;
+            }
+            if (b - a < 2 || best <= tol)
+                return;
+            mark[index] = 1;
+            reference(pts, a, index, tol, mark);
+            reference(pts, index, b, tol, mark);
+        };
+
+        MathTools::FastRandom rng(11);
+        std::vector<Vec2> track;
+        Vec2 pos(0, 0);
+        for (int i = 0; i < 2000; ++i)
+        {
+            pos += Vec2(1, 0).rotate(std::sin(i * 0.01f) * 2) * 0.5f + Vec2(rng.Range(-0.05f, 0.05f), rng.Range(-0.05f, 0.05f));
+            track.push_back(pos);
+        }
+        std::vector<uint32_t> keep;
+        Geometry2D::SimplifyDouglasPeucker(track.data(), track.size(), 0.2f, keep);
+        std::vector<uint8_t> mark(track.size(), 0);
+        mark.front() = mark.back() = 1;
+        reference(track, 0, track.size() - 1, 0.2f, mark);
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < mark.size(); ++i)
+            if (mark[i])
+                expected.push_back(static_cast<uint32_t>(i));
+        assert(keep == expected && keep.size() < track.size() / 4);
+        // 每个原始点到简化折线的距离不超过容差
+        for (size_t k = 0; k + 1 < keep.size(); ++k)
+            for (size_t i = keep[k]; i <= keep[k + 1]; ++i)
+                assert(Geometry2D::DistancePointToLine(track[keep[k]], track[keep[k + 1]], track[i]) <= 0.2f + 1e-4f);
+
+        // Visvalingam: 共线点先删, 剩余点的有效面积均不小于阈值
+        std::vector<Vec2> line = {{0, 0}, {1, 0}, {2, 0}, {3, 1}, {4, 0}, {5, 0}, {6, 0.01f}, {7, 0}};
+        auto vw = Geometry2D::SimplifyPolyline(line, 0.1f, Geometry2D::SimplifyMethod::Visvalingam);
+        assert(vw.size() == 5 && vw[1].x == 2 && vw[2].x == 3 && vw[3].x == 4 && vw[4].x == 7);
+        Geometry2D::SimplifyVisvalingam(track.data(), track.size(), std::numeric_limits<real>::infinity(), keep, 50);
+        assert(keep.size() == 50 && keep.front() == 0 && keep.back() == track.size() - 1);
+        Geometry2D::SimplifyVisvalingam(track.data(), track.size(), 0.05f, keep);
+        assert(keep.size() < track.size() / 2);
+
+        // 批量
+        std::vector<std::vector<Vec2>> lines(200), out;
+        for (size_t k = 0; k < lines.size(); ++k)
+            lines[k].assign(track.begin() + k * 5, track.begin() + k * 5 + 100 + k * 3);
+        Geometry2D::SimplifyPolylines(lines, 0.2f, out);
+        assert(out.size() == lines.size());
+        for (size_t k = 0; k < lines.size(); ++k)
+        {
+            auto single = Geometry2D::SimplifyPolyline(lines[k], 0.2f);
+            assert(out[k].size() == single.size() && (out[k].back() - lines[k].back()).length() == 0);
+        }
+        Geometry2D::SimplifyPolylines(lines, 0.05f, out, Geometry2D::SimplifyMethod::Visvalingam);
+        assert(out[7].size() == Geometry2D::SimplifyPolyline(lines[7], 0.05f, Geometry2D::SimplifyMethod::Visvalingam).size());
+    }
+
+    // ---------- 折线最近点索引测试 ----------
+    {
+        using namespace OxygenMathLite;
+        MathTools::FastRandom rng(21);
+        std::vector<std::vector<Vec2>> roads(40);
+        for (auto &road : roads)
+        {
+            Vec2 p(rng.Range(0, 100), rng.Range(0, 100)), dir = Vec2(1, 0).rotate(rng.Range(0, Constants::TWO_PI));
+            for (int i = 0; i < 60; ++i)
+            {
+                road.push_back(p);
+                dir = dir.rotate(rng.Range(-0.3f, 0.3f));
+                p += dir * rng.Range(0.2f, 3.0f);
+            }
+        }
+        roads.push_back({});
+        roads.push_back({{-30, -30}, {-30, -30}, {-25, -30}});
+        Spatial::PolylineIndex index(roads);
+        assert(index.PolylineCount() == roads.size());
+
+        std::vector<Vec2> queries;
+        for (int i = 0; i < 2000; ++i)
+            queries.push_back(Vec2(rng.Range(-50, 150), rng.Range(-50, 150)));
+        queries.push_back(Vec2(1e4f, -1e4f));
+        std::vector<Spatial::PolylineHit> hits(queries.size());
+        index.Closest(queries.data(), queries.size(), hits.data());
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            // 暴力对照
+            real best = std::numeric_limits<real>::max();
+            for (const auto &road : roads)
+                for (size_t k = 1; k < road.size(); ++k)
+                    best = std::min(best, (Geometry2D::ClosestPointOnLineSegment(road[k - 1], road[k], queries[i]) - queries[i]).length());
+            const Spatial::PolylineHit &h = hits[i];
+            assert(h.Valid() && std::abs(h.distance - best) <= 1e-3f * (1 + best));
+            const auto &road = roads[h.polyline];
+            Vec2 onSeg = road[h.segment] + (road[h.segment + 1] - road[h.segment]) * h.t;
+            assert((onSeg - h.point).length() < 1e-3f && std::abs((h.point - queries[i]).length() - h.distance) < 1e-3f);
+            // 弧长与 PointAt 互逆
+            assert((index.PointAt(h.polyline, h.arcLength) - h.point).length() < 1e-2f);
+        }
+        real len = 0;
+        for (size_t k = 1; k < roads[3].size(); ++k)
+            len += (roads[3][k] - roads[3][k - 1]).length();
+        assert(std::abs(index.Length(3) - len) < 1e-3f * len && (index.PointAt(3, len * 2) - roads[3].back()).length() < 1e-4f);
+        assert(!index.Closest(Vec2(1e4f, 1e4f), 10).Valid());
+        Spatial::PolylineHit z = index.Closest(Vec2(-27, -31));
+        assert(z.polyline == roads.size() - 1 && z.segment == 1 && std::abs(z.arcLength - 3) < 1e-4f);
+    }
+
+    // ---------- R 树测试 ----------
+    {
+        using OxygenMathLite::Geometry2D::AABB;
+        using OxygenMathLite::Spatial::RTree;
+        OxygenMathLite::MathTools::FastRandom rng(98);
+        auto makeBox = [&]()
+        {
+            Vec2 p(rng.Uniform() * 100, rng.Uniform() * 100);
+            return AABB(p, p + Vec2(rng.Uniform() * 3, rng.Uniform() * 3));
+        };
+        auto overlaps = [](const AABB &a, const AABB &b)
+        { return a.Intersects(b); };
+        std::vector<AABB> boxes(3000);
+        for (auto &b : boxes)
+            b = makeBox();
+
+        RTree bulk, dynamic;
+        bulk.BulkLoad(boxes.data(), boxes.size());
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+            dynamic.Insert(boxes[i], i);
+        assert(bulk.Size() == 3000 && dynamic.Size() == 3000);
+
+        // 窗口查询与暴力结果一致
+        for (int q = 0; q < 50; ++q)
+        {
+            AABB w = makeBox();
+            w.max = w.max + Vec2(5, 5);
+            std::vector<uint32_t> expect, got1, got2;
+            for (uint32_t i = 0; i < boxes.size(); ++i)
+                if (overlaps(w, boxes[i]))
+                    expect.push_back(i);
+            bulk.Query(w, got1);
+            dynamic.Query(w, got2);
+            std::sort(got1.begin(), got1.end());
+            std::sort(got2.begin(), got2.end());
+            assert(got1 == expect && got2 == expect);
+        }
+
+        // k 近邻距离与暴力结果一致
+        for (int q = 0; q < 20; ++q)
+        {
+            Vec2 p(rng.Uniform() * 100, rng.Uniform() * 100);
+            std::vector<real> all;
+            for (const auto &b : boxes)
+                all.push_back(b.DistanceSquared(p));
+            std::sort(all.begin(), all.end());
+            uint32_t ids[5];
+            real d[5];
+            assert(dynamic.Nearest(p, 5, ids, d) == 5);
+            // 编译器可能把距离计算收缩为 FMA, 不同位置内联的结果允许末位差异
+            auto same = [](real x, real y)
+            { return std::fabs(x - y) <= 1e-5f * std::max(real(1), std::fabs(y)); };
+            for (int k = 0; k < 5; ++k)
+                assert(same(d[k], all[k]) && same(boxes[ids[k]].DistanceSquared(p), d[k]));
+        }
+
+        // 删除一半后查询仍正确
+        for (uint32_t i = 0; i < boxes.size(); i += 2)
+            assert(dynamic.Remove(boxes[i], i));
+        assert(!dynamic.Remove(boxes[0], 0));
+        assert(dynamic.Size() == 1500);
+        {
+            AABB w(Vec2(20, 20), Vec2(60, 60));
+            std::vector<uint32_t> expect, got;
+            for (uint32_t i = 1; i < boxes.size(); i += 2)
+                if (overlaps(w, boxes[i]))
+                    expect.push_back(i);
+            dynamic.Query(w, got);
+            std::sort(got.begin(), got.end());
+            assert(got == expect);
+        }
+
+        // 空间连接与暴力结果一致
+        std::vector<AABB> others(2000);
+        for (auto &b : others)
+            b = makeBox();
+        RTree other;
+        other.BulkLoad(others.data(), others.size());
+        std::vector<std::pair<uint32_t, uint32_t>> pairs, expect;
+        RTree::Join(bulk, other, pairs);
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+            for (uint32_t j = 0; j < others.size(); ++j)
+                if (overlaps(boxes[i], others[j]))
+                    expect.push_back({i, j});
+        std::sort(pairs.begin(), pairs.end());
+        assert(pairs == expect);
+        std::cout << "RTree join pairs: " << pairs.size() << std::endl;
+    }
+
+    // ---------- 松散四叉树 / 八叉树测试 ----------
+    {
+        using OxygenMathLite::Spatial::LooseOctree;
+        using OxygenMathLite::Spatial::LooseQuadtree;
+        OxygenMathLite::MathTools::FastRandom rng(99);
+        const size_t n = 4000;
+        std::vector<Vec2> pos(n), vel(n);
+        std::vector<real> rad(n);
+        LooseQuadtree quad(Vec2(50, 50), 50, 8, 8);
+        for (size_t i = 0; i < n; ++i)
+        {
+            pos[i] = Vec2(rng.Uniform() * 100, rng.Uniform() * 100);
+            vel[i] = Vec2(rng.Range(-5, 5), rng.Range(-5, 5));
+            rad[i] = rng.Uniform() * 0.5f;
+            assert(quad.Insert(pos[i], rad[i]) == i);
+        }
+        auto check = [&](const Vec2 &c, real r)
+        {
+            std::vector<uint32_t> expect, got;
+            for (uint32_t i = 0; i < n; ++i)
+                if ((pos[i] - c).length() <= r + rad[i])
+                    expect.push_back(i);
+            quad.QueryRadius(c, r, got);
+            std::sort(got.begin(), got.end());
+            assert(got == expect);
+        };
+        // 多帧积分移动, 部分物体离开根格子, 查询结果与暴力一致
+        for (int frame = 0; frame < 10; ++frame)
+        {
+            for (size_t i = 0; i < n; ++i)
+                OxygenMathLite::Integration2D::Euler(pos[i], vel[i], Vec2(0, -1), 0.1f);
+            quad.Update(pos.data(), n);
+            for (int q = 0; q < 10; ++q)
+                check(Vec2(rng.Range(-10, 110), rng.Range(-10, 110)), rng.Uniform() * 8);
+        }
+        // 盒查询与删除
+        for (uint32_t i = 0; i < n; i += 3)
+            quad.Remove(i);
+        assert(quad.Size() == n - (n + 2) / 3);
+        {
+            std::vector<uint32_t> expect, got;
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                Vec2 c(std::clamp(pos[i].x, real(20), real(40)), std::clamp(pos[i].y, real(30), real(70)));
+                if (i % 3 && (pos[i] - c).lengthSquared() <= rad[i] * rad[i])
+                    expect.push_back(i);
+            }
+            quad.Query(Vec2(20, 30), Vec2(40, 70), got);
+            std::sort(got.begin(), got.end());
+            assert(got == expect);
+        }
+        for (uint32_t i = 0; i < n; i += 3)
+            assert(quad.Insert(pos[i], rad[i]) < n);
+
+        // 在边界反弹的物体越界一帧后回到根格子内, 不应继续留在根节点
+        {
+            const size_t m = 20000;
+            std::vector<Vec2> p(m), v(m);
+            LooseQuadtree bounce(Vec2(50, 50), 50);
+            for (size_t i = 0; i < m; ++i)
+            {
+                p[i] = Vec2(rng.Uniform() * 100, rng.Uniform() * 100);
+                v[i] = Vec2(rng.Range(-20, 20), rng.Range(-20, 20));
+                bounce.Insert(p[i], 0.2f);
+            }
+            for (int frame = 0; frame < 60; ++frame)
+            {
+                size_t outside = 0;
+                for (size_t i = 0; i < m; ++i)
+                {
+                    p[i] += v[i] * 0.1f;
+                    if (p[i].x < 0 || p[i].x > 100)
+                        v[i].x = -v[i].x;
+                    if (p[i].y < 0 || p[i].y > 100)
+                        v[i].y = -v[i].y;
+                    outside += p[i].x < 0 || p[i].x > 100 || p[i].y < 0 || p[i].y > 100;
+                }
+                bounce.Update(p.data(), m);
+                assert(bounce.RootCount() == outside);
+            }
+            std::vector<uint32_t> got;
+            bounce.QueryRadius(Vec2(3, 97), 4, got);
+            size_t expect = 0;
+            for (const Vec2 &q : p)
+                expect += (q - Vec2(3, 97)).length() <= 4.2f;
+            assert(got.size() == expect);
+        }
+
+        // 八叉树的批量并行半径查询
+        LooseOctree oct(Vec3(0, 0, 0), 10);
+        std::vector<Vec3> pts(2000);
+        for (auto &p : pts)
+        {
+            p = Vec3(rng.Range(-10, 10), rng.Range(-10, 10), rng.Range(-10, 10));
+            oct.Insert(p);
+        }
+        for (auto &p : pts)
+            p = p + Vec3(rng.Range(-1, 1), rng.Range(-1, 1), rng.Range(-1, 1));
+        oct.Update(pts.data(), pts.size());
+        OxygenMathLite::Geometry2D::IndexBuffer nb;
+        oct.QueryRadius(pts.data(), 100, 1.5f, nb);
+        assert(nb.Size() == 100);
+        for (size_t i = 0; i < 100; ++i)
+        {
+            size_t expect = 0;
+            for (const auto &p : pts)
+                expect += (p - pts[i]).lengthSquared() <= 1.5f * 1.5f;
+            assert(nb.offsets[i + 1] - nb.offsets[i] == expect);
+        }
+        std::cout << "LooseQuadtree nodes: " << quad.NodeCount() << std::endl;
+    }
+
+    // ---------- 最小包围圆 / 球与 OBB 测试 ----------
+    {
+        using namespace OxygenMathLite::Fitting;
+        OxygenMathLite::MathTools::FastRandom rng(100);
+
+        // 最小包围圆: 包含全部点, 且半径不大于暴力枚举 (两点直径圆 / 三点外接圆) 的最优解
+        std::vector<Vec2> pts(40);
+        for (auto &p : pts)
+            p = Vec2(rng.Range(-5, 5), rng.Range(-3, 3));
+        OxygenMathLite::Geometry2D::Circle c = MinEnclosingCircle(pts);
+        real brute = std::numeric_limits<real>::max();
+        auto tryCircle = [&](const OxygenMathLite::Geometry2D::Circle &k)
+        {
+            for (const auto &p : pts)
+                if ((p - k.center).length() > k.radius * 1.0001f)
+                    return;
+            brute = std::min(brute, k.radius);
+        };
+        for (size_t i = 0; i < pts.size(); ++i)
+            for (size_t j = i + 1; j < pts.size(); ++j)
+            {
+                tryCircle({(pts[i] + pts[j]) * 0.5f, (pts[i] - pts[j]).length() * 0.5f});
+                for (size_t k = j + 1; k < pts.size(); ++k)
+                {
+                    OxygenMathLite::Geometry2D::Circle cc;
+                    if (OxygenMathLite::Geometry2D::Circumcircle(pts[i], pts[j], pts[k], cc))
+                        tryCircle(cc);
+                }
+            }
+        for (const auto &p : pts)
+            assert((p - c.center).length() <= c.radius * 1.0001f);
+        assert(std::abs(c.radius - brute) < 1e-3f);
+        // 共线点退化为最远两点的直径圆
+        std::vector<Vec2> line{{0, 0}, {1, 1}, {3, 3}, {2, 2}};
+        c = MinEnclosingCircle(line);
+        assert(std::abs(c.radius - std::sqrt(real(18)) / 2) < 1e-4f && (c.center - Vec2(1.5f, 1.5f)).length() < 1e-4f);
+
+        // 最小包围球: 立方体顶点加内部点, 外接球半径为 sqrt(3)
+        std::vector<Vec3> cube;
+        for (int i = 0; i < 8; ++i)
+            cube.push_back(Vec3(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1) + Vec3(2, -1, 5));
+        for (int i = 0; i < 200; ++i)
+            cube.push_back(Vec3(rng.Range(1, 3), rng.Range(-2, 0), rng.Range(4, 6)));
+        OxygenMathLite::Geometry3D::Sphere s = MinEnclosingSphere(cube);
+        assert(std::abs(s.radius - std::sqrt(real(3))) < 1e-4f && (s.center - Vec3(2, -1, 5)).length() < 1e-4f);
+        // 共面点 (圆盘) 的包围球
+        std::vector<Vec3> disk;
+        for (int i = 0; i < 100; ++i)
+        {
+            real a = rng.Range(0, OxygenMathLite::Constants::TWO_PI), r = i < 8 ? 2 : rng.Range(0, 2);
+            disk.push_back(Vec3(r * std::cos(a), r * std::sin(a), 0));
+        }
+        s = MinEnclosingSphere(disk);
+        for (const auto &p : disk)
+            assert((p - s.center).length() <= s.radius * 1.0001f);
+        assert(s.radius <= 2.0001f && std::abs(s.center.z) < 1e-4f);
+
+        // 2D OBB: 旋转的 8 x 2 矩形内的点, 卡壳结果贴合且不大于 PCA 结果
+        OxygenMathLite::Rot2 rot(0.6f);
+        std::vector<Vec2> rect;
+        for (int i = 0; i < 500; ++i)
+            rect.push_back(rot.Rotate(Vec2(rng.Range(-4, 4), rng.Range(-1, 1))) + Vec2(10, 20));
+        for (int i = 0; i < 4; ++i)
+            rect.push_back(rot.Rotate(Vec2(i & 1 ? 4 : -4, i & 2 ? 1 : -1)) + Vec2(10, 20));
+        OxygenMathLite::Geometry2D::OBB box = FitOBB(rect.data(), rect.size());
+        OxygenMathLite::Geometry2D::OBB pcaBox = FitOBB(rect.data(), rect.size(), OBBMethod::PCA);
+        assert(std::abs(box.Area() - 16) < 1e-2f && box.Area() <= pcaBox.Area() + 1e-3f);
+        assert((box.center - Vec2(10, 20)).length() < 1e-3f);
+        for (const auto &p : rect)
+        {
+            Vec2 d = p - box.center;
+            assert(std::abs(d.dot(box.axes[0])) <= box.halfExtents.x + 1e-3f && std::abs(d.dot(box.axes[1])) <= box.halfExtents.y + 1e-3f);
+        }
+
+        // 3D OBB: 旋转长方体 (真实体积 4 * 2 * 1 = 8), 卡壳结果不差于 PCA 且接近真实值
+        OxygenMathLite::Mat3 R = OxygenMathLite::Mat3::Rotation(Vec3(1, 2, 3).normalize(), 0.7f);
+        std::vector<Vec3> brick;
+        for (int i = 0; i < 8; ++i)
+            brick.push_back(R * Vec3(i & 1 ? 2 : -2, i & 2 ? 1 : -1, i & 4 ? 0.5f : -0.5f));
+        for (int i = 0; i < 300; ++i)
+            brick.push_back(R * Vec3(rng.Range(-2, 2), rng.Range(-1, 1), rng.Range(-0.5f, 0.5f)));
+        OxygenMathLite::Geometry3D::OBB box3 = FitOBB(brick.data(), brick.size());
+        assert(box3.Volume() <= FitOBB(brick.data(), brick.size(), OBBMethod::PCA).Volume() + 1e-4f && box3.Volume() < 8 * 1.1f);
+        for (const auto &p : brick)
+        {
+            Vec3 d = p - box3.center;
+            for (int k = 0; k < 3; ++k)
+                assert(std::abs(d.dot(box3.axes[k])) <= box3.halfExtents[k] + 1e-3f);
+        }
+
+        // 批量: 与逐个计算一致
+        std::vector<Vec2> all;
+        std::vector<size_t> offsets{0};
+        for (int g = 0; g < 300; ++g)
+        {
+            Vec2 center(rng.Range(-100, 100), rng.Range(-100, 100));
+            size_t m = 1 + rng.Index(30);
+            for (size_t i = 0; i < m; ++i)
+                all.push_back(center + Vec2(rng.Range(-2, 2), rng.Range(-2, 2)));
+            offsets.push_back(all.size());
+        }
+        std::vector<OxygenMathLite::Geometry2D::Circle> circles(300);
+        std::vector<OxygenMathLite::Geometry2D::OBB> boxes(300);
+        MinEnclosingCircles(all.data(), offsets.data(), 300, circles.data());
+        FitOBBs(all.data(), offsets.data(), 300, boxes.data());
+        for (size_t g = 0; g < 300; ++g)
+        {
+            OxygenMathLite::Geometry2D::Circle one = MinEnclosingCircle(all.data() + offsets[g], offsets[g + 1] - offsets[g]);
+            assert(one.radius == circles[g].radius);
+            assert(boxes[g].Area() <= 16 + 1e-3f);
+            for (size_t i = offsets[g]; i < offsets[g + 1]; ++i)
+                assert((all[i] - circles[g].center).length() <= circles[g].radius * 1.0001f + 1e-5f);
+        }
+    }
+
     std::cout << "===== 所有测试完成=====\n";
     return 0;
 }